@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+#include "bench_common.hpp"
+
+// best wall-clock time over several runs of fn, in seconds
+template <typename Fn>
+double bestOf(int iterations, Fn&& fn) {
+    double best = 0;
+    for (int i = 0; i < iterations; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+struct MicroResult {
+    double minNs;
+    double medianNs;
+    // calls per timed sample
+    size_t batch;
+};
+
+// a sample shorter than this is dominated by clock overhead and scheduler noise
+inline constexpr double kMinBatchNs = 5e6;
+
+// per-call time of fn. the batch doubles until one batch runs kMinBatchNs, so the
+// call count is fixed before timing starts; then one warmup batch and `samples` timed ones
+template <typename Fn>
+MicroResult microbench(int samples, Fn&& fn) {
+    const auto runBatch = [&](size_t n) {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; i++) fn();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    };
+    size_t batch = 1;
+    while (runBatch(batch) < kMinBatchNs && batch < (size_t{1} << 30)) batch *= 2;
+    (void)runBatch(batch);
+
+    std::vector<double> perCall;
+    for (int i = 0; i < std::max(samples, 1); i++) perCall.push_back(runBatch(batch) / static_cast<double>(batch));
+    std::ranges::sort(perCall);
+    return {.minNs = perCall.front(), .medianNs = perCall[perCall.size() / 2], .batch = batch};
+}
+
+// heap allocations so far, counted by the operator new replacement in main.cpp
+size_t allocationCount();
+// bytes allocated with operator new and not yet freed
+size_t liveHeapBytes();
+
+enum class OutputFormat { Text, Json, Csv };
+void setOutputFormat(OutputFormat format);
+// where the human-readable report goes: stdout, or stderr when stdout carries json or csv
+FILE* textOut();
+// one measurement, collected for the json or csv output
+void recordResult(std::string_view suite, std::string_view name, std::string_view metric, double value, std::string_view unit);
+// prints a microbench line and records its min and median
+void reportMicro(std::string_view suite, std::string_view name, const MicroResult& result);
+// the collected results on stdout, for json or csv output
+void printResults(int iterations);
+
+void benchTokenizer(size_t megabytes, int iterations);
+void benchLookup(int iterations);
+void benchParse(size_t lines, int iterations);
+void benchStartup(size_t lines, int iterations);
+void benchLang(int iterations);
+void benchInput(int iterations);
+void benchRuntime(int iterations);
+void benchScaling(int iterations);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "lang/interpreter.hpp"
+
+// shared by the benchmarks and the perf gate
+
+// keeps the compiler from hoisting a pure lookup out of the timing loop
+template <typename T>
+inline void doNotOptimize(T& value) {
+    asm volatile("" : "+m"(value) : : "memory");
+}
+
+// commands blanked and remaps turned into empty commands, so matching one has no side effects
+// (no process spawned, no event posted) while the table keeps its size and order
+inline void blankActions(std::vector<Binding>& bindings) {
+    for (auto& binding : bindings) binding.action = std::string{};
+}
@@ -0,0 +1,50 @@
+#include <array>
+#include <print>
+
+#include "bench.hpp"
+#include "input/modifier.hpp"
+
+// the modifier checks every key event runs: converting the event's flags, then one
+// isActivatedBy per binding scanned
+namespace {
+
+// a mix of what hotkeys use: none, generic, sided, several, fn
+constexpr std::array kBindingFlags{
+    ModifierFlags{0},
+    ModifierFlags{Hotkey_Flag_Cmd},
+    ModifierFlags{Hotkey_Flag_LAlt},
+    ModifierFlags{Hotkey_Flag_Cmd | Hotkey_Flag_Alt | Hotkey_Flag_Control | Hotkey_Flag_Shift},
+    ModifierFlags{Hotkey_Flag_RCmd | Hotkey_Flag_Shift},
+    ModifierFlags{Hotkey_Flag_Fn | Hotkey_Flag_Control},
+};
+
+}  // namespace
+
+void benchInput(int iterations) {
+    std::print(textOut(), "input: {} samples\n", iterations);
+
+    const std::array<CGEventFlags, 4> eventFlags{
+        0,
+        kCGEventFlagMaskCommand | NX_DEVICELCMDKEYMASK,
+        kCGEventFlagMaskAlternate | kCGEventFlagMaskShift | NX_DEVICERALTKEYMASK | NX_DEVICELSHIFTKEYMASK,
+        kCGEventFlagMaskControl | kCGEventFlagMaskSecondaryFn | NX_DEVICELCTLKEYMASK,
+    };
+    size_t next = 0;
+    reportMicro("input", "eventModifierFlagsToHotkeyFlags", microbench(iterations, [&] {
+        auto flags = eventFlags[next++ % eventFlags.size()];
+        doNotOptimize(flags);
+        auto mods = eventModifierFlagsToHotkeyFlags(flags);
+        doNotOptimize(mods);
+    }));
+
+    std::array<ModifierFlags, eventFlags.size()> current{};
+    for (size_t i = 0; i < eventFlags.size(); i++) current[i] = eventModifierFlagsToHotkeyFlags(eventFlags[i]);
+    next = 0;
+    reportMicro("input", "isActivatedBy", microbench(iterations, [&] {
+        const auto& binding = kBindingFlags[next % kBindingFlags.size()];
+        auto event = current[next++ % current.size()];
+        doNotOptimize(event);
+        bool active = binding.isActivatedBy(event);
+        doNotOptimize(active);
+    }));
+}
@@ -0,0 +1,82 @@
+#include <format>
+#include <iterator>
+#include <print>
+#include <string>
+#include <string_view>
+
+#include "bench.hpp"
+#include "config_gen.hpp"
+#include "lang/interpreter.hpp"
+#include "lang/parser.hpp"
+#include "lang/tokenizer.hpp"
+
+// per-call cost of each language stage on configs the size of a typical one, where the
+// parse and startup suites measure whole loads of a large one. keys are hex keycodes,
+// so nothing depends on the keyboard layout
+namespace {
+
+constexpr size_t kLines = 1'000;
+
+// each line expands to one binding per key: cmd + {0x00, 0x01, ...} : echo {0, 1, ...}
+std::string braceConfig(size_t lines, size_t keys) {
+    std::string out;
+    auto it = std::back_inserter(out);
+    constexpr std::string_view kMods[] = {"cmd", "alt", "ctrl", "shift"};
+    for (size_t line = 0; line < lines; line++) {
+        std::format_to(it, "{} + {} + {{", kMods[line % 4], kMods[(line + 1) % 4]);
+        for (size_t k = 0; k < keys; k++) std::format_to(it, "{}{:#04x}", k == 0 ? "" : ", ", k);
+        out += "} : echo {";
+        for (size_t k = 0; k < keys; k++) std::format_to(it, "{}{}", k == 0 ? "" : ", ", k);
+        std::format_to(it, "}} {}\n", line);
+    }
+    return out;
+}
+
+// m1 = cmd, m2 = m1 + alt, ... each modifier defined in terms of the one before,
+// and bindings on the deepest
+std::string modifierChainConfig(size_t depth, size_t bindings) {
+    std::string out{"define_modifier m1 = cmd\n"};
+    auto it = std::back_inserter(out);
+    constexpr std::string_view kMods[] = {"alt", "ctrl", "shift", "cmd"};
+    for (size_t i = 2; i <= depth; i++) std::format_to(it, "define_modifier m{} = m{} + {}\n", i, i - 1, kMods[i % 4]);
+    for (size_t i = 0; i < bindings; i++) std::format_to(it, "m{} + {:#04x} : echo {}\n", depth, i % 0x30, i);
+    return out;
+}
+
+size_t tokenizeAll(std::string_view input) {
+    Tokenizer tokenizer{input};
+    size_t count = 0;
+    while (tokenizer.next().type != TokenType::EndOfFile) count++;
+    return count;
+}
+
+void reportInterpret(std::string_view name, const std::string& config, int iterations) {
+    Parser parser{config};
+    const auto program = parser.parseProgram();
+    if (!parser.errors().empty()) std::print(textOut(), "  {}: config has parse errors\n", name);
+    reportMicro("lang", name, microbench(iterations, [&] {
+        auto result = interpretProgram(program);
+        doNotOptimize(result);
+    }));
+}
+
+}  // namespace
+
+void benchLang(int iterations) {
+    const std::string config = generateConfigLines(kLines);
+    std::print(textOut(), "lang: {} line configs, {} samples\n", kLines, iterations);
+
+    reportMicro("lang", "tokenize", microbench(iterations, [&] {
+        size_t tokens = tokenizeAll(config);
+        doNotOptimize(tokens);
+    }));
+    // the copy into the parser is part of every real parse too
+    reportMicro("lang", "parseProgram", microbench(iterations, [&] {
+        Parser parser{config};
+        auto program = parser.parseProgram();
+        doNotOptimize(program);
+    }));
+    reportInterpret("interpretProgram", config, iterations);
+    reportInterpret("interpret brace expansion 32x32", braceConfig(32, 32), iterations);
+    reportInterpret("interpret define_modifier chain 64", modifierChainConfig(64, 256), iterations);
+}
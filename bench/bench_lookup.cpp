@@ -0,0 +1,88 @@
+#include <print>
+#include <string_view>
+#include <vector>
+
+#include "bench.hpp"
+#include "input/keysym.hpp"
+#include "input/locale.hpp"
+#include "input/modifier.hpp"
+#include "lang/tokenizer.hpp"
+
+// name lookups the tokenizer and parser do per identifier, against the linear scans
+// they replaced. the references are kept out of line like the real lookups, which live
+// in other translation units
+namespace {
+
+[[gnu::noinline]] std::optional<LiteralKey> linearLiteralKey(std::string_view name) {
+    for (size_t i = 0; i < literal_keys.size(); i++) {
+        if (literal_keys[i].name == name) return static_cast<LiteralKey>(i);
+    }
+    return std::nullopt;
+}
+
+[[gnu::noinline]] std::optional<BuiltinModifier> linearBuiltinModifier(std::string_view name) {
+    for (size_t i = 0; i < builtin_modifiers.size(); i++) {
+        if (builtin_modifiers[i].name == name) return static_cast<BuiltinModifier>(i);
+    }
+    return std::nullopt;
+}
+
+[[gnu::noinline]] bool chainedKeyword(std::string_view text) {
+    return text == "define_modifier" || text == "define_region" || text == "max_chord_interval"
+           || text == "hold_modifier_threshold" || text == "simultaneous_threshold" || text == "blacklist"
+           || text == "sequence_command" || text == "corner_size" || text == "tap_timeout" || text == "press_threshold";
+}
+
+// every known name plus the identifiers that miss all tables
+std::vector<std::string_view> sampleNames() {
+    std::vector<std::string_view> names;
+    for (const auto& entry : literal_keys) names.emplace_back(entry.name);
+    for (const auto& entry : builtin_modifiers) names.emplace_back(entry.name);
+    for (std::string_view name : {"define_modifier", "blacklist", "press_threshold", "hyper", "trackpad_tap",
+             "a", "return_", "f21", "shiftt", "x"}) {
+        names.push_back(name);
+    }
+    return names;
+}
+
+constexpr int kRounds = 20'000;
+
+template <typename Fn>
+void report(std::string_view label, const std::vector<std::string_view>& names, int iterations, Fn&& lookup) {
+    size_t hits = 0;
+    const double seconds = bestOf(iterations, [&] {
+        hits = 0;
+        for (int round = 0; round < kRounds; round++) {
+            for (auto name : names) {
+                doNotOptimize(name);
+                hits += lookup(name) ? 1 : 0;
+            }
+        }
+    });
+    const double lookups = static_cast<double>(kRounds) * static_cast<double>(names.size());
+    std::print(textOut(), "  {:<28} {:>7.2f} ns/lookup  ({} hits)\n", label, seconds * 1e9 / lookups, hits / kRounds);
+    recordResult("lookup", label, "time", seconds * 1e9 / lookups, "ns/lookup");
+}
+
+}  // namespace
+
+void benchLookup(int iterations) {
+    const auto names = sampleNames();
+    std::print(textOut(), "lookup: {} names, {} rounds, best of {}\n", names.size(), kRounds, iterations);
+    report("literal key (linear)", names, iterations, linearLiteralKey);
+    report("literal key (perfect hash)", names, iterations, parseLiteralKey);
+    report("modifier (linear)", names, iterations, linearBuiltinModifier);
+    report("modifier (perfect hash)", names, iterations, parseBuiltinModifier);
+    report("keyword (compare chain)", names, iterations, chainedKeyword);
+    report("keyword (perfect hash)", names, iterations, lookupKeyword);
+
+    if (!initializeKeycodeMap()) {
+        std::print(textOut(), "  keycode map unavailable, skipping layout lookups\n");
+        return;
+    }
+    const std::vector<std::string_view> keys{"a", "q", "z", "0", "9", "m", "é", "-"};
+    report("layout key -> keycode", keys, iterations, lookupKeycode);
+    report("keycode -> layout key", keys, iterations, [](std::string_view key) {
+        return lookupKeyString(lookupKeycode(key).value_or(0xFFFF));
+    });
+}
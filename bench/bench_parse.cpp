@@ -0,0 +1,87 @@
+#include <sys/resource.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <string>
+#include <string_view>
+
+#include "bench.hpp"
+#include "config_gen.hpp"
+#include "lang/config_loader.hpp"
+#include "lang/interpreter.hpp"
+#include "lang/parser.hpp"
+
+// parse and interpret time, heap allocations and peak RSS on a generated config
+namespace {
+
+double peakRssMb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<double>(usage.ru_maxrss) / (1024.0 * 1024.0);
+#else
+    return static_cast<double>(usage.ru_maxrss) / 1024.0;
+#endif
+}
+
+}  // namespace
+
+void benchParse(size_t lines, int iterations) {
+    const std::string config = generateConfigLines(lines);
+    const double rssBefore = peakRssMb();
+
+    size_t statements = 0;
+    size_t parseAllocations = 0;
+    const double parseSeconds = bestOf(iterations, [&] {
+        const size_t before = allocationCount();
+        Parser parser{config};
+        const auto program = parser.parseProgram();
+        parseAllocations = allocationCount() - before;
+        statements = program.statements.size();
+    });
+
+    size_t bindings = 0;
+    size_t totalAllocations = 0;
+    const double totalSeconds = bestOf(iterations, [&] {
+        const size_t before = allocationCount();
+        Parser parser{config};
+        const auto program = parser.parseProgram();
+        const auto result = interpretProgram(program);
+        totalAllocations = allocationCount() - before;
+        bindings = result.bindings.size();
+    });
+
+    // whole-file loads: the mapped path against reading into a string and parsing that
+    const auto path = std::filesystem::temp_directory_path() / "smhkd_bench.conf";
+    std::ofstream{path, std::ios::binary} << config;
+    size_t mappedAllocations = 0;
+    const double mappedSeconds = bestOf(iterations, [&] {
+        const size_t before = allocationCount();
+        const auto result = ConfigLoader::loadFromFile(path);
+        mappedAllocations = allocationCount() - before;
+    });
+    size_t readAllocations = 0;
+    const double readSeconds = bestOf(iterations, [&] {
+        const size_t before = allocationCount();
+        std::ifstream file(path);
+        const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        const auto result = ConfigLoader::loadFromContents(contents);
+        readAllocations = allocationCount() - before;
+    });
+    std::filesystem::remove(path);
+
+    std::print(textOut(), "parse: {} lines, {} statements, {} bindings, best of {}\n", lines, statements, bindings, iterations);
+    const auto report = [](std::string_view name, double seconds, size_t allocations) {
+        std::print(textOut(), "  {:<20} {:>8.2f} ms  {:>9} allocations\n", name, seconds * 1e3, allocations);
+        recordResult("parse", name, "time", seconds * 1e3, "ms");
+        recordResult("parse", name, "allocations", static_cast<double>(allocations), "count");
+    };
+    report("parse", parseSeconds, parseAllocations);
+    report("parse + interpret", totalSeconds, totalAllocations);
+    report("load file (mmap)", mappedSeconds, mappedAllocations);
+    report("load file (read)", readSeconds, readAllocations);
+    std::print(textOut(), "  peak rss             {:>8.1f} MB  (+{:.1f} MB during this suite)\n", peakRssMb(), peakRssMb() - rssBefore);
+    recordResult("parse", "peak rss", "memory", peakRssMb(), "MB");
+}
@@ -0,0 +1,134 @@
+#include <CoreGraphics/CGEvent.h>
+
+#include <algorithm>
+#include <array>
+#include <print>
+#include <string>
+#include <ranges>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "bench.hpp"
+#include "config_gen.hpp"
+#include "lang/config_loader.hpp"
+#include "runtime/hotkey_engine.hpp"
+#include "runtime/safety_monitor.hpp"
+#include "runtime/tap_detector.hpp"
+
+// the work on the event tap and touch threads per event or frame
+namespace {
+
+constexpr size_t kLines = 1'000;
+
+void benchHandleEvent(int iterations) {
+    auto bindings = ConfigLoader::loadFromContents(generateConfigLines(kLines)).bindings;
+    blankActions(bindings);
+    // the last single-chord binding, so a hit scans the whole table like a miss does
+    const auto isSingle = [](const Binding& b) { return b.source.chords.size() == 1; };
+    const auto single = std::ranges::find_if(bindings | std::views::reverse, isSingle);
+    const auto sequence = std::ranges::find_if(bindings, [](const Binding& b) { return b.source.chords.size() == 2; });
+    if (single == std::ranges::rend(bindings) || sequence == bindings.end()) {
+        std::print(textOut(), "  generated config has no bindings to match, skipping handleEvent\n");
+        return;
+    }
+    const Chord hit = single->source.chords[0];
+    const std::array<Chord, 2> chords{sequence->source.chords[0], sequence->source.chords[1]};
+
+    HotkeyEngine engine;
+    engine.applyConfig(std::move(bindings), {}, {});
+    const Chord miss{.keysym = {0xFFFF}, .modifiers = {0}, .fingerCount = std::nullopt};
+
+    reportMicro("runtime", "handleEvent hit", microbench(iterations, [&] {
+        bool consumed = engine.handleEvent(hit, kCGEventKeyDown, false, 0);
+        doNotOptimize(consumed);
+    }));
+    reportMicro("runtime", "handleEvent miss", microbench(iterations, [&] {
+        bool consumed = engine.handleEvent(miss, kCGEventKeyDown, false, 0);
+        doNotOptimize(consumed);
+    }));
+    // both chords per call; the second completes the sequence and clears it
+    reportMicro("runtime", "handleEvent sequence (2 chords)", microbench(iterations, [&] {
+        bool first = engine.handleEvent(chords[0], kCGEventKeyDown, false, 0);
+        bool second = engine.handleEvent(chords[1], kCGEventKeyDown, false, 0);
+        doNotOptimize(first);
+        doNotOptimize(second);
+    }));
+}
+
+// a remapped key through the event tap both ways, replaying a press and release of each remap
+// in turn. reposting makes a new tagged event and consumes the original, and the copy crosses
+// the tap again to be let by on its tag. CGEventPost and the trip back through the window
+// server to the tap can't be timed here, so the repost figure is a lower bound
+void benchRemap(int iterations) {
+    auto bindings = ConfigLoader::loadFromContents(generateConfigLines(kLines)).bindings;
+    std::vector<Chord> trace;
+    for (auto& binding : bindings) {
+        if (std::holds_alternative<std::string>(binding.action)) {
+            binding.action = std::string{};
+        } else if (const auto* target = std::get_if<Chord>(&binding.action); target && !target->modifiers.has(Hotkey_Flag_NX)) {
+            trace.push_back(binding.source.chords[0]);
+        }
+    }
+    if (trace.empty()) {
+        std::print(textOut(), "  generated config has no remaps, skipping remap\n");
+        return;
+    }
+    HotkeyEngine engine;
+    engine.applyConfig(std::move(bindings), {}, {});
+
+    size_t step = 0;
+    const auto next = [&] {
+        const size_t i = step++ % (trace.size() * 2);
+        return std::pair{trace[i / 2], i % 2 == 0 ? kCGEventKeyDown : kCGEventKeyUp};
+    };
+    reportMicro("runtime", "remap repost (tap crossed twice)", microbench(iterations, [&] {
+        const auto [chord, type] = next();
+        const auto decision = engine.decideEvent(chord, type, false, 0);
+        CGEventRef posted = HotkeyEngine::createKeyEvent(decision.target, type == kCGEventKeyDown);
+        auto tag = CGEventGetIntegerValueField(posted, kCGEventSourceUserData);
+        doNotOptimize(tag);
+        if (posted) CFRelease(posted);
+    }));
+    CGEventRef held = CGEventCreateKeyboardEvent(nullptr, 0, true);
+    reportMicro("runtime", "remap rewrite in place", microbench(iterations, [&] {
+        const auto [chord, type] = next();
+        const auto decision = engine.decideEvent(chord, type, false, 0);
+        HotkeyEngine::rewriteKeyEvent(held, decision.target);
+        doNotOptimize(held);
+    }));
+    if (held) CFRelease(held);
+}
+
+}  // namespace
+
+void benchRuntime(int iterations) {
+    std::print(textOut(), "runtime: {} line config, {} samples\n", kLines, iterations);
+    benchHandleEvent(iterations);
+    benchRemap(iterations);
+
+    // a held layer remapping a few keys at key-repeat rate with some typing mixed in: the
+    // window stays full and nothing trips, so every call does the steady-state eviction and counting
+    SafetyMonitor safety;
+    auto now = SafetyMonitor::clock::now();
+    uint32_t event = 0;
+    reportMicro("runtime", "SafetyMonitor::recordEvent", microbench(iterations, [&] {
+        now += std::chrono::milliseconds(10);
+        const bool consumed = event % 4 != 0;
+        auto action = safety.recordEvent(true, consumed, event++ % 8, now);
+        doNotOptimize(action);
+    }));
+
+    // a corner tap as the touch thread sees it: down, two frames held, up
+    TapDetector taps;
+    taps.setConfig({.cornerSizePct = 15, .tapTimeoutMs = 300});
+    const std::vector<Touch> down{{.id = 1, .x = 0.95F, .y = 0.95F}};
+    const std::vector<Touch> up;
+    int64_t frameNs = 0;
+    int frame = 0;
+    reportMicro("runtime", "TapDetector::onFrame", microbench(iterations, [&] {
+        frameNs += 8'000'000;
+        auto zone = taps.onFrame(frame++ % 4 == 3 ? up : down, frameNs);
+        doNotOptimize(zone);
+    }));
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cstdlib>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "config_gen.hpp"
+#include "lang/interpreter.hpp"
+#include "lang/parser.hpp"
+#include "runtime/hotkey_engine.hpp"
+
+// how load time, memory and matching grow with the number of bindings: one table row per
+// size, from 10 up to SMHKD_BENCH_SCALE_MAX (default 100000) by factors of 10. the rest of
+// the shape comes from SMHKD_BENCH_SEQUENCE_DEPTH, _SEQUENCE_PCT, _BRACE_WIDTH,
+// _MODIFIER_DEPTH, _REMAP_PCT and _TAP_PCT, defaulting to ConfigShape's
+namespace {
+
+size_t envOr(const char* name, size_t fallback) {
+    const char* value = std::getenv(name);
+    return value ? std::strtoul(value, nullptr, 10) : fallback;
+}
+
+ConfigShape shapeFromEnv() {
+    const ConfigShape defaults;
+    return {
+        .sequenceDepth = envOr("SMHKD_BENCH_SEQUENCE_DEPTH", defaults.sequenceDepth),
+        .sequencePercent = static_cast<unsigned>(envOr("SMHKD_BENCH_SEQUENCE_PCT", defaults.sequencePercent)),
+        .braceWidth = envOr("SMHKD_BENCH_BRACE_WIDTH", defaults.braceWidth),
+        .modifierDepth = envOr("SMHKD_BENCH_MODIFIER_DEPTH", defaults.modifierDepth),
+        .remapPercent = static_cast<unsigned>(envOr("SMHKD_BENCH_REMAP_PCT", defaults.remapPercent)),
+        .tapPercent = static_cast<unsigned>(envOr("SMHKD_BENCH_TAP_PCT", defaults.tapPercent)),
+    };
+}
+
+double megabytes(size_t bytes) {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+void row(ConfigShape shape, int iterations) {
+    const std::string config = generateConfig(shape);
+    const auto lines = static_cast<size_t>(std::ranges::count(config, '\n'));
+
+    const double parseSeconds = bestOf(iterations, [&] {
+        Parser parser{config};
+        auto program = parser.parseProgram();
+        doNotOptimize(program);
+    });
+
+    // live bytes held by the AST (with its copy of the source) and by the interpreted tables
+    const size_t beforeProgram = liveHeapBytes();
+    const auto program = [&] {
+        Parser parser{config};
+        return parser.parseProgram();
+    }();
+    const size_t programBytes = liveHeapBytes() - beforeProgram;
+
+    const double interpretSeconds = bestOf(iterations, [&] {
+        auto result = interpretProgram(program);
+        doNotOptimize(result);
+    });
+    const size_t beforeResult = liveHeapBytes();
+    auto result = interpretProgram(program);
+    const size_t resultBytes = liveHeapBytes() - beforeResult;
+    if (!result.errors.empty()) {
+        std::print(textOut(), "  {} bindings: {} config errors, first: {}\n", shape.bindings, result.errors.size(),
+            result.errors.front().message);
+    }
+
+    // a hit halfway down the single-chord bindings, and a keycode nothing binds
+    auto& bindings = result.bindings;
+    blankActions(bindings);
+    std::vector<Chord> singles;
+    for (const auto& binding : bindings) {
+        if (binding.source.chords.size() == 1) singles.push_back(binding.source.chords[0]);
+    }
+    const Chord hit = singles.empty() ? Chord{.keysym = {0xFFFF}} : singles[singles.size() / 2];
+    const Chord miss{.keysym = {0xFFFF}, .modifiers = {0}, .fingerCount = std::nullopt};
+    const size_t tableSize = bindings.size();
+    HotkeyEngine engine;
+    engine.applyConfig(std::move(bindings), {}, {});
+
+    const auto hitResult = microbench(iterations, [&] {
+        bool consumed = engine.handleEvent(hit, kCGEventKeyDown, false, 0);
+        doNotOptimize(consumed);
+    });
+    const int matched = engine.lastMatch();
+    const auto missResult = microbench(iterations, [&] {
+        bool consumed = engine.handleEvent(miss, kCGEventKeyDown, false, 0);
+        doNotOptimize(consumed);
+    });
+
+    std::print(textOut(), "{:>9} {:>8} {:>8} {:>10.2f} {:>12.2f} {:>8.2f} {:>11.2f} {:>10.0f} {:>10} {:>10.0f}\n", shape.bindings,
+        tableSize, lines, parseSeconds * 1e3, interpretSeconds * 1e3, megabytes(programBytes), megabytes(resultBytes),
+        hitResult.minNs, matched, missResult.minNs);
+
+    const auto name = std::to_string(shape.bindings);
+    recordResult("scaling", name, "keyboard_bindings", static_cast<double>(tableSize), "count");
+    recordResult("scaling", name, "lines", static_cast<double>(lines), "count");
+    recordResult("scaling", name, "parse", parseSeconds * 1e3, "ms");
+    recordResult("scaling", name, "interpret", interpretSeconds * 1e3, "ms");
+    recordResult("scaling", name, "ast_memory", megabytes(programBytes), "MB");
+    recordResult("scaling", name, "bindings_memory", megabytes(resultBytes), "MB");
+    recordResult("scaling", name, "hit", hitResult.minNs, "ns/event");
+    recordResult("scaling", name, "hit_index", matched, "index");
+    recordResult("scaling", name, "miss", missResult.minNs, "ns/event");
+}
+
+}  // namespace
+
+void benchScaling(int iterations) {
+    auto shape = shapeFromEnv();
+    const size_t max = envOr("SMHKD_BENCH_SCALE_MAX", 100'000);
+    std::print(textOut(),
+        "scaling: sequences {}% of depth {}, brace width {}, define_modifier depth {}, remaps {}%, taps {}%, best of {}\n",
+        shape.sequencePercent, shape.sequenceDepth, shape.braceWidth, shape.modifierDepth, shape.remapPercent, shape.tapPercent,
+        iterations);
+    std::print(textOut(), "{:>9} {:>8} {:>8} {:>10} {:>12} {:>8} {:>11} {:>10} {:>10} {:>10}\n", "bindings", "keyboard", "lines",
+        "parse_ms", "interpret_ms", "ast_mb", "bindings_mb", "hit_ns", "hit_index", "miss_ns");
+    for (size_t n = 10; n <= max; n *= 10) {
+        shape.bindings = n;
+        row(shape, iterations);
+    }
+}
@@ -0,0 +1,76 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <print>
+#include <string>
+
+#include "bench.hpp"
+#include "config_gen.hpp"
+#include "lang/config_loader.hpp"
+#include "lang/interpreter.hpp"
+#include "runtime/hotkey_engine.hpp"
+
+// startup-to-first-event: load the config, hand it to the engine and match one key event,
+// as KeyHandler does on start and reload, with and without the compiled-config cache.
+// then reloads after a one-line edit, through the incremental interpreter
+namespace {
+
+bool startToFirstEvent(const std::filesystem::path& path, bool useCache) {
+    auto result = ConfigLoader::loadFromFile(path, {.useCache = useCache});
+    HotkeyEngine engine;
+    engine.applyConfig(std::move(result.bindings), std::move(result.tapBindings), std::move(result.config),
+        std::move(result.gestureBindings), std::move(result.pressBindings));
+    // a keycode nothing binds, so matching scans every binding and runs no command
+    const Chord event{.keysym = {0xFFFF}, .modifiers = {0}, .fingerCount = std::nullopt};
+    (void)engine.handleEvent(event, kCGEventKeyDown, false, 0);
+    return result.fromCache;
+}
+
+}  // namespace
+
+void benchStartup(size_t lines, int iterations) {
+    // keep the bench's cache files out of the user's cache directory
+    const auto dir = std::filesystem::temp_directory_path() / "smhkd_bench_cache";
+    std::filesystem::remove_all(dir);
+    setenv("XDG_CACHE_HOME", dir.c_str(), 1);
+
+    const auto path = dir / "smhkdrc";
+    std::filesystem::create_directories(dir);
+    std::ofstream{path, std::ios::binary} << generateConfigLines(lines);
+
+    const double parseSeconds = bestOf(iterations, [&] { (void)startToFirstEvent(path, false); });
+    // the first cached load compiles and writes the cache; the timed ones read it
+    const bool warmed = !startToFirstEvent(path, true);
+    bool hit = false;
+    const double cachedSeconds = bestOf(iterations, [&] { hit = startToFirstEvent(path, true); });
+    const auto cacheBytes = std::filesystem::file_size(config_cache::entryFor(path, {})->file);
+
+    std::print(textOut(), "startup: {} lines to first event, best of {}\n", lines, iterations);
+    std::print(textOut(), "  parse + interpret    {:>8.2f} ms\n", parseSeconds * 1e3);
+    recordResult("startup", "parse + interpret", "time", parseSeconds * 1e3, "ms");
+    std::print(textOut(), "  compiled cache       {:>8.2f} ms  ({} KB cache, {})\n", cachedSeconds * 1e3, cacheBytes / 1024,
+        warmed && hit ? "hit" : "MISSED");
+    recordResult("startup", "compiled cache", "time", cachedSeconds * 1e3, "ms");
+    std::filesystem::remove_all(dir);
+
+    // two configs a single edited command apart, reloaded alternately so every reload has one change
+    const std::string before = generateConfigLines(lines);
+    std::string after = before;
+    const auto command = after.find(": echo sequence");
+    after.insert(command + 2, "true && ");
+    IncrementalInterpreter interpreter;
+    (void)ConfigLoader::loadFromContents(before, {.interpreter = &interpreter});
+    bool edited = false;
+    size_t changed = 0;
+    const double reloadSeconds = bestOf(iterations, [&] {
+        edited = !edited;
+        (void)ConfigLoader::loadFromContents(edited ? after : before, {.interpreter = &interpreter});
+        changed = interpreter.lastStats().reinterpreted;
+    });
+    const double fullSeconds = bestOf(iterations, [&] { (void)ConfigLoader::loadFromContents(after); });
+    std::print(textOut(), "  reload, full         {:>8.2f} ms\n", fullSeconds * 1e3);
+    recordResult("startup", "reload full", "time", fullSeconds * 1e3, "ms");
+    recordResult("startup", "reload one edit", "time", reloadSeconds * 1e3, "ms");
+    std::print(textOut(), "  reload, one edit     {:>8.2f} ms  ({} of {} statements re-interpreted)\n", reloadSeconds * 1e3, changed,
+        interpreter.lastStats().statements);
+}
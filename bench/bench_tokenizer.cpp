@@ -0,0 +1,33 @@
+#include <print>
+#include <string>
+#include <string_view>
+
+#include "bench.hpp"
+#include "config_gen.hpp"
+#include "lang/tokenizer.hpp"
+
+// tokenizer throughput on a generated config
+namespace {
+
+size_t tokenizeAll(std::string_view input) {
+    Tokenizer tokenizer{input};
+    size_t count = 0;
+    while (tokenizer.next().type != TokenType::EndOfFile) {
+        count++;
+    }
+    return count;
+}
+
+}  // namespace
+
+void benchTokenizer(size_t megabytes, int iterations) {
+    const std::string config = generateConfigBytes(megabytes * 1024 * 1024);
+    size_t tokens = 0;
+    const double seconds = bestOf(iterations, [&] { tokens = tokenizeAll(config); });
+
+    const double mb = static_cast<double>(config.size()) / (1024.0 * 1024.0);
+    std::print(textOut(), "tokenizer: {:.1f} MB, {} tokens, best of {}: {:.2f} ms, {:.1f} MB/s, {:.1f} Mtok/s\n",
+        mb, tokens, iterations, seconds * 1e3, mb / seconds, static_cast<double>(tokens) / seconds / 1e6);
+    recordResult("tokenizer", "tokenize", "time", seconds * 1e3, "ms");
+    recordResult("tokenizer", "tokenize", "throughput", mb / seconds, "MB/s");
+}
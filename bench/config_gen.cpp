@@ -0,0 +1,151 @@
+#include "config_gen.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <string_view>
+
+namespace {
+
+constexpr std::string_view kModifiers[] = {"cmd", "alt", "ctrl", "shift", "hyper", "meh"};
+constexpr std::string_view kKeys[] = {"a", "h", "j", "k", "l", "return", "space", "f5", "0x32", "tab"};
+
+constexpr std::string_view kHeader =
+    "max_chord_interval = 500\n"
+    "blacklist = [\"Terminal\" \"say \\\"hi\\\"\" \"Screen Sharing\"]\n"
+    "define_modifier hyper = cmd + alt + ctrl + shift\n"
+    "define_modifier meh = alt + ctrl + shift\n";
+
+template <typename T, size_t N>
+std::string_view pick(const T (&items)[N], size_t i) {
+    return items[i % N];
+}
+
+void appendLine(std::string& out, size_t i) {
+    const auto mod = pick(kModifiers, i);
+    const auto other = pick(kModifiers, i / 7 + 1);
+    const auto key = pick(kKeys, i);
+    auto it = std::back_inserter(out);
+    switch (i % 5) {
+        case 0: std::format_to(it, "{} + {} : open -a \"App {}\"\n", mod, key, i); break;
+        case 1: std::format_to(it, "{} + {} + {} | {}\n", mod, other, key, pick(kKeys, i + 3)); break;
+        case 2: std::format_to(it, "{} + {} ; {} : echo sequence {}\n", mod, key, pick(kKeys, i + 1), i); break;
+        case 3: std::format_to(it, "{} + {{{}, {}}} : yabai -m window --focus {{west, east}} {}\n", mod, key, pick(kKeys, i + 5), i); break;
+        default: std::format_to(it, "# binding group {}\n", i); break;
+    }
+}
+
+// splitmix64: a fixed mix of the statement index, so the choice of statement kind is
+// spread evenly but never depends on a seed or the platform
+uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+// any byte is a valid hex keycode, though keyboards stop short of 0x80
+constexpr size_t kKeycodes = 256;
+
+// per modifier group: none, left, right or both sides. sided modifiers must match exactly,
+// so no single chord activates another's binding; a generic one would
+constexpr std::array<std::array<std::string_view, 4>, 4> kGroupOptions{{
+    {"", "lalt", "ralt", "lalt + ralt"},
+    {"", "lshift", "rshift", "lshift + rshift"},
+    {"", "lcmd", "rcmd", "lcmd + rcmd"},
+    {"", "lctrl", "rctrl", "lctrl + rctrl"},
+}};
+constexpr size_t kModifierCombos = 4 * 4 * 4 * 4;
+
+// the modifiers of the n-th distinct single chord, each followed by " + ". its keycode is n % 256
+void appendModifiers(std::string& out, size_t n) {
+    size_t combo = (n / kKeycodes) % kModifierCombos;
+    for (const auto& options : kGroupOptions) {
+        const auto mod = options.at(combo % 4);
+        combo /= 4;
+        if (!mod.empty()) std::format_to(std::back_inserter(out), "{} + ", mod);
+    }
+}
+
+}  // namespace
+
+std::string generateConfigLines(size_t lines) {
+    std::string out{kHeader};
+    out.reserve(lines * 48);
+    for (size_t i = 0; i < lines; i++) {
+        appendLine(out, i);
+    }
+    return out;
+}
+
+std::string generateConfigBytes(size_t bytes) {
+    std::string out{kHeader};
+    out.reserve(bytes + 128);
+    for (size_t i = 0; out.size() < bytes; i++) {
+        appendLine(out, i);
+    }
+    return out;
+}
+
+std::string generateConfig(const ConfigShape& shape) {
+    std::string out;
+    auto it = std::back_inserter(out);
+    // fn plus the four generic modifiers once the chain is long enough; no single chord uses fn
+    constexpr std::array<std::string_view, 4> kChainMods{"cmd", "alt", "ctrl", "shift"};
+    if (shape.modifierDepth > 0) {
+        out += "define_modifier m1 = fn\n";
+        for (size_t i = 2; i <= shape.modifierDepth; i++) {
+            std::format_to(it, "define_modifier m{} = m{} + {}\n", i, i - 1, kChainMods.at(i % 4));
+        }
+    }
+    const std::string leader =
+        shape.modifierDepth > 0 ? std::format("m{}", shape.modifierDepth) : std::string{"fn + cmd + alt + ctrl + shift"};
+
+    const unsigned tapBelow = shape.tapPercent;
+    const unsigned remapBelow = tapBelow + shape.remapPercent;
+    const unsigned sequenceBelow = remapBelow + (shape.sequenceDepth > 1 ? shape.sequencePercent : 0);
+    constexpr std::array<std::string_view, 4> kCorners{"tl", "tr", "bl", "br"};
+
+    size_t produced = 0;
+    size_t singles = 0;
+    size_t sequences = 0;
+    for (uint64_t statement = 0; produced < shape.bindings; statement++) {
+        const auto roll = static_cast<unsigned>(mix(statement) % 100);
+        if (roll < tapBelow) {
+            std::format_to(it, "{} + trackpad_tap({}) : echo tap {}\n", kChainMods.at(statement % 4), kCorners.at((statement / 4) % 4), statement);
+            produced++;
+        } else if (roll < remapBelow) {
+            appendModifiers(out, singles);
+            std::format_to(it, "{:#04x} | {:#04x}\n", singles % kKeycodes, (singles + 1) % kKeycodes);
+            singles++;
+            produced++;
+        } else if (roll < sequenceBelow) {
+            // the leader's key and each following chord spell out the sequence number in base 256
+            const size_t n = sequences++;
+            std::format_to(it, "{} + {:#04x}", leader, n % kKeycodes);
+            size_t rest = n / kKeycodes;
+            for (size_t i = 1; i < shape.sequenceDepth; i++, rest /= kKeycodes) {
+                std::format_to(it, " ; {:#04x}", rest % kKeycodes);
+            }
+            std::format_to(it, " : echo sequence {}\n", n);
+            produced++;
+        } else {
+            // a brace expansion stays within one modifier combination
+            const size_t width = std::min({std::max<size_t>(shape.braceWidth, 1), shape.bindings - produced, kKeycodes - singles % kKeycodes});
+            appendModifiers(out, singles);
+            if (width == 1) {
+                std::format_to(it, "{:#04x} : echo hotkey {}\n", singles % kKeycodes, singles);
+            } else {
+                for (size_t k = 0; k < width; k++) std::format_to(it, "{}{:#04x}", k == 0 ? "{" : ", ", (singles + k) % kKeycodes);
+                out += "} : echo hotkey {";
+                for (size_t k = 0; k < width; k++) std::format_to(it, "{}{}", k == 0 ? "" : ", ", singles + k);
+                out += "}\n";
+            }
+            singles += width;
+            produced += width;
+        }
+    }
+    return out;
+}
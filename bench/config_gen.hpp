@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// synthetic configs for the benchmarks. output depends only on the arguments, so runs
+// are comparable across builds. every line is one statement that parses and interprets
+// cleanly: hotkeys, remaps, chord sequences, brace expansions and comments
+std::string generateConfigLines(size_t lines);
+std::string generateConfigBytes(size_t bytes);
+
+// the shape of a generated config for scaling runs, like one made from a template
+struct ConfigShape {
+    // bindings after brace expansion, keyboard and trackpad together
+    size_t bindings{1'000};
+    // chords in each sequence binding; 1 for no sequences
+    size_t sequenceDepth{3};
+    unsigned sequencePercent{10};
+    // keys in each brace expansion; 1 for none
+    size_t braceWidth{4};
+    // sequence leaders use the last of a define_modifier chain this long; 0 for none
+    size_t modifierDepth{8};
+    unsigned remapPercent{20};
+    unsigned tapPercent{5};
+};
+
+// the same shape always generates the same text. single-chord hotkeys and remaps get
+// distinct chords (hex keycodes under sided modifier combinations) up to 65536 of them, past
+// which they repeat; sequences start with a chord no single-chord binding uses (fn)
+std::string generateConfig(const ConfigShape& shape);
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <print>
+#include <string_view>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+std::atomic<size_t> g_liveBytes{0};
+
+// each allocation is prefixed with its size, so an unsized delete can subtract it too.
+// the prefix keeps the default new alignment
+constexpr size_t kPrefix = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+}  // namespace
+
+size_t allocationCount() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+size_t liveHeapBytes() {
+    return g_liveBytes.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto* p = static_cast<char*>(std::malloc(kPrefix + size))) {
+        *reinterpret_cast<size_t*>(p) = size;  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        g_liveBytes.fetch_add(size, std::memory_order_relaxed);
+        return p + kPrefix;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    auto* base = static_cast<char*>(p) - kPrefix;
+    g_liveBytes.fetch_sub(*reinterpret_cast<size_t*>(base), std::memory_order_relaxed);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    std::free(base);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+// usage: smhkd_bench [all|tokenizer|lookup|parse|startup|lang|input|runtime|scaling] [iterations] [--json|--csv]
+// sizes: SMHKD_BENCH_MB for the tokenizer (default 8), SMHKD_BENCH_LINES for parse and startup (default 50000).
+// scaling takes its config shape from SMHKD_BENCH_* variables, see benchScaling.
+// with --json or --csv, stdout has only the results and the readable report goes to stderr
+int main(int argc, char** argv) {
+    std::vector<std::string_view> positional;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+        if (arg == "--json") {
+            setOutputFormat(OutputFormat::Json);
+        } else if (arg == "--csv") {
+            setOutputFormat(OutputFormat::Csv);
+        } else if (arg.starts_with("--")) {
+            std::print(stderr, "unknown option '{}'\n", arg);
+            return 1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    const std::string_view suite = !positional.empty() ? positional[0] : "all";
+    const int iterations = positional.size() > 1 ? std::atoi(positional[1].data()) : 10;
+    const char* mbEnv = std::getenv("SMHKD_BENCH_MB");
+    const char* linesEnv = std::getenv("SMHKD_BENCH_LINES");
+    const size_t megabytes = mbEnv ? std::strtoul(mbEnv, nullptr, 10) : 8;
+    const size_t lines = linesEnv ? std::strtoul(linesEnv, nullptr, 10) : 50'000;
+
+    constexpr std::array kSuites{"tokenizer", "lookup", "parse", "startup", "lang", "input", "runtime", "scaling"};
+    const bool all = suite == "all";
+    if (!all && std::ranges::find(kSuites, suite) == kSuites.end()) {
+        std::print(stderr, "unknown suite '{}'\n", suite);
+        return 1;
+    }
+    if (all || suite == "parse") benchParse(lines, iterations);
+    if (all || suite == "startup") benchStartup(lines, iterations);
+    if (all || suite == "tokenizer") benchTokenizer(megabytes, iterations);
+    if (all || suite == "lookup") benchLookup(iterations);
+    if (all || suite == "lang") benchLang(iterations);
+    if (all || suite == "input") benchInput(iterations);
+    if (all || suite == "runtime") benchRuntime(iterations);
+    if (all || suite == "scaling") benchScaling(iterations);
+    printResults(iterations);
+    return 0;
+}
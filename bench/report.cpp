@@ -0,0 +1,68 @@
+#include <print>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace {
+
+struct Result {
+    std::string suite;
+    std::string name;
+    std::string metric;
+    double value;
+    std::string unit;
+};
+
+OutputFormat g_format = OutputFormat::Text;
+std::vector<Result> g_results;
+
+// bench names are plain text, but a quote or backslash would break the json
+std::string jsonString(std::string_view s) {
+    std::string out{"\""};
+    for (const char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    out += '"';
+    return out;
+}
+
+}  // namespace
+
+void setOutputFormat(OutputFormat format) {
+    g_format = format;
+}
+
+FILE* textOut() {
+    return g_format == OutputFormat::Text ? stdout : stderr;
+}
+
+void recordResult(std::string_view suite, std::string_view name, std::string_view metric, double value, std::string_view unit) {
+    g_results.push_back({std::string{suite}, std::string{name}, std::string{metric}, value, std::string{unit}});
+}
+
+void reportMicro(std::string_view suite, std::string_view name, const MicroResult& result) {
+    std::print(textOut(), "  {:<36} {:>9.1f} ns/op  (median {:.1f}, batch {})\n", name, result.minNs, result.medianNs, result.batch);
+    recordResult(suite, name, "min", result.minNs, "ns/op");
+    recordResult(suite, name, "median", result.medianNs, "ns/op");
+}
+
+void printResults(int iterations) {
+    switch (g_format) {
+        case OutputFormat::Text: return;
+        case OutputFormat::Csv:
+            std::print("suite,name,metric,value,unit\n");
+            for (const auto& r : g_results) std::print("{},{},{},{},{}\n", r.suite, r.name, r.metric, r.value, r.unit);
+            return;
+        case OutputFormat::Json:
+            std::print("{{\"iterations\": {}, \"results\": [", iterations);
+            for (size_t i = 0; i < g_results.size(); i++) {
+                const auto& r = g_results[i];
+                std::print("{}\n  {{\"suite\": {}, \"name\": {}, \"metric\": {}, \"value\": {}, \"unit\": {}}}", i == 0 ? "" : ",",
+                    jsonString(r.suite), jsonString(r.name), jsonString(r.metric), r.value, jsonString(r.unit));
+            }
+            std::print("\n]}}\n");
+            return;
+    }
+}
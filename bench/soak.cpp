@@ -0,0 +1,441 @@
+// smhkd_soak: synthetic adversarial input driven through HotkeyEngine, SafetyMonitor and
+// TapDetector with no event tap or trackpad, paced to a target event rate for as long as asked.
+// every interval it reports the event latency, resident memory, the command queue depth and
+// any safety trips. the input is all human-shaped, so every trip is a false one
+//
+// usage: smhkd_soak [--rate=<events/s>] [--duration=<s>] [--interval=<s>] [--bindings=<n>]
+//                   [--seed=<n>] [--max-rss-growth-mb=<mb>] [--exec] [--simulated] [--csv]
+// --exec keeps command actions (as `true`), so the soak forks processes and the queue depth means
+// something; otherwise actions are blanked and nothing is spawned or posted.
+// --simulated runs on a ManualTimeSource instead of sleeping, so hours of input take as long as
+// the work does; elapsed and rate are then in simulated time.
+// exits 1 on a false trip or when resident memory grows more than the limit after the first interval
+
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "config_gen.hpp"
+#include "lang/config_loader.hpp"
+#include "runtime/hotkey_engine.hpp"
+#include "runtime/safety_monitor.hpp"
+#include "runtime/stats.hpp"
+#include "runtime/tap_detector.hpp"
+#include "runtime/time_source.hpp"
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+struct Options {
+    double rate{500};
+    std::chrono::seconds duration{3600};
+    std::chrono::seconds interval{10};
+    size_t bindings{1'000};
+    uint64_t seed{1};
+    double maxRssGrowthMb{32};
+    bool exec{};
+    bool simulated{};
+    bool csv{};
+};
+
+// splitmix64, so a seed replays the same input
+class Rng {
+   public:
+    explicit Rng(uint64_t seed) : state_(seed) {}
+
+    uint64_t next() {
+        uint64_t x = state_ += 0x9e3779b97f4a7c15;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+        return x ^ (x >> 31);
+    }
+    size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+    bool percent(unsigned p) { return below(100) < p; }
+
+   private:
+    uint64_t state_;
+};
+
+struct KeyStep {
+    Chord chord;
+    CGEventType type;
+    bool isRepeat;
+};
+using FrameStep = std::vector<Touch>;
+using Step = std::variant<KeyStep, FrameStep>;
+
+// the chords a config offers the generator
+struct Targets {
+    std::vector<Chord> hits;
+    // single-chord command bindings marked repeat (&), for autorepeat floods
+    std::vector<Chord> repeats;
+    std::vector<std::vector<Chord>> sequences;
+    // held while a corner is tapped, one tap binding's each in turn
+    std::vector<ModifierFlags> tapModifiers;
+};
+
+// keycodes no generated binding uses, so these always pass through
+Chord missChord(Rng& rng) {
+    return {.keysym = {static_cast<uint32_t>(0x1000 + rng.below(64))}, .modifiers = {0}, .fingerCount = std::nullopt};
+}
+
+// refills a queue of steps one scenario at a time: fast-typist bursts, autorepeat floods,
+// sequences entered or abandoned partway, and trackpad taps with typing between frames
+class Workload {
+   public:
+    Workload(const Targets& targets, uint64_t seed) : targets_(targets), rng_(seed) {}
+
+    Step next() {
+        while (steps_.empty()) refill();
+        Step step = std::move(steps_.front());
+        steps_.pop_front();
+        return step;
+    }
+
+   private:
+    const Targets& targets_;
+    Rng rng_;
+    std::deque<Step> steps_;
+
+    void press(const Chord& chord) {
+        steps_.emplace_back(KeyStep{chord, kCGEventKeyDown, false});
+        steps_.emplace_back(KeyStep{chord, kCGEventKeyUp, false});
+    }
+
+    // mostly text with hotkeys mixed in: enough passthrough that the safety monitor should never trip
+    void burst() {
+        const size_t keys = 10 + rng_.below(30);
+        for (size_t i = 0; i < keys; i++) {
+            if (!targets_.hits.empty() && rng_.percent(25)) {
+                press(targets_.hits[rng_.below(targets_.hits.size())]);
+            } else {
+                press(missChord(rng_));
+            }
+        }
+    }
+
+    void flood() {
+        if (targets_.repeats.empty()) return burst();
+        const Chord& chord = targets_.repeats[rng_.below(targets_.repeats.size())];
+        steps_.emplace_back(KeyStep{chord, kCGEventKeyDown, false});
+        for (size_t i = 20 + rng_.below(80); i > 0; i--) steps_.emplace_back(KeyStep{chord, kCGEventKeyDown, true});
+        steps_.emplace_back(KeyStep{chord, kCGEventKeyUp, false});
+    }
+
+    void sequence() {
+        if (targets_.sequences.empty()) return burst();
+        const auto& chords = targets_.sequences[rng_.below(targets_.sequences.size())];
+        // half are abandoned after a prefix, with a stray key that resets the sequence
+        const size_t entered = rng_.percent(50) ? chords.size() : 1 + rng_.below(chords.size() - 1);
+        for (size_t i = 0; i < entered; i++) press(chords[i]);
+        if (entered < chords.size()) press(missChord(rng_));
+    }
+
+    void touch() {
+        const float x = rng_.percent(50) ? 0.03F : 0.97F;
+        const float y = rng_.percent(50) ? 0.03F : 0.97F;
+        const Touch finger{.id = 1, .x = x, .y = y};
+        steps_.emplace_back(FrameStep{finger});
+        press(missChord(rng_));
+        steps_.emplace_back(FrameStep{finger});
+        if (rng_.percent(30)) {
+            // a second finger spoils the tap
+            steps_.emplace_back(FrameStep{finger, Touch{.id = 2, .x = 0.5F, .y = 0.5F}});
+        }
+        steps_.emplace_back(FrameStep{});
+        press(missChord(rng_));
+    }
+
+    void refill() {
+        const size_t roll = rng_.below(100);
+        if (roll < 40) {
+            burst();
+        } else if (roll < 55) {
+            flood();
+        } else if (roll < 75) {
+            sequence();
+        } else {
+            touch();
+        }
+    }
+};
+
+// resident set size now, not the peak getrusage reports
+size_t residentBytes() {
+#ifdef __APPLE__
+    mach_task_basic_info_data_t info{};
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        return 0;
+    }
+    return info.resident_size;
+#else
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident = 0;
+    statm >> pages >> resident;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+size_t queueDepth() {
+    const auto& stats = runtimeStats();
+    const uint64_t run = stats.commandsRun.load(std::memory_order_relaxed);
+    const uint64_t dequeued = stats.commandsDequeued.load(std::memory_order_relaxed);
+    return run > dequeued ? static_cast<size_t>(run - dequeued) : 0;
+}
+
+double percentileUs(std::vector<int64_t>& samples, double p) {
+    if (samples.empty()) return 0;
+    const auto nth = samples.begin() + static_cast<ptrdiff_t>(p * static_cast<double>(samples.size() - 1));
+    std::ranges::nth_element(samples, nth);
+    return static_cast<double>(*nth) / 1e3;
+}
+
+struct Interval {
+    double elapsedS;
+    size_t events;
+    double rate;
+    double keyP50Us;
+    double keyP99Us;
+    double keyMaxUs;
+    double frameP99Us;
+    double rssMb;
+    size_t queueDepth;
+    size_t maxQueueDepth;
+    size_t trips;
+    // how far behind the pacing schedule the generator ended the interval
+    double lagMs;
+};
+
+void printHeader(bool csv) {
+    if (csv) {
+        std::print("elapsed_s,events,rate,key_p50_us,key_p99_us,key_max_us,frame_p99_us,rss_mb,queue_depth,max_queue_depth,trips,lag_ms\n");
+        return;
+    }
+    std::print("{:>9} {:>10} {:>8} {:>9} {:>9} {:>9} {:>9} {:>8} {:>6} {:>6} {:>5} {:>8}\n", "elapsed_s", "events", "rate",
+        "p50_us", "p99_us", "max_us", "frame_us", "rss_mb", "queue", "max_q", "trips", "lag_ms");
+}
+
+void printInterval(const Interval& r, bool csv) {
+    if (csv) {
+        std::print("{:.0f},{},{:.0f},{:.2f},{:.2f},{:.2f},{:.2f},{:.2f},{},{},{},{:.1f}\n", r.elapsedS, r.events, r.rate,
+            r.keyP50Us, r.keyP99Us, r.keyMaxUs, r.frameP99Us, r.rssMb, r.queueDepth, r.maxQueueDepth, r.trips, r.lagMs);
+        return;
+    }
+    std::print("{:>9.0f} {:>10} {:>8.0f} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f} {:>8.2f} {:>6} {:>6} {:>5} {:>8.1f}\n", r.elapsedS,
+        r.events, r.rate, r.keyP50Us, r.keyP99Us, r.keyMaxUs, r.frameP99Us, r.rssMb, r.queueDepth, r.maxQueueDepth, r.trips, r.lagMs);
+    std::fflush(stdout);
+}
+
+template <typename T>
+bool parseNumber(std::string_view text, T& out) {
+    const auto* end = text.data() + text.size();
+    const auto [ptr, ec] = std::from_chars(text.data(), end, out);
+    return ec == std::errc{} && ptr == end;
+}
+
+std::optional<Options> parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+        const auto eq = arg.find('=');
+        const auto name = arg.substr(0, eq);
+        const auto value = eq == std::string_view::npos ? std::string_view{} : arg.substr(eq + 1);
+        int64_t seconds = 0;
+        bool ok = true;
+        if (name == "--exec") {
+            options.exec = true;
+        } else if (name == "--simulated") {
+            options.simulated = true;
+        } else if (name == "--csv") {
+            options.csv = true;
+        } else if (name == "--rate") {
+            ok = parseNumber(value, options.rate) && options.rate > 0;
+        } else if (name == "--duration") {
+            ok = parseNumber(value, seconds) && seconds > 0;
+            options.duration = std::chrono::seconds(seconds);
+        } else if (name == "--interval") {
+            ok = parseNumber(value, seconds) && seconds > 0;
+            options.interval = std::chrono::seconds(seconds);
+        } else if (name == "--bindings") {
+            ok = parseNumber(value, options.bindings) && options.bindings > 0;
+        } else if (name == "--seed") {
+            ok = parseNumber(value, options.seed);
+        } else if (name == "--max-rss-growth-mb") {
+            ok = parseNumber(value, options.maxRssGrowthMb);
+        } else {
+            std::print(stderr, "unknown option '{}'\n", arg);
+            return std::nullopt;
+        }
+        if (!ok) {
+            std::print(stderr, "invalid value in '{}'\n", arg);
+            return std::nullopt;
+        }
+    }
+    return options;
+}
+
+// commands become `true` with --exec and empty otherwise. remaps are always blanked, since a
+// posted key event would reach whatever app is in front. every fourth single-chord command
+// binding is marked repeat
+Targets prepareBindings(ConfigLoadResult& config, bool exec) {
+    const auto command = [&] { return BindingAction{std::string{exec ? "true" : ""}}; };
+    Targets targets;
+    size_t commands = 0;
+    for (auto& binding : config.bindings) {
+        const bool isCommand = std::holds_alternative<std::string>(binding.action);
+        binding.action = isCommand ? command() : BindingAction{std::string{}};
+        const auto& chords = binding.source.chords;
+        if (chords.size() > 1) {
+            targets.sequences.push_back(chords);
+        } else if (isCommand && commands++ % 4 == 0) {
+            binding.source.repeat = true;
+            targets.repeats.push_back(chords[0]);
+        } else {
+            targets.hits.push_back(chords[0]);
+        }
+    }
+    for (auto& tap : config.tapBindings) {
+        tap.action = command();
+        targets.tapModifiers.push_back(tap.modifiers);
+    }
+    return targets;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const auto parsed = parseOptions(argc, argv);
+    if (!parsed) return 2;
+    const Options& options = *parsed;
+
+    auto config = ConfigLoader::loadFromContents(generateConfig({.bindings = options.bindings}));
+    const Targets targets = prepareBindings(config, options.exec);
+    ManualTimeSource simulated;
+    HotkeyEngine engine(options.simulated ? static_cast<const TimeSource&>(simulated) : steadyTimeSource());
+    engine.applyConfig(std::move(config.bindings), std::move(config.tapBindings), {});
+    SafetyMonitor safety;
+    TapDetector taps;
+    taps.setConfig({.cornerSizePct = 15, .tapTimeoutMs = 300});
+    Workload workload(targets, options.seed);
+
+    if (!options.csv) {
+        std::print("soak: {} bindings ({} hotkeys, {} repeat, {} sequences), {:.0f} events/s for {}s, seed {}\n",
+            options.bindings, targets.hits.size(), targets.repeats.size(), targets.sequences.size(), options.rate,
+            options.duration.count(), options.seed);
+    }
+    printHeader(options.csv);
+
+    const auto start = clock::now();
+    const auto end = start + options.duration;
+    const auto period = std::chrono::duration<double>(1.0 / options.rate);
+    std::vector<int64_t> keyNs;
+    std::vector<int64_t> frameNs;
+    keyNs.reserve(static_cast<size_t>(options.rate * static_cast<double>(options.interval.count())) + 1);
+    frameNs.reserve(keyNs.capacity() / 4);
+
+    std::vector<Interval> intervals;
+    size_t totalTrips = 0;
+    size_t trips = 0;
+    size_t maxQueue = 0;
+    uint64_t event = 0;
+    size_t tapsSeen = 0;
+    auto intervalStart = start;
+    auto intervalEvents = event;
+    while (true) {
+        const auto due = start + std::chrono::duration_cast<clock::duration>(period * static_cast<double>(event));
+        auto now = options.simulated ? due : clock::now();
+        if (due > now) {
+            std::this_thread::sleep_until(due);
+            now = clock::now();
+        }
+        const int64_t eventNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+        simulated.set(eventNs);
+
+        if (now - intervalStart >= options.interval || now >= end) {
+            const double seconds = std::chrono::duration<double>(now - intervalStart).count();
+            Interval r{
+                .elapsedS = std::chrono::duration<double>(now - start).count(),
+                .events = static_cast<size_t>(event - intervalEvents),
+                .rate = static_cast<double>(event - intervalEvents) / seconds,
+                .keyP50Us = percentileUs(keyNs, 0.5),
+                .keyP99Us = percentileUs(keyNs, 0.99),
+                .keyMaxUs = percentileUs(keyNs, 1),
+                .frameP99Us = percentileUs(frameNs, 0.99),
+                .rssMb = static_cast<double>(residentBytes()) / (1024.0 * 1024.0),
+                .queueDepth = queueDepth(),
+                .maxQueueDepth = maxQueue,
+                .trips = trips,
+                .lagMs = std::chrono::duration<double, std::milli>(now - due).count(),
+            };
+            printInterval(r, options.csv);
+            intervals.push_back(r);
+            keyNs.clear();
+            frameNs.clear();
+            totalTrips += trips;
+            trips = 0;
+            maxQueue = 0;
+            intervalStart = now;
+            intervalEvents = event;
+            if (now >= end) break;
+        }
+
+        const Step step = workload.next();
+        const auto stepStart = clock::now();
+        if (const auto* key = std::get_if<KeyStep>(&step)) {
+            const bool consumed = engine.handleEvent(key->chord, key->type, key->isRepeat, 0, eventNs);
+            if (safety.recordEvent(key->type == kCGEventKeyDown, consumed, key->chord.keysym.keycode, now) ==
+                SafetyMonitor::Action::Trip) {
+                trips++;
+                safety.reset();
+            }
+            keyNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - stepStart).count());
+        } else {
+            const auto zone = taps.onFrame(std::get<FrameStep>(step), eventNs);
+            if (zone && !targets.tapModifiers.empty()) {
+                (void)engine.handleTap(*zone, targets.tapModifiers[tapsSeen++ % targets.tapModifiers.size()]);
+            }
+            frameNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - stepStart).count());
+        }
+        maxQueue = std::max(maxQueue, queueDepth());
+        event++;
+    }
+
+    // the first interval holds the warmup: config load, allocator growth, the samples' reserve
+    const Interval& first = intervals.front();
+    const Interval& last = intervals.back();
+    const double rssGrowthMb = last.rssMb - first.rssMb;
+    const double drift = first.keyP99Us > 0 ? last.keyP99Us / first.keyP99Us : 1;
+    std::print(stderr, "summary: {} events, {} false trips, rss {:+.2f} MB since the first interval, key p99 drift x{:.2f}\n",
+        event, totalTrips, rssGrowthMb, drift);
+
+    bool failed = false;
+    if (totalTrips > 0) {
+        std::print(stderr, "FAIL: the safety monitor tripped {} times on human-shaped input\n", totalTrips);
+        failed = true;
+    }
+    if (intervals.size() > 1 && rssGrowthMb > options.maxRssGrowthMb) {
+        std::print(stderr, "FAIL: resident memory grew {:.2f} MB, over the {:.0f} MB limit\n", rssGrowthMb, options.maxRssGrowthMb);
+        failed = true;
+    }
+    return failed ? 1 : 0;
+}
@@ -1,15 +1,52 @@
 #include "application.hpp"
 
+#include <unistd.h>
+
 #include <array>
 #include <csignal>
+#include <format>
+#include <ranges>
+#include <string_view>
+
+#ifndef SMHKD_VERSION
+#define SMHKD_VERSION "unknown"
+#endif
 
 #include "../common/log.hpp"
+#include "../lang/interpreter.hpp"
+#include "../lang/parser.hpp"
+#include "../runtime/stats.hpp"
+
+namespace {
+
+// a key spec, as for -k, or the errors that make it invalid
+std::optional<Chord> parseKeySpec(std::string_view spec, std::vector<std::string>& errors) {
+    Parser parser{std::string{spec}};
+    auto chord = parser.parseChord();
+    for (const auto& parse_error : parser.errors()) {
+        errors.push_back(std::format("invalid key spec at column {}: {}", parse_error.col, parse_error.message));
+    }
+    if (!chord) return std::nullopt;
+    auto result = interpretChord(*chord);
+    for (const auto& interpreter_error : result.errors) {
+        errors.push_back(std::format("invalid key spec: {}", interpreter_error.message));
+    }
+    return result.chord;
+}
+
+}  // namespace
 
 Application* Application::instance_ = nullptr;
 
-Application::Application(std::filesystem::path configFile) : configFile_(std::move(configFile)) {}
+Application::Application(std::filesystem::path configFile, std::optional<std::chrono::milliseconds> watchDebounce,
+    std::optional<uint16_t> metricsPort)
+    : configFile_(std::move(configFile)), watchDebounce_(watchDebounce), metricsPort_(metricsPort) {}
 
 Application::~Application() {
+    // the watcher thread writes to the reload pipe
+    watcher_.reset();
+    controlServer_.reset();
+    metricsServer_.reset();
     for (int fd : reloadSignalPipe_) {
         if (fd != -1) {
             close(fd);
@@ -36,15 +73,35 @@ void Application::run() {
     installSignalHandlers();
     setupReloadSignalSource(CFRunLoopGetCurrent());
     setupQuitSignalSource(CFRunLoopGetCurrent());
+    setupControlServer(CFRunLoopGetCurrent());
+    if (watchDebounce_) {
+        watcher_ = std::make_unique<ConfigWatcher>(configFile_, *watchDebounce_, [this] { requestReload(); });
+        if (!watcher_->start()) {
+            warn("not watching the config file, reload with -r");
+            watcher_.reset();
+        }
+    }
+    if (metricsPort_) {
+        metricsServer_ = std::make_unique<MetricsServer>(*metricsPort_);
+        if (!metricsServer_->start()) metricsServer_.reset();
+    }
     keyHandler_->run();
 }
 
 void Application::sigusr1Handler(int /*signal*/) {
-    if (!instance_ || instance_->reloadSignalPipe_[1] == -1) {
+    if (!instance_) {
+        return;
+    }
+    instance_->requestReload();
+}
+
+// async-signal-safe: called from the SIGUSR1 handler and the watcher thread
+void Application::requestReload() const {
+    if (reloadSignalPipe_[1] == -1) {
         return;
     }
     const char byte = '\n';
-    const ssize_t result = write(instance_->reloadSignalPipe_[1], &byte, sizeof(byte));
+    const ssize_t result = write(reloadSignalPipe_[1], &byte, sizeof(byte));
     (void)result;
 }
 
@@ -116,8 +173,8 @@ void Application::handleReloadSignal(CFFileDescriptorRef fd) {
     while (read(reloadSignalPipe_[0], buffer.data(), buffer.size()) > 0) {
     }
 
-    debug("SIGUSR1 received, reloading config");
-    keyHandler_->reload();
+    debug("reload requested, reloading config");
+    (void)keyHandler_->reload();
     CFFileDescriptorEnableCallBacks(fd, kCFFileDescriptorReadCallBack);
 }
 
@@ -176,3 +233,85 @@ void Application::handleQuitSignal() {
     debug("termination signal received, stopping run loop");
     CFRunLoopStop(CFRunLoopGetCurrent());
 }
+
+void Application::setupControlServer(CFRunLoopRef runLoop) {
+    const auto path = control::socketPath();
+    if (!path) {
+        warn("no control socket: no private directory for it under the cache dir");
+        return;
+    }
+    controlServer_ = std::make_unique<ControlServer>(*path, [this](const control::Request& request) {
+        return handleControl(request);
+    });
+    if (!controlServer_->start(runLoop)) {
+        controlServer_.reset();
+    }
+}
+
+control::Response Application::handleControl(const control::Request& request) {
+    debug("control request: {} {}", control::commandName(request.command), request.argument);
+    switch (request.command) {
+        case control::Command::Reload: {
+            auto errors = keyHandler_->reload();
+            return {.ok = errors.empty(), .lines = std::move(errors)};
+        }
+        case control::Command::Status: {
+            const auto status = keyHandler_->status();
+            const auto uptime = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - startTime_);
+            return {.lines = {
+                        std::format("pid {}", getpid()),
+                        std::format("version {}", SMHKD_VERSION),
+                        std::format("config {}", status.configFile.string()),
+                        std::format("mode {}", status.passthrough ? "passthrough" : "default"),
+                        std::format("bindings {}", status.bindings),
+                        std::format("trackpad_bindings {}", status.trackpadBindings),
+                        std::format("uptime_seconds {}", uptime.count()),
+                    }};
+        }
+        case control::Command::Stats: {
+            control::Response response;
+            for (const auto& [name, value] : snapshot(runtimeStats())) {
+                response.lines.push_back(std::format("{} {}", name, value));
+            }
+            return response;
+        }
+        case control::Command::Trigger: {
+            std::vector<std::string> errors;
+            const auto chord = parseKeySpec(request.argument, errors);
+            if (!chord) return {.ok = false, .lines = std::move(errors)};
+            if (!keyHandler_->trigger(*chord)) {
+                return {.ok = false, .lines = {std::format("no binding for '{}'", request.argument)}};
+            }
+            return {};
+        }
+        case control::Command::Mode: {
+            if (request.argument != "default" && request.argument != "passthrough") {
+                return {.ok = false, .lines = {std::format("unknown mode '{}', expected default or passthrough", request.argument)}};
+            }
+            keyHandler_->setPassthrough(request.argument == "passthrough");
+            info("switched to {} mode", request.argument);
+            return {};
+        }
+        case control::Command::Key: {
+            // all or nothing: one bad spec in a batch posts none of them
+            std::vector<std::string> errors;
+            std::vector<Chord> chords;
+            for (const auto spec : control::splitKeySpecs(request.argument)) {
+                if (auto chord = parseKeySpec(spec, errors)) chords.push_back(*chord);
+            }
+            if (chords.empty() && errors.empty()) errors.emplace_back("empty key spec");
+            if (!errors.empty()) return {.ok = false, .lines = std::move(errors)};
+            keyHandler_->pressKeys(chords);
+            return {};
+        }
+        case control::Command::Metrics: {
+            control::Response response;
+            const auto text = formatPrometheus(runtimeStats());
+            for (const auto line : std::views::split(std::string_view{text}, '\n')) {
+                if (!line.empty()) response.lines.emplace_back(std::string_view{line});
+            }
+            return response;
+        }
+    }
+    return {.ok = false};
+}
@@ -1,14 +1,23 @@
 #pragma once
 
 #include <array>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <memory>
+#include <optional>
 
+#include "../runtime/config_watcher.hpp"
+#include "../runtime/control_server.hpp"
 #include "../runtime/key_handler.hpp"
+#include "../runtime/metrics.hpp"
 
 class Application {
    public:
-    explicit Application(std::filesystem::path configFile);
+    // with a debounce, the config file is watched and reloaded on change; with a port,
+    // metrics are served over HTTP on 127.0.0.1
+    Application(std::filesystem::path configFile, std::optional<std::chrono::milliseconds> watchDebounce,
+        std::optional<uint16_t> metricsPort);
     ~Application();
     Application(const Application&) = delete;
     Application& operator=(const Application&) = delete;
@@ -23,7 +32,14 @@ class Application {
     };
 
     std::filesystem::path configFile_;
+    std::optional<std::chrono::milliseconds> watchDebounce_;
+    std::optional<uint16_t> metricsPort_;
     std::unique_ptr<KeyHandler> keyHandler_;
+    // reloads go through the reload pipe, so they run on the run loop like SIGUSR1's
+    std::unique_ptr<ConfigWatcher> watcher_;
+    std::unique_ptr<ControlServer> controlServer_;
+    std::unique_ptr<MetricsServer> metricsServer_;
+    std::chrono::steady_clock::time_point startTime_ = std::chrono::steady_clock::now();
     ReloadContext reloadContext_{};
     std::array<int, 2> reloadSignalPipe_ = {-1, -1};
     std::array<int, 2> quitSignalPipe_ = {-1, -1};
@@ -35,9 +51,12 @@ class Application {
     static void reloadSignalCallback(CFFileDescriptorRef fd, CFOptionFlags callbackTypes, void* info);
     static void quitSignalCallback(CFFileDescriptorRef fd, CFOptionFlags callbackTypes, void* info);
 
+    void requestReload() const;
     void installSignalHandlers() const;
     void setupReloadSignalSource(CFRunLoopRef runLoop);
     void setupQuitSignalSource(CFRunLoopRef runLoop);
     void handleReloadSignal(CFFileDescriptorRef fd);
     void handleQuitSignal();
+    void setupControlServer(CFRunLoopRef runLoop);
+    control::Response handleControl(const control::Request& request);
 };
@@ -1,7 +1,18 @@
+#include <CoreFoundation/CoreFoundation.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <optional>
 #include <print>
 #include <span>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <variant>
 #include <vector>
 
 #ifndef SMHKD_VERSION
@@ -15,10 +26,15 @@
 #include "../lang/config_loader.hpp"
 #include "../lang/interpreter.hpp"
 #include "../lang/parser.hpp"
+#include "../runtime/config_watcher.hpp"
+#include "../runtime/control.hpp"
 #include "../runtime/hotkey_engine.hpp"
 #include "../runtime/key_observer_handler.hpp"
+#include "../runtime/output_scheduler.hpp"
 #include "../runtime/process.hpp"
 #include "../runtime/service.hpp"
+#include "../runtime/touch_handler.hpp"
+#include "../runtime/touch_recording.hpp"
 #include "application.hpp"
 #include "cli.hpp"
 
@@ -49,13 +65,143 @@ Chord parseCliKeypress(std::string_view spec) {
     return *result.chord;
 }
 
-std::filesystem::path parseArguments(std::span<char* const> argv) {
+// the running daemon already has the keycode map and parser warm, so it parses and posts
+// the keys and this process only connects, sends and exits. without one, press them here
+void sendKeys(std::string specs) {
+    // the request is a single line
+    std::ranges::replace(specs, '\n', ';');
+    if (const auto socket = control::socketPath()) {
+        if (const auto response = control::send(*socket, {.command = control::Command::Key, .argument = specs})) {
+            for (const auto& line : response->lines) {
+                error(line);
+            }
+            if (!response->ok) {
+                fatal("invalid key spec");
+            }
+            return;
+        }
+    }
+
+    if (!initializeKeycodeMap()) {
+        fatal("failed to initialize keycode map");
+    }
+    std::vector<Chord> chords;
+    for (const auto spec : control::splitKeySpecs(specs)) {
+        chords.push_back(parseCliKeypress(spec));
+    }
+    if (chords.empty()) {
+        fatal("empty key spec");
+    }
+    // the process exits next, so wait for the output thread to get everything out
+    OutputScheduler output(HotkeyEngine::postEvent);
+    output.enqueuePresses(chords);
+    output.drain();
+}
+
+std::atomic<bool> g_stopRecording{false};
+
+// record raw trackpad frames until interrupted
+void recordTouch(const std::filesystem::path& path) {
+    TouchRecorder recorder;
+    if (!recorder.open(path)) {
+        fatal("failed to open {} for writing", path.string());
+    }
+    std::signal(SIGINT, [](int) { g_stopRecording.store(true); });
+    std::signal(SIGTERM, [](int) { g_stopRecording.store(true); });
+
+    touch::setRecorder(&recorder);
+    touch::start();
+    info("recording touch frames to {}, press ctrl-c to stop", path.string());
+    while (!g_stopRecording.load()) {
+        CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.25, false);
+    }
+    touch::stop();
+    touch::setRecorder(nullptr);
+    recorder.close();
+    info("recorded {} frames", recorder.framesWritten());
+}
+
+void printDuration(std::string_view label, int64_t ns) {
+    std::print("  {:<5} {:>9.3f} us\n", label, static_cast<double>(ns) / 1000.0);
+}
+
+// replay a recording through the detectors using the config's tap settings and zones
+void replayTouch(const std::filesystem::path& path, const std::filesystem::path& configFile) {
+    auto recording = loadTouchRecording(path);
+    if (recording.error) {
+        if (recording.frames.empty()) fatal("{}: {}", path.string(), *recording.error);
+        warn("{}: {}", path.string(), *recording.error);
+    }
+
+    const auto loaded = ConfigLoader::loadFromFile(configFile);
+    const auto& config = loaded.config;
+    const int tapTimeoutMs = static_cast<int>(config.tapTimeout.count());
+    auto zones = loaded.tapRegions.empty() ? nullptr : std::make_shared<const ZoneMap>(loaded.tapRegions);
+    const auto pressThreshold = static_cast<float>(config.pressThreshold);
+    const auto report = replayTouchFrames(recording.frames,
+        {.cornerSizePct = config.cornerSize, .tapTimeoutMs = tapTimeoutMs, .zones = zones},
+        {.tapTimeoutMs = tapTimeoutMs},
+        {.pressThreshold = pressThreshold,
+            .releaseThreshold = pressThreshold * PressDetector::kReleaseRatio,
+            .cornerSizePct = config.cornerSize,
+            .zones = zones});
+
+    for (const auto& event : report.events) {
+        const std::string trigger = std::visit(
+            [](const auto& t) -> std::string {
+                if constexpr (std::is_same_v<std::decay_t<decltype(t)>, Zone>) {
+                    return std::format("trackpad_tap({})", zoneName(t));
+                } else {
+                    return std::format("{}", t);
+                }
+            },
+            event.trigger);
+        std::print("{:>12.3f} ms  device {}  {:<24} latency {:.1f} ms\n",
+            static_cast<double>(event.timeNs) / 1e6, event.device, trigger, static_cast<double>(event.latencyNs) / 1e6);
+    }
+    std::print("{} frames, {} events\nper-frame processing:\n", report.frames, report.events.size());
+    printDuration("mean", report.frameProcessing.meanNs);
+    printDuration("p50", report.frameProcessing.p50Ns);
+    printDuration("p99", report.frameProcessing.p99Ns);
+    printDuration("max", report.frameProcessing.maxNs);
+}
+
+struct LaunchOptions {
+    std::filesystem::path configFile;
+    // nullopt with --no-watch
+    std::optional<std::chrono::milliseconds> watchDebounce;
+    // nullopt unless --metrics-port is given
+    std::optional<uint16_t> metricsPort;
+};
+
+std::chrono::milliseconds parseDebounce(std::string_view value) {
+    int ms = -1;
+    const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), ms);
+    if (ec != std::errc{} || end != value.data() + value.size() || ms < 0) {
+        fatal("invalid debounce '{}', expected milliseconds", value);
+    }
+    return std::chrono::milliseconds{ms};
+}
+
+uint16_t parseMetricsPort(std::string_view value) {
+    uint16_t port = 0;
+    const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), port);
+    if (ec != std::errc{} || end != value.data() + value.size() || port == 0) {
+        fatal("invalid metrics port '{}'", value);
+    }
+    return port;
+}
+
+LaunchOptions parseArguments(std::span<char* const> argv) {
     cli::Config config{
         .short_args = {"c:", "k:", "r", "o", "v"},
         .long_args = {
             "config:",
             "key:",
             "reload",
+            "no-watch",
+            "debounce:",
+            "metrics-port:",
             "observe",
             "verbose",
             "install-service",
@@ -64,6 +210,8 @@ std::filesystem::path parseArguments(std::span<char* const> argv) {
             "stop-service",
             "restart-service",
             "dump-ast",
+            "record-touch:",
+            "replay-touch:",
             "version",
         },
     };
@@ -82,12 +230,16 @@ std::filesystem::path parseArguments(std::span<char* const> argv) {
         exit(0);
     }
 
-    if (auto keySpec = args.get('k', "key")) {
-        const Chord chord = parseCliKeypress(*keySpec);
-        HotkeyEngine::synthesizeKeyPress(chord);
+    if (auto keySpecs = args.get('k', "key")) {
+        sendKeys(*keySpecs);
         exit(0);
     }
 
+    // after -k, which hands the work to the daemon when one is running
+    if (!initializeKeycodeMap()) {
+        fatal("failed to initialize keycode map");
+    }
+
     if (args.get("install-service")) {
         service::install();
         exit(0);
@@ -122,9 +274,28 @@ std::filesystem::path parseArguments(std::span<char* const> argv) {
         exit(0);
     }
 
+    if (auto path = args.get("record-touch")) {
+        recordTouch(*path);
+        exit(0);
+    }
+
     if (args.get('r', "reload")) {
-        pid_t pid = readPidFile();
-        if (pid) kill(pid, SIGUSR1);
+        // a daemon without the control socket (an older build) still reloads on SIGUSR1, but can't report errors
+        const auto socket = control::socketPath();
+        const auto response = socket ? control::send(*socket, {.command = control::Command::Reload}) : std::nullopt;
+        if (!response) {
+            pid_t pid = readPidFile();
+            if (pid) kill(pid, SIGUSR1);
+            info("config reload requested");
+            exit(0);
+        }
+        for (const auto& line : response->lines) {
+            warn(line);
+        }
+        if (!response->ok) {
+            error("config has errors, the daemon kept its previous config");
+            exit(1);
+        }
         info("config reloaded");
         exit(0);
     }
@@ -136,8 +307,13 @@ std::filesystem::path parseArguments(std::span<char* const> argv) {
 
     ensureConfigFile(config_file);
 
+    if (auto path = args.get("replay-touch")) {
+        replayTouch(*path, config_file);
+        exit(0);
+    }
+
     if (args.get("dump-ast")) {
-        auto result = ConfigLoader::loadFromFile(config_file);
+        auto result = ConfigLoader::loadFromFile(config_file, {.keepProgram = true});
         if (result.fileError) {
             warn("config error: {}", *result.fileError);
         }
@@ -151,7 +327,15 @@ std::filesystem::path parseArguments(std::span<char* const> argv) {
         exit(0);
     }
 
-    return config_file;
+    std::optional<std::chrono::milliseconds> watchDebounce;
+    if (!args.get("no-watch")) {
+        watchDebounce = args.get("debounce").transform(parseDebounce).value_or(ConfigWatcher::kDefaultDebounce);
+    }
+    return {
+        .configFile = config_file,
+        .watchDebounce = watchDebounce,
+        .metricsPort = args.get("metrics-port").transform(parseMetricsPort),
+    };
 }
 
 }  // namespace
@@ -161,11 +345,7 @@ int main(int argc, char* argv[]) {
         fatal("running as root is not allowed");
     }
 
-    if (!initializeKeycodeMap()) {
-        fatal("failed to initialize keycode map");
-    }
-
-    const std::filesystem::path config_file = parseArguments(std::span<char* const>(argv, static_cast<size_t>(argc)));
+    const auto options = parseArguments(std::span<char* const>(argv, static_cast<size_t>(argc)));
 
     createPidFile();
 
@@ -173,6 +353,6 @@ int main(int argc, char* argv[]) {
         fatal("must run with accessibility access");
     }
 
-    Application app(config_file);
+    Application app(options.configFile, options.watchDebounce, options.metricsPort);
     app.run();
 }
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// little-endian fixed-width encoding for on-disk formats. every supported target is
+// little-endian, so values are copied as-is and the assert keeps that honest
+static_assert(std::endian::native == std::endian::little, "binary formats assume a little-endian host");
+
+class ByteWriter {
+   public:
+    template <typename T>
+        requires std::is_arithmetic_v<T>
+    void put(T value) {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        buf_.append(bytes, sizeof(T));
+    }
+
+    void putBytes(std::string_view bytes) { buf_.append(bytes); }
+
+    [[nodiscard]] const std::string& bytes() const { return buf_; }
+    [[nodiscard]] size_t size() const { return buf_.size(); }
+    void clear() { buf_.clear(); }
+
+   private:
+    std::string buf_;
+};
+
+// reads from a borrowed buffer; a short read sets failed() and yields zero from then on
+class ByteReader {
+   public:
+    explicit ByteReader(std::string_view data) : data_(data) {}
+
+    template <typename T>
+        requires std::is_arithmetic_v<T>
+    T get() {
+        T value{};
+        if (failed_ || data_.size() - pos_ < sizeof(T)) {
+            failed_ = true;
+            return value;
+        }
+        std::memcpy(&value, data_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+    std::string_view getBytes(size_t n) {
+        if (failed_ || data_.size() - pos_ < n) {
+            failed_ = true;
+            return {};
+        }
+        auto bytes = data_.substr(pos_, n);
+        pos_ += n;
+        return bytes;
+    }
+
+    [[nodiscard]] bool failed() const { return failed_; }
+    [[nodiscard]] bool atEnd() const { return pos_ == data_.size(); }
+    [[nodiscard]] size_t offset() const { return pos_; }
+    [[nodiscard]] size_t remaining() const { return data_.size() - pos_; }
+
+   private:
+    std::string_view data_;
+    size_t pos_{};
+    bool failed_{};
+};
@@ -10,11 +10,12 @@
 
 namespace {
 
-void spawnCommand(const std::string& command) {
+void spawnCommand(const std::string& command, void (*onForkFailure)()) {
     pid_t cpid = fork();
 
     if (cpid < 0) {
         warn("failed to fork process for command execution");
+        if (onForkFailure) onForkFailure();
         return;
     }
 
@@ -38,11 +39,12 @@ void spawnCommand(const std::string& command) {
 
 }  // namespace
 
-void executeCommand(std::string command) {
+void executeCommand(std::string command, void (*onForkFailure)(), void (*onDequeued)()) {
     // run the fork/exec on a background queue so event tap thread is never blocked by fork
     // capture command by value so it outlives this call (the block runs later)
     dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0),
         ^{
-          spawnCommand(command);
+          if (onDequeued) onDequeued();
+          spawnCommand(command, onForkFailure);
         });
 }
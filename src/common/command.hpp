@@ -2,4 +2,6 @@
 
 #include <string>
 
-void executeCommand(std::string command);
+// runs on a background queue; onForkFailure (if any) is called there when no process could be created.
+// onDequeued (if any) is called there first, so a caller can tell how many commands are still queued
+void executeCommand(std::string command, void (*onForkFailure)() = nullptr, void (*onDequeued)() = nullptr);
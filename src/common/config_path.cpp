@@ -1,10 +1,12 @@
 #include "config_path.hpp"
 
 #include <pwd.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <cstdlib>
 #include <filesystem>
+#include <system_error>
 
 #include "log.hpp"
 
@@ -59,3 +61,26 @@ std::optional<std::filesystem::path> getConfigFile(const std::string& name) {
 
     return {};
 }
+
+std::optional<std::filesystem::path> getCacheDir(const std::string& name) {
+    char* xdgCache = getenv("XDG_CACHE_HOME");
+    if (xdgCache && *xdgCache) {
+        return std::filesystem::path{xdgCache} / name;
+    }
+
+    auto home = getHome();
+    if (!home) return {};
+    return *home / ".cache" / name;
+}
+
+std::optional<std::filesystem::path> getPrivateDir(const std::string& name) {
+    auto dir = getCacheDir(name);
+    if (!dir) return {};
+    std::error_code ec;
+    std::filesystem::create_directories(*dir, ec);
+    struct stat info {};
+    // lstat, so a symlink in its place is refused rather than followed
+    if (lstat(dir->c_str(), &info) != 0 || !S_ISDIR(info.st_mode) || info.st_uid != getuid()) return {};
+    if ((info.st_mode & 077) != 0 && chmod(dir->c_str(), 0700) != 0) return {};
+    return dir;
+}
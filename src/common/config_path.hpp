@@ -7,3 +7,10 @@
 void ensureConfigFile(const std::filesystem::path& configFile);
 
 [[nodiscard]] std::optional<std::filesystem::path> getConfigFile(const std::string& name);
+
+// $XDG_CACHE_HOME/<name>, else ~/.cache/<name>. not created here
+[[nodiscard]] std::optional<std::filesystem::path> getCacheDir(const std::string& name);
+
+// getCacheDir(name), created if missing and made 0700; nullopt unless it is a directory this
+// user owns, so nothing placed there can be reached or planted by another user
+[[nodiscard]] std::optional<std::filesystem::path> getPrivateDir(const std::string& name);
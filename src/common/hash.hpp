@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// 64-bit FNV-1a. not collision resistant, but fast enough to run over a whole config on
+// every load, and stable across runs and builds so it can key files on disk
+inline constexpr uint64_t kFnvOffset = 0xCBF29CE484222325ULL;
+inline constexpr uint64_t kFnvPrime = 0x100000001B3ULL;
+
+constexpr uint64_t fnv1a64(std::string_view bytes, uint64_t hash = kFnvOffset) {
+    for (const char c : bytes) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+// a collision-free string -> index table built at compile time from a fixed key list.
+// the seed is searched for during constant evaluation, so a lookup is a few byte loads,
+// two multiplies, one slot load and one string compare. slots are 4x the key count rounded
+// up to a power of two, which keeps the search to a few dozen seeds for the tables here
+template <size_t N>
+class PerfectHash {
+   public:
+    static constexpr size_t kSlots = std::bit_ceil(N * 4);
+    static_assert(N < 0xFF, "slot indices are stored in a byte");
+
+    consteval explicit PerfectHash(const std::array<std::string_view, N>& keys) : keys_(keys) {
+        for (uint32_t seed = 1; seed < 100'000; seed++) {
+            if (tryBuild(seed)) return;
+        }
+        throw "no perfect hash seed found; grow kSlots";
+    }
+
+    [[nodiscard]] constexpr std::optional<size_t> find(std::string_view key) const {
+        const uint8_t idx = slots_[slot(seed_, key)];
+        if (idx == kEmpty || keys_[idx] != key) return std::nullopt;
+        return idx;
+    }
+
+    [[nodiscard]] constexpr uint32_t seed() const { return seed_; }
+
+   private:
+    static constexpr uint8_t kEmpty = 0xFF;
+
+    // hashes only the length and the first, middle and last bytes, which already tell every
+    // key in these tables apart; the seed search fails at compile time if a new key breaks that
+    static constexpr size_t slot(uint32_t seed, std::string_view key) {
+        uint32_t h = static_cast<uint32_t>(key.size());
+        if (!key.empty()) {
+            h |= static_cast<uint32_t>(static_cast<uint8_t>(key.front())) << 8;
+            h |= static_cast<uint32_t>(static_cast<uint8_t>(key[key.size() / 2])) << 16;
+            h |= static_cast<uint32_t>(static_cast<uint8_t>(key.back())) << 24;
+        }
+        // murmur3 finalizer, so every seed bit reaches the masked low bits
+        h ^= seed * 0x9E3779B1U;
+        h ^= h >> 16;
+        h *= 0x85EBCA6BU;
+        h ^= h >> 13;
+        return h & (kSlots - 1);
+    }
+
+    constexpr bool tryBuild(uint32_t seed) {
+        slots_.fill(kEmpty);
+        for (size_t i = 0; i < N; i++) {
+            const size_t s = slot(seed, keys_[i]);
+            if (slots_[s] != kEmpty) return false;
+            slots_[s] = static_cast<uint8_t>(i);
+        }
+        seed_ = seed;
+        return true;
+    }
+
+    std::array<std::string_view, N> keys_;
+    std::array<uint8_t, kSlots> slots_{};
+    uint32_t seed_{};
+};
+
+// build a PerfectHash over the `name` member of each entry of a constexpr table
+template <typename Entry, size_t N>
+consteval PerfectHash<N> perfectHashOfNames(const std::array<Entry, N>& entries) {
+    std::array<std::string_view, N> names{};
+    for (size_t i = 0; i < N; i++) {
+        names[i] = entries[i].name;
+    }
+    return PerfectHash<N>{names};
+}
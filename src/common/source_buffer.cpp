@@ -0,0 +1,71 @@
+#include "source_buffer.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <utility>
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept
+    : owned_(std::move(other.owned_)),
+      mapped_(std::exchange(other.mapped_, nullptr)),
+      mappedSize_(std::exchange(other.mappedSize_, 0)) {}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept {
+    if (this != &other) {
+        if (mapped_) munmap(mapped_, mappedSize_);
+        owned_ = std::move(other.owned_);
+        mapped_ = std::exchange(other.mapped_, nullptr);
+        mappedSize_ = std::exchange(other.mappedSize_, 0);
+    }
+    return *this;
+}
+
+SourceBuffer::~SourceBuffer() {
+    if (mapped_) munmap(mapped_, mappedSize_);
+}
+
+SourceLoad loadSource(const std::filesystem::path& path) {
+    SourceLoad result;
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        result.error = std::format("failed to open config file '{}': {}", path.string(), std::strerror(errno));
+        return result;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        const auto size = static_cast<size_t>(st.st_size);
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            close(fd);
+            result.buffer.mapped_ = mapped;
+            result.buffer.mappedSize_ = size;
+            return result;
+        }
+    }
+
+    // not mappable: read it in, sized up front when the file reports a size
+    std::string contents;
+    if (st.st_size > 0) contents.reserve(static_cast<size_t>(st.st_size));
+    std::array<char, 64 * 1024> chunk{};
+    while (true) {
+        const ssize_t n = read(fd, chunk.data(), chunk.size());
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            result.error = std::format("failed to read config file '{}': {}", path.string(), std::strerror(errno));
+            break;
+        }
+        contents.append(chunk.data(), static_cast<size_t>(n));
+    }
+    close(fd);
+    result.buffer = SourceBuffer{std::move(contents)};
+    return result;
+}
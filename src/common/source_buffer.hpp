@@ -0,0 +1,43 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+struct SourceLoad;
+// a file truncated in place while mapped would fault on access, but editors replace
+// config files by rename, and the mapping is only held while a load is parsed
+SourceLoad loadSource(const std::filesystem::path& path);
+
+// the bytes of a config source. files are mapped read-only, so the tokenizer, parser and
+// interpreter all read the page cache directly; anything that cannot be mapped (pipes,
+// empty files, failed mappings) is read into an owned string instead
+class SourceBuffer {
+   public:
+    SourceBuffer() = default;
+    explicit SourceBuffer(std::string owned) : owned_(std::move(owned)) {}
+    SourceBuffer(SourceBuffer&& other) noexcept;
+    SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    ~SourceBuffer();
+
+    [[nodiscard]] std::string_view view() const {
+        if (mapped_) return {static_cast<const char*>(mapped_), mappedSize_};
+        return owned_;
+    }
+    [[nodiscard]] bool isMapped() const { return mapped_ != nullptr; }
+
+   private:
+    friend SourceLoad loadSource(const std::filesystem::path& path);
+
+    std::string owned_;
+    void* mapped_{};
+    size_t mappedSize_{};
+};
+
+struct SourceLoad {
+    SourceBuffer buffer;
+    std::optional<std::string> error;
+};
@@ -4,5 +4,10 @@ bool Chord::isActivatedBy(const Chord& eventInput, int liveFingerCount) const {
     if (fingerCount.has_value() && *fingerCount != liveFingerCount) {
         return false;
     }
+    if (keysym.wildcard != KeyClass::None) {
+        // media keys share keycodes with the layout's keys, so no class takes them
+        return modifiers.isActivatedBy(eventInput.modifiers) && !eventInput.modifiers.has(Hotkey_Flag_NX)
+            && keyClassContains(keysym.wildcard, eventInput.keysym.keycode);
+    }
     return modifiers.isActivatedBy(eventInput.modifiers) && this->keysym == eventInput.keysym;
 }
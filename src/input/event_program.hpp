@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chord.hpp"
+
+// the key events a remap posts when it can't just rewrite the event it came from (a macro, typed
+// text, the target of a sequence), compiled once when the config is interpreted. firing the binding
+// hands the same program to the output thread, with nothing left to build
+struct KeyEvent {
+    // the wait before the event, after the one posted before it
+    enum class Pause : uint8_t {
+        None,
+        // between the events of a synthesized press, see OutputScheduler::kPressGap
+        Press,
+        // at the start of each burst of typed text, its share of the type_rate
+        Burst,
+    };
+
+    uint16_t keycode;
+    // hotkey modifier flags (see modifier.hpp), which all fit in 16 bits
+    uint16_t flags;
+    // the event's unicode string as a slice of the program's text, empty for none
+    uint16_t textOffset;
+    uint8_t textLength;
+    bool keyDown;
+    Pause pause;
+
+    bool operator==(const KeyEvent&) const = default;
+};
+
+static_assert(sizeof(KeyEvent) == 10);
+
+inline KeyEvent keyEventFor(const Chord& chord, bool keyDown, KeyEvent::Pause pause) {
+    return {
+        .keycode = static_cast<uint16_t>(chord.keysym.keycode),
+        .flags = static_cast<uint16_t>(chord.modifiers.flags),
+        .textOffset = 0,
+        .textLength = 0,
+        .keyDown = keyDown,
+        .pause = pause,
+    };
+}
+
+inline Chord chordOf(const KeyEvent& event) {
+    return {.keysym = {event.keycode}, .modifiers = {event.flags}, .fingerCount = std::nullopt};
+}
+
+struct EventProgram {
+    std::vector<KeyEvent> events;
+    // the unicode strings of typed text no key of the layout types
+    std::u16string text;
+
+    [[nodiscard]] std::u16string_view textOf(const KeyEvent& event) const {
+        return std::u16string_view{text}.substr(event.textOffset, event.textLength);
+    }
+
+    bool operator==(const EventProgram&) const = default;
+};
+
+// typed text goes out this many keys at a time
+inline constexpr size_t kTypeBurst = 8;
+// a keyboard event carries at most this many UTF-16 units of unicode string
+inline constexpr size_t kMaxEventText = 20;
@@ -0,0 +1,28 @@
+#include "gesture.hpp"
+
+std::optional<GestureKind> parseSwipeDirection(std::string_view name) {
+    if (name == "left") return GestureKind::SwipeLeft;
+    if (name == "right") return GestureKind::SwipeRight;
+    if (name == "up") return GestureKind::SwipeUp;
+    if (name == "down") return GestureKind::SwipeDown;
+    return std::nullopt;
+}
+
+std::optional<GestureKind> parsePinchDirection(std::string_view name) {
+    if (name == "in") return GestureKind::PinchIn;
+    if (name == "out") return GestureKind::PinchOut;
+    return std::nullopt;
+}
+
+const char* gestureDirectionName(GestureKind kind) {
+    switch (kind) {
+        case GestureKind::SwipeLeft: return "left";
+        case GestureKind::SwipeRight: return "right";
+        case GestureKind::SwipeUp: return "up";
+        case GestureKind::SwipeDown: return "down";
+        case GestureKind::PinchIn: return "in";
+        case GestureKind::PinchOut: return "out";
+        case GestureKind::Tap: return "tap";
+    }
+    return "?";
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <compare>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+
+enum class GestureKind {
+    SwipeLeft,
+    SwipeRight,
+    SwipeUp,
+    SwipeDown,
+    PinchIn,
+    PinchOut,
+    Tap,
+};
+
+// a multi-finger trackpad gesture: an N-finger swipe, pinch, or tap
+struct Gesture {
+    GestureKind kind;
+    int fingers;
+
+    std::strong_ordering operator<=>(const Gesture& other) const = default;
+};
+
+// fewest and most fingers a gesture binding may ask for
+constexpr int kMinGestureFingers = 2;
+constexpr int kMaxGestureFingers = 5;
+
+std::optional<GestureKind> parseSwipeDirection(std::string_view name);
+std::optional<GestureKind> parsePinchDirection(std::string_view name);
+const char* gestureDirectionName(GestureKind kind);
+
+template <>
+struct std::formatter<Gesture> : std::formatter<std::string_view> {
+    auto format(const Gesture& g, std::format_context& ctx) const {
+        switch (g.kind) {
+            case GestureKind::SwipeLeft:
+            case GestureKind::SwipeRight:
+            case GestureKind::SwipeUp:
+            case GestureKind::SwipeDown:
+                return std::format_to(ctx.out(), "trackpad_swipe({}, {})", g.fingers, gestureDirectionName(g.kind));
+            case GestureKind::PinchIn:
+            case GestureKind::PinchOut:
+                return std::format_to(ctx.out(), "trackpad_pinch({}, {})", g.fingers, gestureDirectionName(g.kind));
+            case GestureKind::Tap:
+                return std::format_to(ctx.out(), "trackpad_tap({})", g.fingers);
+        }
+        return ctx.out();
+    }
+};
@@ -1,15 +1,22 @@
 #include "keysym.hpp"
 
+#include <cctype>
+
+#include "../common/perfect_hash.hpp"
 #include "../input/modifier.hpp"
 
+namespace {
+
+constexpr auto literal_key_index = perfectHashOfNames(literal_keys);
+
+}  // namespace
+
 uint32_t literalKeyToKeycode(LiteralKey k) {
     return literal_keys[static_cast<size_t>(k)].keycode;
 }
 
-std::optional<LiteralKey> parseLiteralKey(const std::string& name) {
-    for (size_t i = 0; i < literal_keys.size(); i++) {
-        if (literal_keys[i].name == name) return static_cast<LiteralKey>(i);
-    }
+std::optional<LiteralKey> parseLiteralKey(std::string_view name) {
+    if (auto i = literal_key_index.find(name)) return static_cast<LiteralKey>(*i);
     return std::nullopt;
 }
 
@@ -32,3 +39,19 @@ uint32_t getKeycode(char key) {
 
     return static_cast<uint32_t>(static_cast<unsigned char>(key));
 }
+
+std::optional<KeyClass> parseKeyClass(std::string_view name) {
+    for (size_t i = 1; i < key_class_names.size(); i++) {
+        if (key_class_names[i] == name) return static_cast<KeyClass>(i);
+    }
+    return std::nullopt;
+}
+
+bool keyClassContains(KeyClass keyClass, uint32_t keycode) {
+    if (keyClass == KeyClass::None) return false;
+    if (keyClass == KeyClass::Any) return true;
+    const auto key = lookupKeyString(keycode);
+    if (!key || key->size() != 1) return false;
+    const auto c = static_cast<unsigned char>(key->front());
+    return keyClass == KeyClass::Letter ? std::isalpha(c) != 0 : std::isdigit(c) != 0;
+}
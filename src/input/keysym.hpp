@@ -5,14 +5,34 @@
 
 #include <array>
 #include <compare>
+#include <cstdint>
 #include <format>
 #include <optional>
 #include <string>
+#include <string_view>
 
 #include "locale.hpp"
 
+// a wildcard key, written key(any), key(letter) or key(digit): it stands for any key whose character
+// on the current layout is in the class, and the key pressed is captured for the binding's command
+enum class KeyClass : uint8_t {
+    None,
+    Any,
+    Letter,
+    Digit,
+};
+
+constexpr std::array<std::string_view, 4> key_class_names = {"", "any", "letter", "digit"};
+
+std::optional<KeyClass> parseKeyClass(std::string_view name);
+
+// whether the key with this keycode is in the class; None holds no key
+bool keyClassContains(KeyClass keyClass, uint32_t keycode);
+
 struct Keysym {
     uint32_t keycode;
+    // set for a wildcard, whose keycode is then unused
+    KeyClass wildcard{KeyClass::None};
     std::strong_ordering operator<=>(const Keysym& other) const = default;
 };
 
@@ -105,7 +125,7 @@ struct std::formatter<LiteralKey> : std::formatter<std::string_view> {
 
 uint32_t literalKeyToKeycode(LiteralKey k);
 
-std::optional<LiteralKey> parseLiteralKey(const std::string& name);
+std::optional<LiteralKey> parseLiteralKey(std::string_view name);
 
 int getImplicitFlags(LiteralKey k);
 
@@ -115,6 +135,9 @@ uint32_t getKeycode(char key);
 template <>
 struct std::formatter<Keysym> : std::formatter<std::string_view> {
     auto format(const Keysym& k, std::format_context& ctx) const {
+        if (k.wildcard != KeyClass::None) {
+            return std::format_to(ctx.out(), "key({})", key_class_names[static_cast<size_t>(k.wildcard)]);
+        }
         if (auto key = lookupKeyString(k.keycode)) {
             return std::format_to(ctx.out(), "{}", *key);
         }
@@ -2,15 +2,63 @@
 
 #include <Carbon/Carbon.h>
 
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <functional>
+#include <memory>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "../common/cf_string.hpp"
+#include "../common/hash.hpp"
 
 namespace {
 
-std::unordered_map<std::string, Keycode> buildKeycodeMap() {
-    std::unordered_map<std::string, Keycode> keycodeMap;
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+
+// every layout-dependent keycode (kVK_ANSI_*) is below 0x80
+constexpr Keycode kMaxLayoutKeycode = 0x80;
+
+struct KeycodeMap {
+    // transparent lookup so a string_view key never allocates
+    std::unordered_map<std::string, Keycode, StringHash, std::equal_to<>> byString;
+    // reverse table indexed by keycode; empty where the layout produced no character
+    std::array<std::string, kMaxLayoutKeycode> byKeycode;
+    // every character some key types, with the fewest modifiers that do
+    std::unordered_map<char16_t, CharacterKey> byCharacter;
+};
+
+// the modifier states tried for byCharacter, fewest modifiers first so a plain key wins
+constexpr std::array<std::pair<bool, bool>, 4> kTypingModifiers = {{{false, false}, {true, false}, {false, true}, {true, true}}};
+
+void addCharacterKeys(KeycodeMap& keycodeMap, const UCKeyboardLayout* keyboardLayout) {
+    std::array<UniChar, 4> chars{};
+    UniCharCount len{};
+    for (const auto [shift, option] : kTypingModifiers) {
+        const UInt32 modifierState = ((shift ? shiftKey : 0) | (option ? optionKey : 0)) >> 8;
+        for (Keycode keycode = 0; keycode < kMaxLayoutKeycode; keycode++) {
+            UInt32 state{};
+            if (UCKeyTranslate(keyboardLayout, keycode, kUCKeyActionDown, modifierState, LMGetKbdType(), 0, &state,
+                    chars.size(), &len, chars.data())
+                    != noErr
+                || state != 0 || len != 1) {
+                continue;
+            }
+            // control characters other than return and tab come from keys like escape and the arrows
+            const char16_t character = chars[0];
+            if (character < 0x20 && character != '\r' && character != '\t') continue;
+            keycodeMap.byCharacter.try_emplace(character, CharacterKey{.keycode = keycode, .shift = shift, .option = option});
+        }
+    }
+}
+
+KeycodeMap buildKeycodeMap() {
+    KeycodeMap keycodeMap;
 
     static const std::array<uint32_t, 36> layoutDependentKeycodes = {
         kVK_ANSI_A, kVK_ANSI_B, kVK_ANSI_C, kVK_ANSI_D, kVK_ANSI_E,
@@ -60,15 +108,17 @@ std::unordered_map<std::string, Keycode> buildKeycodeMap() {
             CFRelease(keyCfString);
 
             if (!keyString.empty()) {
-                keycodeMap[keyString] = keycode;
+                keycodeMap.byKeycode.at(keycode) = keyString;
+                keycodeMap.byString[std::move(keyString)] = keycode;
             }
         }
     }
 
+    addCharacterKeys(keycodeMap, keyboardLayout);
     return keycodeMap;
 }
 
-const std::unordered_map<std::string, Keycode>& keycodeMap() {
+const KeycodeMap& keycodeMap() {
     static const auto map = buildKeycodeMap();
     return map;
 }
@@ -76,21 +126,51 @@ const std::unordered_map<std::string, Keycode>& keycodeMap() {
 }  // namespace
 
 bool initializeKeycodeMap() {
-    return !keycodeMap().empty();
+    return !keycodeMap().byString.empty();
 }
 
 std::optional<Keycode> lookupKeycode(std::string_view key) {
-    if (const auto it = keycodeMap().find(std::string{key}); it != keycodeMap().end()) {
+    const auto& byString = keycodeMap().byString;
+    if (const auto it = byString.find(key); it != byString.end()) {
         return it->second;
     }
     return std::nullopt;
 }
 
-std::optional<std::string> lookupKeyString(Keycode keycode) {
-    for (const auto& [key, code] : keycodeMap()) {
-        if (code == keycode) {
-            return key;
-        }
+std::optional<std::string_view> lookupKeyString(Keycode keycode) {
+    if (keycode >= kMaxLayoutKeycode) return std::nullopt;
+    const std::string& key = keycodeMap().byKeycode[keycode];
+    if (key.empty()) return std::nullopt;
+    return key;
+}
+
+std::optional<CharacterKey> lookupCharacterKey(char16_t character) {
+    if (character == '\n') character = '\r';
+    const auto& byCharacter = keycodeMap().byCharacter;
+    if (const auto it = byCharacter.find(character); it != byCharacter.end()) {
+        return it->second;
     }
     return std::nullopt;
 }
+
+uint64_t keycodeMapFingerprint() {
+    static const uint64_t fingerprint = [] {
+        uint64_t hash = kFnvOffset;
+        for (const auto& key : keycodeMap().byKeycode) {
+            // the separator keeps {"ab", ""} and {"a", "b"} apart
+            hash = fnv1a64(key, hash);
+            hash = fnv1a64(std::string_view{"\0", 1}, hash);
+        }
+        // typed text is planned against the character table, which shifted keys can change alone.
+        // its entries in character order, since the map's own order isn't stable
+        std::vector<std::pair<char16_t, CharacterKey>> characters(keycodeMap().byCharacter.begin(), keycodeMap().byCharacter.end());
+        std::ranges::sort(characters, {}, &std::pair<char16_t, CharacterKey>::first);
+        for (const auto& [character, key] : characters) {
+            const uint64_t packed = uint64_t{character} << 32 | key.keycode << 2 | (key.shift ? 1U : 0U) | (key.option ? 2U : 0U);
+            const auto bytes = std::bit_cast<std::array<char, sizeof(packed)>>(packed);
+            hash = fnv1a64(std::string_view{bytes.data(), bytes.size()}, hash);
+        }
+        return hash;
+    }();
+    return fingerprint;
+}
@@ -2,6 +2,7 @@
 
 // based off of: https://github.com/koekeishiya/skhd/blob/2c9d3b9c9440797cd80856b6a54ec8817a6f3d19/src/locale.c#L88
 
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -10,4 +11,18 @@ using Keycode = uint32_t;
 
 bool initializeKeycodeMap();
 std::optional<Keycode> lookupKeycode(std::string_view key);
-std::optional<std::string> lookupKeyString(Keycode keycode);
+std::optional<std::string_view> lookupKeyString(Keycode keycode);
+
+// the key, and whether shift and/or option, that type a character on the current layout
+struct CharacterKey {
+    Keycode keycode;
+    bool shift;
+    bool option;
+};
+// a UTF-16 unit outside the surrogates; a newline comes back as the return key. dead keys and
+// characters only they produce have no entry
+std::optional<CharacterKey> lookupCharacterKey(char16_t character);
+
+// identifies the key map built for the current layout; anything compiled against
+// lookupKeycode (e.g. the config cache) is stale once this changes
+uint64_t keycodeMapFingerprint();
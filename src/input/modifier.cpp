@@ -1,6 +1,11 @@
 #include "modifier.hpp"
+
+#include "../common/perfect_hash.hpp"
+
 namespace {
 
+constexpr auto builtin_modifier_index = perfectHashOfNames(builtin_modifiers);
+
 int eventLrFlagsToHotkeyFlags(CGEventFlags eventFlags, const LRModifierGroup& group) {
     int flags{};
     if ((eventFlags & group.cgevent_generic) == group.cgevent_generic) {
@@ -19,10 +24,8 @@ int builtinModifierToFlags(BuiltinModifier m) {
     return builtin_modifiers[static_cast<size_t>(m)].flag;
 }
 
-std::optional<BuiltinModifier> parseBuiltinModifier(const std::string& name) {
-    for (size_t i = 0; i < builtin_modifiers.size(); i++) {
-        if (builtin_modifiers[i].name == name) return static_cast<BuiltinModifier>(i);
-    }
+std::optional<BuiltinModifier> parseBuiltinModifier(std::string_view name) {
+    if (auto i = builtin_modifier_index.find(name)) return static_cast<BuiltinModifier>(*i);
     return std::nullopt;
 }
 
@@ -6,6 +6,7 @@
 #include <format>
 #include <optional>
 #include <string>
+#include <string_view>
 
 enum HotkeyFlag {
     Hotkey_Flag_Alt = (1 << 0),
@@ -93,7 +94,7 @@ struct std::formatter<BuiltinModifier> : std::formatter<std::string_view> {
     }
 };
 
-std::optional<BuiltinModifier> parseBuiltinModifier(const std::string& name);
+std::optional<BuiltinModifier> parseBuiltinModifier(std::string_view name);
 
 struct ModifierFlags {
     int flags;
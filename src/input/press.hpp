@@ -0,0 +1,35 @@
+#pragma once
+
+#include <compare>
+#include <format>
+#include <optional>
+
+#include "zone.hpp"
+
+// a hard (force) press on the trackpad: one finger in a zone, or N fingers anywhere.
+// the same shape describes both a binding's trigger and a detected press
+struct Press {
+    std::optional<Zone> zone;
+    int fingers;
+
+    std::strong_ordering operator<=>(const Press& other) const = default;
+
+    // whether a detected press fires this trigger
+    [[nodiscard]] bool triggeredBy(const Press& event) const {
+        if (zone) return event.fingers == 1 && event.zone == zone;
+        return event.fingers == fingers;
+    }
+};
+
+// most fingers a trackpad_press(N) binding may ask for
+constexpr int kMaxPressFingers = 5;
+
+template <>
+struct std::formatter<Press> : std::formatter<std::string_view> {
+    auto format(const Press& p, std::format_context& ctx) const {
+        if (p.zone) {
+            return std::format_to(ctx.out(), "trackpad_press({})", zoneName(*p.zone));
+        }
+        return std::format_to(ctx.out(), "trackpad_press({})", p.fingers);
+    }
+};
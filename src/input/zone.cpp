@@ -1,10 +1,18 @@
 #include "zone.hpp"
 
-std::optional<Zone> parseZone(const std::string& name) {
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+std::optional<Zone> parseZone(std::string_view name) {
     if (name == "tl") return Zone::TopLeft;
     if (name == "tr") return Zone::TopRight;
     if (name == "bl") return Zone::BottomLeft;
     if (name == "br") return Zone::BottomRight;
+    if (name == "top_edge") return Zone::TopEdge;
+    if (name == "bottom_edge") return Zone::BottomEdge;
+    if (name == "left_edge") return Zone::LeftEdge;
+    if (name == "right_edge") return Zone::RightEdge;
     return std::nullopt;
 }
 
@@ -14,8 +22,12 @@ const char* zoneName(Zone zone) {
         case Zone::TopRight: return "tr";
         case Zone::BottomLeft: return "bl";
         case Zone::BottomRight: return "br";
+        case Zone::TopEdge: return "top_edge";
+        case Zone::BottomEdge: return "bottom_edge";
+        case Zone::LeftEdge: return "left_edge";
+        case Zone::RightEdge: return "right_edge";
     }
-    return "?";
+    return isRegionZone(zone) ? "region" : "?";
 }
 
 std::optional<Zone> classifyZone(float x, float y, int cornerSizePct) {
@@ -31,3 +43,59 @@ std::optional<Zone> classifyZone(float x, float y, int cornerSizePct) {
     if (bottom && right) return Zone::BottomRight;
     return std::nullopt;
 }
+
+ZoneRect builtinZoneRect(Zone zone, int cornerSizePct) {
+    const int s = std::clamp(cornerSizePct, 0, 100);
+    switch (zone) {
+        case Zone::TopLeft: return {0, 100 - s, s, 100};
+        case Zone::TopRight: return {100 - s, 100 - s, 100, 100};
+        case Zone::BottomLeft: return {0, 0, s, s};
+        case Zone::BottomRight: return {100 - s, 0, 100, s};
+        case Zone::TopEdge: return {0, 100 - s, 100, 100};
+        case Zone::BottomEdge: return {0, 0, 100, s};
+        case Zone::LeftEdge: return {0, 0, s, 100};
+        case Zone::RightEdge: return {100 - s, 0, 100, 100};
+    }
+    return {0, 0, 0, 0};
+}
+
+ZoneMap::ZoneMap(const std::vector<TapRegion>& regions) {
+    // the interpreter caps define_region at kMaxRegions, so the built-ins and regions always fit
+    assert(regions.size() <= kMaxMapZones);
+    cells_.assign(static_cast<size_t>(kResolution) * kResolution, 0);
+
+    // paint largest first so smaller regions overwrite them; among equal areas the
+    // earlier region is painted last so it wins
+    std::vector<size_t> order(regions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::sort(order, [&](size_t a, size_t b) {
+        const int areaA = regions[a].rect.area();
+        const int areaB = regions[b].rect.area();
+        return areaA != areaB ? areaA > areaB : a > b;
+    });
+
+    for (size_t idx : order) {
+        const ZoneRect& r = regions[idx].rect;
+        zones_.push_back(regions[idx].zone);
+        const auto cell = static_cast<uint8_t>(zones_.size());
+        for (int y = std::max(r.y0, 0); y < std::min(r.y1, kResolution); y++) {
+            for (int x = std::max(r.x0, 0); x < std::min(r.x1, kResolution); x++) {
+                cells_[static_cast<size_t>(y * kResolution + x)] = cell;
+            }
+        }
+    }
+}
+
+std::optional<Zone> ZoneMap::classify(float x, float y) const {
+    if (cells_.empty()) return std::nullopt;
+    const int cx = std::clamp(static_cast<int>(x * kResolution), 0, kResolution - 1);
+    const int cy = std::clamp(static_cast<int>(y * kResolution), 0, kResolution - 1);
+    const uint8_t cell = cells_[static_cast<size_t>(cy * kResolution + cx)];
+    if (cell == 0) return std::nullopt;
+    return zones_[cell - 1];
+}
+
+std::optional<Zone> classifyZone(const ZoneMap* zones, float x, float y, int cornerSizePct) {
+    if (zones) return zones->classify(x, y);
+    return classifyZone(x, y, cornerSizePct);
+}
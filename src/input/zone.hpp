@@ -1,18 +1,85 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
-enum class Zone {
+// a trackpad area a tap can land in. the named values are built in; user regions from
+// define_region are numbered from kFirstRegionZone in definition order
+enum class Zone : uint16_t {
     TopLeft,
     TopRight,
     BottomLeft,
     BottomRight,
+    TopEdge,
+    BottomEdge,
+    LeftEdge,
+    RightEdge,
 };
 
-std::optional<Zone> parseZone(const std::string& name);
+inline constexpr uint16_t kFirstRegionZone = 16;
+// zones one ZoneMap can tell apart, since each cell holds a zone's index in a byte
+inline constexpr size_t kMaxMapZones = 255;
+// define_region names a config may have, leaving room in the map for every built-in zone
+inline constexpr size_t kMaxRegions = kMaxMapZones - (static_cast<size_t>(Zone::RightEdge) + 1);
+
+inline Zone regionZone(size_t index) {
+    return static_cast<Zone>(kFirstRegionZone + index);
+}
+
+inline bool isRegionZone(Zone zone) {
+    return static_cast<uint16_t>(zone) >= kFirstRegionZone;
+}
+
+std::optional<Zone> parseZone(std::string_view name);
 const char* zoneName(Zone zone);
 
 // classify a normalized (0..1) trackpad position into a corner zone
 // origin is bottom-left: y=1 is the top edge, y=0 the bottom, x=1 the right
 std::optional<Zone> classifyZone(float x, float y, int cornerSizePct);
+
+// a rectangle in whole percents of each trackpad axis, bottom-left origin,
+// covering [x0, x1) by [y0, y1)
+struct ZoneRect {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+
+    [[nodiscard]] int area() const { return (x1 - x0) * (y1 - y0); }
+    bool operator==(const ZoneRect&) const = default;
+};
+
+// corners are cornerSizePct squares, edges are full-length strips cornerSizePct deep
+ZoneRect builtinZoneRect(Zone zone, int cornerSizePct);
+
+struct TapRegion {
+    Zone zone;
+    ZoneRect rect;
+};
+
+// precomputed uniform grid over the trackpad, one cell per percent on each axis, so
+// classifying a point is a single lookup however many regions are configured.
+// where regions overlap the smaller one wins, ties going to the earlier region
+class ZoneMap {
+   public:
+    static constexpr int kResolution = 100;
+
+    ZoneMap() = default;
+    // at most kMaxMapZones regions
+    explicit ZoneMap(const std::vector<TapRegion>& regions);
+
+    [[nodiscard]] std::optional<Zone> classify(float x, float y) const;
+    [[nodiscard]] bool empty() const { return zones_.empty(); }
+
+   private:
+    std::vector<Zone> zones_;
+    // index into zones_ plus one, 0 for no zone. row-major from the bottom-left cell
+    std::vector<uint8_t> cells_;
+};
+
+// zone under a position using a config's zone map, or the four corners when there is none
+std::optional<Zone> classifyZone(const ZoneMap* zones, float x, float y, int cornerSizePct);
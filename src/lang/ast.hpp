@@ -1,31 +1,57 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <format>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
+#include "../common/source_buffer.hpp"
+#include "../input/gesture.hpp"
 #include "../input/keysym.hpp"
 #include "../input/modifier.hpp"
+#include "../input/press.hpp"
 #include "../input/zone.hpp"
 
 namespace ast {
 
+// node lists allocate from the program's arena when built by the parser. names and
+// strings are views into the program's source (or into the arena, for unescaped strings)
+template <typename T>
+using List = std::pmr::vector<T>;
+
 struct Modifier {
-    std::variant<BuiltinModifier, std::string> value;
+    std::variant<BuiltinModifier, std::string_view> value;
 };
 
 struct DefineModifier {
-    std::string name;
-    std::vector<Modifier> parts;
+    std::string_view name;
+    List<Modifier> parts;
+};
+
+enum class RegionShape {
+    // rect(x0, y0, x1, y1): corners in percent, bottom-left origin
+    Rect,
+    // grid(cols, rows, col, row): one cell of an even grid, col 0 left, row 0 top
+    Grid,
+};
+
+struct DefineRegion {
+    std::string_view name;
+    RegionShape shape;
+    std::array<int, 4> args;
 };
 
 struct ConfigProperty {
-    std::string name;
+    std::string_view name;
     std::optional<int> intValue;
-    std::optional<std::string> stringValue;
-    std::vector<std::string> stringListValues;
+    std::optional<std::string_view> stringValue;
+    List<std::string_view> stringListValues;
 };
 
 struct KeyChar {
@@ -38,10 +64,15 @@ struct SimpleKeysym {
 };
 
 struct BraceExpansionKeysym {
-    std::vector<SimpleKeysym> alternatives;
+    List<SimpleKeysym> alternatives;
+};
+
+// key(class): any key in the class, captured into the binding's command
+struct WildcardKeysym {
+    KeyClass keyClass;
 };
 
-using Keysym = std::variant<SimpleKeysym, BraceExpansionKeysym>;
+using Keysym = std::variant<SimpleKeysym, BraceExpansionKeysym, WildcardKeysym>;
 
 inline bool isBrace(const Keysym& k) {
     return std::holds_alternative<BraceExpansionKeysym>(k);
@@ -52,35 +83,91 @@ inline const BraceExpansionKeysym* asBrace(const Keysym& k) {
 inline const SimpleKeysym* asSimple(const Keysym& k) {
     return std::get_if<SimpleKeysym>(&k);
 }
+inline const WildcardKeysym* asWildcard(const Keysym& k) {
+    return std::get_if<WildcardKeysym>(&k);
+}
+
+// trackpad_press(zone), trackpad_press(region:name), or trackpad_press(N)
+struct PressTrigger {
+    std::optional<Zone> zone;
+    // a define_region name, resolved by the interpreter
+    std::optional<std::string_view> region;
+    int fingers{1};
+};
 
 struct Chord {
-    std::vector<Modifier> modifiers;
+    List<Modifier> modifiers;
     std::optional<Keysym> key;
     std::optional<int> fingerCount;
     std::optional<Zone> tap;
+    // trackpad_tap(region:name) for a define_region name, resolved by the interpreter
+    std::optional<std::string_view> tapRegion;
+    std::optional<Gesture> gesture;
+    std::optional<PressTrigger> press;
 };
 
+// whether the chord has its key or one of the trackpad triggers in key position
+inline bool hasTrigger(const Chord& c) {
+    return c.key || c.tap || c.tapRegion || c.gesture || c.press;
+}
+
 struct Chords {
     bool passthrough{};
     bool repeat{};
     bool onRelease{};
-    std::vector<Chord> sequence;
+    List<Chord> sequence;
 };
 
 struct Hotkey {
     Chords chords;
-    std::string command;
+    std::string_view command;
 };
 
 struct Remap {
     Chords source;
     Chord target;
+    // the chords after target, ';' separated: the remap is then a macro typing each in turn
+    List<Chord> macro;
+    // a quoted string in place of the target chord, for the remap to type
+    std::optional<std::string_view> text;
 };
 
-using Stmt = std::variant<DefineModifier, ConfigProperty, Hotkey, Remap>;
+using Stmt = std::variant<DefineModifier, DefineRegion, ConfigProperty, Hotkey, Remap>;
+
+// the source text the AST points into and the arena its lists allocate from. heap-allocated
+// so both stay put when the program is moved
+struct ProgramStorage {
+    SourceBuffer source;
+    std::pmr::monotonic_buffer_resource arena;
 
+    explicit ProgramStorage(SourceBuffer text)
+        : source(std::move(text)), arena(std::max<size_t>(source.view().size(), 4096)) {}
+};
+
+// a parsed config. dropping it releases every node with one arena release
 struct Program {
-    std::vector<Stmt> statements;
+    // declared first so it outlives the statements that point into it
+    std::unique_ptr<ProgramStorage> storage;
+    List<Stmt> statements;
+    // source text of each statement, from its first token to its last
+    List<std::string_view> sources;
+
+    Program() = default;
+    explicit Program(std::unique_ptr<ProgramStorage> owned)
+        : storage(std::move(owned)), statements(&storage->arena), sources(&storage->arena) {}
+    Program(Program&&) noexcept = default;
+    Program(const Program&) = delete;
+    Program& operator=(const Program&) = delete;
+    // move-assigning a pmr vector across arenas would copy every node out of the arena;
+    // rebuilding in place takes the other program's arena along instead
+    Program& operator=(Program&& other) noexcept {
+        if (this != &other) {
+            std::destroy_at(this);
+            std::construct_at(this, std::move(other));
+        }
+        return *this;
+    }
+    ~Program() = default;
 };
 
 }  // namespace ast
@@ -137,6 +224,9 @@ struct std::formatter<ast::Keysym> : std::formatter<std::string_view> {
             }
             return std::format_to(out, "}}");
         }
+        if (const auto* wildcard = ast::asWildcard(ks)) {
+            return std::format_to(ctx.out(), "key({})", key_class_names[static_cast<size_t>(wildcard->keyClass)]);
+        }
         return ctx.out();
     }
 };
@@ -157,6 +247,17 @@ struct std::formatter<ast::Chord> : std::formatter<std::string_view> {
         if (cs.tap) {
             return std::format_to(out, "trackpad_tap({})", zoneName(*cs.tap));
         }
+        if (cs.tapRegion) {
+            return std::format_to(out, "trackpad_tap(region:{})", *cs.tapRegion);
+        }
+        if (cs.gesture) {
+            return std::format_to(out, "{}", *cs.gesture);
+        }
+        if (cs.press) {
+            if (cs.press->zone) return std::format_to(out, "trackpad_press({})", zoneName(*cs.press->zone));
+            if (cs.press->region) return std::format_to(out, "trackpad_press(region:{})", *cs.press->region);
+            return std::format_to(out, "trackpad_press({})", cs.press->fingers);
+        }
         return std::format_to(out, "<missing-key>");
     }
 };
@@ -189,6 +290,15 @@ struct std::formatter<ast::DefineModifier> : std::formatter<std::string_view> {
     }
 };
 
+template <>
+struct std::formatter<ast::DefineRegion> : std::formatter<std::string_view> {
+    auto format(const ast::DefineRegion& stmt, std::format_context& ctx) const {
+        const auto& a = stmt.args;
+        return std::format_to(ctx.out(), "define_region: {} = {}({}, {}, {}, {})", stmt.name,
+            stmt.shape == ast::RegionShape::Rect ? "rect" : "grid", a[0], a[1], a[2], a[3]);
+    }
+};
+
 template <>
 struct std::formatter<ast::ConfigProperty> : std::formatter<std::string_view> {
     auto format(const ast::ConfigProperty& stmt, std::format_context& ctx) const {
@@ -221,7 +331,10 @@ struct std::formatter<ast::Hotkey> : std::formatter<std::string_view> {
 template <>
 struct std::formatter<ast::Remap> : std::formatter<std::string_view> {
     auto format(const ast::Remap& stmt, std::format_context& ctx) const {
-        return std::format_to(ctx.out(), "remap: {} | {}", stmt.source, stmt.target);
+        if (stmt.text) return std::format_to(ctx.out(), "remap: {} | \"{}\"", stmt.source, *stmt.text);
+        auto out = std::format_to(ctx.out(), "remap: {} | {}", stmt.source, stmt.target);
+        for (const auto& chord : stmt.macro) out = std::format_to(out, "; {}", chord);
+        return out;
     }
 };
 
@@ -0,0 +1,356 @@
+#include "config_cache.hpp"
+
+#include <unistd.h>
+
+#include <format>
+#include <fstream>
+#include <memory>
+#include <system_error>
+#include <type_traits>
+#include <variant>
+
+#include "../common/config_path.hpp"
+#include "../common/hash.hpp"
+#include "../common/source_buffer.hpp"
+#include "../input/locale.hpp"
+
+#ifndef SMHKD_BUILD_ID
+#define SMHKD_BUILD_ID "unknown"
+#endif
+
+namespace {
+
+// a hash of the sources that decide what a config compiles to, computed by CMake, so a cache
+// written by any other build of them, release or not, is ignored
+constexpr std::string_view kBuildId = SMHKD_BUILD_ID;
+
+void putString(ByteWriter& out, std::string_view s) {
+    out.put<uint32_t>(static_cast<uint32_t>(s.size()));
+    out.putBytes(s);
+}
+
+void putChord(ByteWriter& out, const Chord& chord) {
+    out.put<uint32_t>(chord.keysym.keycode);
+    out.put<uint8_t>(static_cast<uint8_t>(chord.keysym.wildcard));
+    out.put<int32_t>(chord.modifiers.flags);
+    out.put<uint8_t>(chord.fingerCount ? 1 : 0);
+    out.put<int32_t>(chord.fingerCount.value_or(0));
+}
+
+void putProgram(ByteWriter& out, const EventProgram& program) {
+    out.put<uint32_t>(static_cast<uint32_t>(program.events.size()));
+    for (const auto& event : program.events) {
+        out.put<uint16_t>(event.keycode);
+        out.put<uint16_t>(event.flags);
+        out.put<uint16_t>(event.textOffset);
+        out.put<uint8_t>(event.textLength);
+        out.put<uint8_t>(event.keyDown ? 1 : 0);
+        out.put<uint8_t>(static_cast<uint8_t>(event.pause));
+    }
+    out.put<uint32_t>(static_cast<uint32_t>(program.text.size()));
+    for (const char16_t unit : program.text) out.put<uint16_t>(unit);
+}
+
+void putAction(ByteWriter& out, const BindingAction& action) {
+    out.put<uint8_t>(static_cast<uint8_t>(action.index()));
+    std::visit([&](const auto& a) {
+        using T = std::decay_t<decltype(a)>;
+        if constexpr (std::is_same_v<T, Chord>) {
+            putChord(out, a);
+        } else if constexpr (std::is_same_v<T, KeyProgram>) {
+            putProgram(out, *a.program);
+        } else {
+            putString(out, a);
+        }
+    },
+        action);
+}
+
+void putHotkey(ByteWriter& out, const Hotkey& hotkey) {
+    out.put<uint8_t>(static_cast<uint8_t>((hotkey.passthrough ? 1 : 0) | (hotkey.repeat ? 2 : 0) | (hotkey.on_release ? 4 : 0)));
+    out.put<uint32_t>(static_cast<uint32_t>(hotkey.chords.size()));
+    for (const auto& chord : hotkey.chords) putChord(out, chord);
+}
+
+void putConfig(ByteWriter& out, const ConfigProperties& config) {
+    out.put<int64_t>(config.maxChordInterval.count());
+    out.put<int64_t>(config.holdModifierThreshold.count());
+    out.put<int64_t>(config.simultaneousThreshold.count());
+    out.put<int32_t>(config.cornerSize);
+    out.put<int64_t>(config.tapTimeout.count());
+    out.put<int32_t>(config.pressThreshold);
+    out.put<int32_t>(config.typeRate);
+    out.put<uint32_t>(static_cast<uint32_t>(config.blacklist.size()));
+    for (const auto& name : config.blacklist) putString(out, name);
+    putString(out, config.sequenceCommand);
+}
+
+// ByteReader plus a flag for well-formed reads of bad values (unknown tags, impossible counts)
+class Decoder {
+   public:
+    explicit Decoder(std::string_view bytes) : in_(bytes) {}
+
+    template <typename T>
+    T get() {
+        return in_.get<T>();
+    }
+
+    std::string string() {
+        const auto size = in_.get<uint32_t>();
+        return std::string{in_.getBytes(size)};
+    }
+
+    // every list item takes at least a byte, so a larger count is corrupt and would
+    // otherwise reserve whatever it claims
+    uint32_t count() {
+        const auto n = in_.get<uint32_t>();
+        if (n > in_.remaining()) {
+            reject();
+            return 0;
+        }
+        return n;
+    }
+
+    void reject() { rejected_ = true; }
+    [[nodiscard]] bool failed() const { return rejected_ || in_.failed(); }
+    [[nodiscard]] bool atEnd() const { return in_.atEnd(); }
+
+   private:
+    ByteReader in_;
+    bool rejected_{};
+};
+
+Chord getChord(Decoder& in) {
+    Chord chord{
+        .keysym = {.keycode = in.get<uint32_t>(), .wildcard = {}},
+        .modifiers = {},
+        .fingerCount = std::nullopt,
+    };
+    const auto wildcard = in.get<uint8_t>();
+    if (wildcard > static_cast<uint8_t>(KeyClass::Digit)) in.reject();
+    chord.keysym.wildcard = static_cast<KeyClass>(wildcard);
+    chord.modifiers.flags = in.get<int32_t>();
+    const bool hasFingers = in.get<uint8_t>() != 0;
+    const auto fingers = in.get<int32_t>();
+    if (hasFingers) chord.fingerCount = fingers;
+    return chord;
+}
+
+EventProgram getProgram(Decoder& in) {
+    EventProgram program;
+    const auto events = in.count();
+    program.events.reserve(events);
+    for (uint32_t i = 0; i < events && !in.failed(); i++) {
+        KeyEvent event{
+            .keycode = in.get<uint16_t>(),
+            .flags = in.get<uint16_t>(),
+            .textOffset = in.get<uint16_t>(),
+            .textLength = in.get<uint8_t>(),
+            .keyDown = in.get<uint8_t>() != 0,
+            .pause = {},
+        };
+        const auto pause = in.get<uint8_t>();
+        if (pause > static_cast<uint8_t>(KeyEvent::Pause::Burst)) in.reject();
+        event.pause = static_cast<KeyEvent::Pause>(pause);
+        program.events.push_back(event);
+    }
+    const auto units = in.count();
+    program.text.reserve(units);
+    for (uint32_t i = 0; i < units && !in.failed(); i++) program.text.push_back(in.get<uint16_t>());
+    // a slice past the text would read out of bounds when posted
+    for (const auto& event : program.events) {
+        if (event.textOffset + event.textLength > program.text.size()) in.reject();
+    }
+    return program;
+}
+
+BindingAction getAction(Decoder& in) {
+    switch (in.get<uint8_t>()) {
+        case 0: return in.string();
+        case 1: return getChord(in);
+        case 2: return KeyProgram{std::make_shared<const EventProgram>(getProgram(in))};
+        default: in.reject(); return std::string{};
+    }
+}
+
+Hotkey getHotkey(Decoder& in) {
+    const auto flags = in.get<uint8_t>();
+    Hotkey hotkey{
+        .passthrough = (flags & 1) != 0,
+        .repeat = (flags & 2) != 0,
+        .on_release = (flags & 4) != 0,
+        .chords = {},
+    };
+    const auto chords = in.count();
+    hotkey.chords.reserve(chords);
+    for (uint32_t i = 0; i < chords && !in.failed(); i++) {
+        hotkey.chords.push_back(getChord(in));
+    }
+    return hotkey;
+}
+
+ConfigProperties getConfig(Decoder& in) {
+    ConfigProperties config;
+    config.maxChordInterval = std::chrono::milliseconds{in.get<int64_t>()};
+    config.holdModifierThreshold = std::chrono::milliseconds{in.get<int64_t>()};
+    config.simultaneousThreshold = std::chrono::milliseconds{in.get<int64_t>()};
+    config.cornerSize = in.get<int32_t>();
+    config.tapTimeout = std::chrono::milliseconds{in.get<int64_t>()};
+    config.pressThreshold = in.get<int32_t>();
+    config.typeRate = in.get<int32_t>();
+    const auto names = in.count();
+    config.blacklist.reserve(names);
+    for (uint32_t i = 0; i < names && !in.failed(); i++) {
+        config.blacklist.push_back(in.string());
+    }
+    config.sequenceCommand = in.string();
+    return config;
+}
+
+Gesture getGesture(Decoder& in) {
+    const auto kind = in.get<uint8_t>();
+    if (kind > static_cast<uint8_t>(GestureKind::Tap)) in.reject();
+    return {static_cast<GestureKind>(kind), in.get<int32_t>()};
+}
+
+template <typename T, typename Fn>
+void getList(Decoder& in, std::vector<T>& items, Fn&& getItem) {
+    const auto n = in.count();
+    items.reserve(n);
+    for (uint32_t i = 0; i < n && !in.failed(); i++) {
+        items.push_back(getItem(in));
+    }
+}
+
+}  // namespace
+
+void config_cache::encode(ByteWriter& out, const Key& key, const InterpreterResult& compiled) {
+    out.putBytes(kMagic);
+    out.put<uint16_t>(kVersion);
+    out.put<uint64_t>(key.contents);
+    out.put<uint64_t>(key.layout);
+    out.put<uint16_t>(static_cast<uint16_t>(kBuildId.size()));
+    out.putBytes(kBuildId);
+
+    putConfig(out, compiled.config);
+    out.put<uint32_t>(static_cast<uint32_t>(compiled.bindings.size()));
+    for (const auto& binding : compiled.bindings) {
+        putHotkey(out, binding.source);
+        putAction(out, binding.action);
+    }
+    out.put<uint32_t>(static_cast<uint32_t>(compiled.tapBindings.size()));
+    for (const auto& tap : compiled.tapBindings) {
+        out.put<uint16_t>(static_cast<uint16_t>(tap.zone));
+        out.put<int32_t>(tap.modifiers.flags);
+        putAction(out, tap.action);
+    }
+    out.put<uint32_t>(static_cast<uint32_t>(compiled.tapRegions.size()));
+    for (const auto& region : compiled.tapRegions) {
+        out.put<uint16_t>(static_cast<uint16_t>(region.zone));
+        out.put<int32_t>(region.rect.x0);
+        out.put<int32_t>(region.rect.y0);
+        out.put<int32_t>(region.rect.x1);
+        out.put<int32_t>(region.rect.y1);
+    }
+    out.put<uint32_t>(static_cast<uint32_t>(compiled.gestureBindings.size()));
+    for (const auto& gesture : compiled.gestureBindings) {
+        out.put<uint8_t>(static_cast<uint8_t>(gesture.gesture.kind));
+        out.put<int32_t>(gesture.gesture.fingers);
+        out.put<int32_t>(gesture.modifiers.flags);
+        putAction(out, gesture.action);
+    }
+    out.put<uint32_t>(static_cast<uint32_t>(compiled.pressBindings.size()));
+    for (const auto& press : compiled.pressBindings) {
+        out.put<uint8_t>(press.press.zone ? 1 : 0);
+        out.put<uint16_t>(static_cast<uint16_t>(press.press.zone.value_or(Zone{})));
+        out.put<int32_t>(press.press.fingers);
+        out.put<int32_t>(press.modifiers.flags);
+        putAction(out, press.action);
+    }
+}
+
+std::optional<InterpreterResult> config_cache::decode(std::string_view bytes, const Key& key) {
+    ByteReader header{bytes};
+    if (header.getBytes(kMagic.size()) != kMagic || header.get<uint16_t>() != kVersion) return std::nullopt;
+    const Key stored{.contents = header.get<uint64_t>(), .layout = header.get<uint64_t>()};
+    const auto buildIdSize = header.get<uint16_t>();
+    if (header.failed() || stored != key || header.getBytes(buildIdSize) != kBuildId) return std::nullopt;
+
+    Decoder in{bytes.substr(header.offset())};
+    InterpreterResult compiled;
+    compiled.config = getConfig(in);
+    getList(in, compiled.bindings, [](Decoder& d) {
+        auto source = getHotkey(d);
+        return Binding{.source = std::move(source), .action = getAction(d)};
+    });
+    getList(in, compiled.tapBindings, [](Decoder& d) {
+        const auto zone = static_cast<Zone>(d.get<uint16_t>());
+        const ModifierFlags mods{d.get<int32_t>()};
+        return TapBinding{.zone = zone, .modifiers = mods, .action = getAction(d)};
+    });
+    getList(in, compiled.tapRegions, [](Decoder& d) {
+        return TapRegion{
+            .zone = static_cast<Zone>(d.get<uint16_t>()),
+            .rect = {d.get<int32_t>(), d.get<int32_t>(), d.get<int32_t>(), d.get<int32_t>()},
+        };
+    });
+    getList(in, compiled.gestureBindings, [](Decoder& d) {
+        const auto gesture = getGesture(d);
+        const ModifierFlags mods{d.get<int32_t>()};
+        return GestureBinding{.gesture = gesture, .modifiers = mods, .action = getAction(d)};
+    });
+    getList(in, compiled.pressBindings, [](Decoder& d) {
+        const bool hasZone = d.get<uint8_t>() != 0;
+        const auto zone = static_cast<Zone>(d.get<uint16_t>());
+        Press press{.zone = hasZone ? std::optional{zone} : std::nullopt, .fingers = d.get<int32_t>()};
+        const ModifierFlags mods{d.get<int32_t>()};
+        return PressBinding{.press = press, .modifiers = mods, .action = getAction(d)};
+    });
+
+    if (in.failed() || !in.atEnd()) return std::nullopt;
+    return compiled;
+}
+
+std::optional<config_cache::Entry> config_cache::entryFor(const std::filesystem::path& configFile, std::string_view contents) {
+    auto dir = getCacheDir("smhkd");
+    if (!dir) return std::nullopt;
+    std::error_code ec;
+    auto absolute = std::filesystem::absolute(configFile, ec);
+    if (ec) absolute = configFile;
+    // one cache per config path, so -c with several configs doesn't thrash a single file
+    return Entry{
+        .file = *dir / std::format("config-{:016x}.bin", fnv1a64(absolute.string())),
+        .key = {.contents = fnv1a64(contents), .layout = keycodeMapFingerprint()},
+    };
+}
+
+std::optional<InterpreterResult> config_cache::load(const Entry& entry) {
+    auto source = loadSource(entry.file);
+    if (source.error) return std::nullopt;
+    return decode(source.buffer.view(), entry.key);
+}
+
+bool config_cache::store(const Entry& entry, const InterpreterResult& compiled) {
+    std::error_code ec;
+    std::filesystem::create_directories(entry.file.parent_path(), ec);
+    if (ec) return false;
+
+    ByteWriter out;
+    encode(out, entry.key, compiled);
+    auto temp = entry.file;
+    temp += std::format(".{}.tmp", getpid());
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        file.write(out.bytes().data(), static_cast<std::streamsize>(out.size()));
+        if (!file) {
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(temp, entry.file, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "../common/binary_io.hpp"
+#include "interpreter.hpp"
+
+// the interpreted form of a config (bindings, trackpad bindings and regions, properties),
+// cached on disk so a start or reload with unchanged contents skips parsing entirely.
+//
+// file layout: "SMCC" magic, u16 format version, u64 contents hash, u64 layout
+// fingerprint, u16-length build id, then the compiled config. strings are a
+// u32 length and raw bytes, lists a u32 count then their items. all little-endian
+namespace config_cache {
+
+inline constexpr std::string_view kMagic = "SMCC";
+// of the header; the build id after it already changes with anything that changes the body
+inline constexpr uint16_t kVersion = 6;
+
+// what a compiled config depends on besides the code that compiled it
+struct Key {
+    // fnv1a64 of the config file's bytes
+    uint64_t contents;
+    // keycodeMapFingerprint() when it was compiled; layout keys resolve to keycodes
+    uint64_t layout;
+
+    bool operator==(const Key&) const = default;
+};
+
+void encode(ByteWriter& out, const Key& key, const InterpreterResult& compiled);
+// nullopt for a foreign, stale (key, format or build id mismatch) or truncated cache
+[[nodiscard]] std::optional<InterpreterResult> decode(std::string_view bytes, const Key& key);
+
+// a cache file and the key its contents must carry to be used
+struct Entry {
+    std::filesystem::path file;
+    Key key;
+};
+
+// the entry for a config file read with these contents under the current keyboard
+// layout, or nullopt without a cache directory
+[[nodiscard]] std::optional<Entry> entryFor(const std::filesystem::path& configFile, std::string_view contents);
+
+[[nodiscard]] std::optional<InterpreterResult> load(const Entry& entry);
+// written to a temporary and renamed over the old cache, so a reader never sees half a file
+bool store(const Entry& entry, const InterpreterResult& compiled);
+
+}  // namespace config_cache
@@ -1,39 +1,67 @@
 #include "config_loader.hpp"
 
-#include <fstream>
-#include <iterator>
-
+#include "config_cache.hpp"
 #include "interpreter.hpp"
 
-ConfigLoadResult ConfigLoader::loadFromContents(std::string_view contents) {
-    ConfigLoadResult result{};
-    const std::string source(contents);
+namespace {
 
-    Parser parser(source);
-    result.program = parser.parseProgram();
-    result.parseErrors = parser.errors();
+void takeCompiled(ConfigLoadResult& result, InterpreterResult compiled) {
+    result.bindings = std::move(compiled.bindings);
+    result.tapBindings = std::move(compiled.tapBindings);
+    result.tapRegions = std::move(compiled.tapRegions);
+    result.gestureBindings = std::move(compiled.gestureBindings);
+    result.pressBindings = std::move(compiled.pressBindings);
+    result.config = std::move(compiled.config);
+    result.interpreterErrors = std::move(compiled.errors);
+}
 
-    auto interpreterResult = interpretProgram(result.program);
-    result.bindings = std::move(interpreterResult.bindings);
-    result.tapBindings = std::move(interpreterResult.tapBindings);
-    result.config = interpreterResult.config;
-    result.interpreterErrors = std::move(interpreterResult.errors);
+}  // namespace
 
-    return result;
+ConfigLoadResult ConfigLoader::loadFromContents(std::string_view contents, ConfigLoadOptions options) {
+    return load(SourceBuffer{std::string{contents}}, options);
 }
 
-ConfigLoadResult ConfigLoader::loadFromFile(const std::filesystem::path& path) {
-    std::ifstream file(path);
-    if (!file) {
+ConfigLoadResult ConfigLoader::loadFromFile(const std::filesystem::path& path, ConfigLoadOptions options) {
+    auto source = loadSource(path);
+    if (source.error) {
         ConfigLoadResult result{};
-        result.fileError = std::format("failed to open config file '{}'", path.string());
+        result.fileError = std::move(source.error);
         return result;
     }
+    // a reload is diffed against the previous load instead; the cache only serves the next
+    // start, which writes it then, rather than being rewritten on every save
+    const bool reload = options.interpreter && options.interpreter->hasPrevious();
+    std::optional<config_cache::Entry> cache;
+    if (options.useCache && !options.keepProgram && !reload) {
+        cache = config_cache::entryFor(path, source.buffer.view());
+    }
+    if (cache) {
+        if (auto cached = config_cache::load(*cache)) {
+            ConfigLoadResult result{};
+            takeCompiled(result, std::move(*cached));
+            result.fromCache = true;
+            return result;
+        }
+    }
+    return load(std::move(source.buffer), options, cache ? &*cache : nullptr);
+}
+
+ConfigLoadResult ConfigLoader::load(SourceBuffer source, ConfigLoadOptions options, const config_cache::Entry* cache) {
+    ConfigLoadResult result{};
+
+    Parser parser{std::move(source)};
+    auto program = parser.parseProgram();
+    result.parseErrors = parser.errors();
+
+    auto compiled = options.interpreter ? options.interpreter->interpret(program) : interpretProgram(program);
+    if (cache && result.parseErrors.empty() && compiled.errors.empty()) {
+        // a cache that can't be written only costs the next start a parse
+        (void)config_cache::store(*cache, compiled);
+    }
+    takeCompiled(result, std::move(compiled));
 
-    const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    auto result = loadFromContents(contents);
-    if (!file.good() && !file.eof()) {
-        result.fileError = std::format("failed to read config file '{}'", path.string());
+    if (options.keepProgram) {
+        result.program = std::move(program);
     }
     return result;
 }
@@ -6,23 +6,48 @@
 #include <string_view>
 #include <vector>
 
+#include "../common/source_buffer.hpp"
 #include "../input/hotkey.hpp"
 #include "ast.hpp"
+#include "config_cache.hpp"
 #include "interpreter.hpp"
 #include "parser.hpp"
 
+struct ConfigLoadOptions {
+    // keep the AST in the result (for --dump-ast); otherwise its arena is released as
+    // soon as the program has been interpreted
+    bool keepProgram{false};
+    // loadFromFile reuses the compiled config cached for unchanged contents and layout,
+    // and caches what it compiles when the config is clean. ignored with keepProgram
+    bool useCache{false};
+    // interpret through this, reusing what it interpreted on the previous load. the cache
+    // is only read and written while it has no previous load, since a diff tells the caller more
+    IncrementalInterpreter* interpreter{nullptr};
+};
+
 struct ConfigLoadResult {
+    // empty unless ConfigLoadOptions::keepProgram
     ast::Program program;
     std::vector<Binding> bindings;
     std::vector<TapBinding> tapBindings;
+    std::vector<TapRegion> tapRegions;
+    std::vector<GestureBinding> gestureBindings;
+    std::vector<PressBinding> pressBindings;
     ConfigProperties config;
     std::vector<ParseError> parseErrors;
     std::vector<InterpreterError> interpreterErrors;
     std::optional<std::string> fileError;
+    // compiled config came from the cache, without parsing
+    bool fromCache{false};
 };
 
 class ConfigLoader {
    public:
-    static ConfigLoadResult loadFromContents(std::string_view contents);
-    static ConfigLoadResult loadFromFile(const std::filesystem::path& path);
+    static ConfigLoadResult loadFromContents(std::string_view contents, ConfigLoadOptions options = {});
+    // maps the file and parses it in place; the mapping is released with the program
+    static ConfigLoadResult loadFromFile(const std::filesystem::path& path, ConfigLoadOptions options = {});
+
+   private:
+    // stores the compiled config under cache when it compiles cleanly
+    static ConfigLoadResult load(SourceBuffer source, ConfigLoadOptions options, const config_cache::Entry* cache = nullptr);
 };
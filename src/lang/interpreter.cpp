@@ -1,52 +1,97 @@
 #include "interpreter.hpp"
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <unordered_map>
 #include <variant>
 
+#include "../common/hash.hpp"
 #include "../common/log.hpp"
 #include "../common/string_util.hpp"
+#include "../input/locale.hpp"
 #include "lang/ast.hpp"
 
 namespace {
 
+// statement outputs carried from one load into the next
+struct StatementReuse {
+    std::unordered_map<uint64_t, IncrementalInterpreter::StatementOutput>& outputs;
+    uint32_t generation;
+    uint64_t& revision;
+    std::vector<uint64_t> keyboardOrder;
+    std::vector<uint64_t> trackpadOrder;
+    size_t reinterpreted{};
+};
+
 class Interpreter {
    public:
     Interpreter() = default;
 
-    InterpreterResult interpret(const ast::Program& p);
+    // with reuse, hotkey and remap statements are looked up by key before being interpreted
+    InterpreterResult interpret(const ast::Program& p, StatementReuse* reuse = nullptr);
     ChordResult interpretChord(const ast::Chord& ch);
 
    private:
-    std::unordered_map<std::string, std::vector<ast::Modifier>> defines;
-    std::unordered_map<std::string, int> cache;
+    // names are views into the program being interpreted, which outlives the interpreter
+    std::unordered_map<std::string_view, const ast::List<ast::Modifier>*> defines;
+    std::unordered_map<std::string_view, int> cache;
     std::vector<InterpreterError> errors_;
     std::vector<TapBinding> tapBindings_;
+    std::vector<GestureBinding> gestureBindings_;
+    std::vector<PressBinding> pressBindings_;
+    // define_region names to their zone; rects are indexed by zone - kFirstRegionZone
+    std::unordered_map<std::string_view, Zone> regionZones_;
+    std::vector<ZoneRect> regionRects_;
+    // while a reusable statement is interpreted, the defined names it resolves
+    std::vector<IncrementalInterpreter::Dependency>* dependencies_{};
 
     void addError(std::string message);
+    void addDependency(IncrementalInterpreter::Dependency::Kind kind, std::string_view name, std::optional<int> value);
+    // whether each name still resolves as it did, without errors or recording
+    bool dependenciesHold(const std::vector<IncrementalInterpreter::Dependency>& dependencies);
 
     // modifier resolution
-    std::optional<int> resolveModifierFlags(const std::string& name);
-    std::optional<int> resolveModifiers(const std::vector<ast::Modifier>& modifiers);
+    std::optional<int> resolveModifierFlags(std::string_view name);
+    std::optional<int> resolveModifiers(const ast::List<ast::Modifier>& modifiers);
 
     // hotkey building
     void setChordKeyFromKeysym(Chord& chord, const ast::SimpleKeysym& ks);
     std::optional<Hotkey> buildBaseHotkey(const ast::Chords& syn);
     std::optional<Chord> buildChord(const ast::Chord& chord);
+    // the target chord when inPlace and there is just the one, otherwise the compiled program
+    std::optional<BindingAction> buildRemapAction(const ast::Remap& node, bool inPlace);
+    std::optional<EventProgram> planText(std::string_view text);
     bool setHotkeyKeys(Hotkey& hk, const ast::Chords& syn, std::optional<size_t> braceChordIndex, size_t braceItemIndex);
 
     // command parsing
     static std::string trim(std::string_view s);
     static std::string unescapeDoubleBraces(std::string_view s);
-    std::vector<std::string> parseCommandBraceExpansion(const std::string& command);
+    std::vector<std::string> parseCommandBraceExpansion(std::string_view command);
 
     // statement application
     void applyDefine(const ast::DefineModifier& node);
+    void applyDefineRegion(const ast::DefineRegion& node);
     void applyConfig(const ast::ConfigProperty& node, ConfigProperties& config);
     void applyRemap(const ast::Remap& node, std::vector<Binding>& bindings);
     void applyHotkey(const ast::Hotkey& h, std::vector<Binding>& bindings);
+    // one binding for a key(...) hotkey, however many keys its class holds
+    void applyWildcardHotkey(const ast::Hotkey& h, Hotkey base, std::vector<Binding>& bindings);
     void applyTapHotkey(const ast::Hotkey& h);
     void applyTapRemap(const ast::Remap& node);
+    std::optional<Zone> resolveTapZone(const ast::Chord& chord);
+    std::optional<Zone> lookupRegion(std::string_view name);
+    std::vector<TapRegion> boundTapRegions(int cornerSizePct) const;
+    std::optional<ModifierFlags> resolveGestureChord(const ast::Chords& syn);
+    void applyGestureHotkey(const ast::Hotkey& h);
+    void applyGestureRemap(const ast::Remap& node);
+    std::optional<std::pair<Press, ModifierFlags>> resolvePressChord(const ast::Chords& syn);
+    void applyPressHotkey(const ast::Hotkey& h);
+    void applyPressRemap(const ast::Remap& node);
+    template <typename Apply>
+    void applyReusable(uint64_t key, std::vector<Binding>& bindings, StatementReuse* reuse, Apply&& apply);
 };
 
 void Interpreter::addError(std::string message) {
@@ -54,11 +99,11 @@ void Interpreter::addError(std::string message) {
 }
 
 // NOLINTNEXTLINE(misc-no-recursion)
-std::optional<int> Interpreter::resolveModifierFlags(const std::string& name) {
-    std::vector<std::string> active;
+std::optional<int> Interpreter::resolveModifierFlags(std::string_view name) {
+    std::vector<std::string_view> active;
 
     // NOLINTNEXTLINE(misc-no-recursion)
-    const auto resolve = [&](const auto& self, const std::string& currentName) -> std::optional<int> {
+    const auto resolve = [&](const auto& self, std::string_view currentName) -> std::optional<int> {
         if (auto it = cache.find(currentName); it != cache.end()) return it->second;
         if (auto bi = parseBuiltinModifier(currentName)) {
             const int flags = builtinModifierToFlags(*bi);
@@ -78,11 +123,11 @@ std::optional<int> Interpreter::resolveModifierFlags(const std::string& name) {
 
         active.push_back(currentName);
         int flags = 0;
-        for (const auto& part : it->second) {
+        for (const auto& part : *it->second) {
             std::optional<int> partFlags =
                 std::holds_alternative<BuiltinModifier>(part.value)
                     ? std::optional<int>(builtinModifierToFlags(std::get<BuiltinModifier>(part.value)))
-                    : self(self, std::get<std::string>(part.value));
+                    : self(self, std::get<std::string_view>(part.value));
             if (!partFlags) {
                 addError(std::format("invalid modifier reference in custom modifier definition '{}'", currentName));
                 active.pop_back();
@@ -95,7 +140,38 @@ std::optional<int> Interpreter::resolveModifierFlags(const std::string& name) {
         return flags;
     };
 
-    return resolve(resolve, name);
+    const auto flags = resolve(resolve, name);
+    if (!parseBuiltinModifier(name)) addDependency(IncrementalInterpreter::Dependency::Kind::Modifier, name, flags);
+    return flags;
+}
+
+void Interpreter::addDependency(IncrementalInterpreter::Dependency::Kind kind, std::string_view name, std::optional<int> value) {
+    if (!dependencies_) return;
+    const auto same = [&](const IncrementalInterpreter::Dependency& d) { return d.kind == kind && d.name == name; };
+    if (std::ranges::any_of(*dependencies_, same)) return;
+    dependencies_->push_back({.kind = kind, .name = std::string{name}, .value = value});
+}
+
+bool Interpreter::dependenciesHold(const std::vector<IncrementalInterpreter::Dependency>& dependencies) {
+    const auto errorsBefore = errors_.size();
+    const bool hold = std::ranges::all_of(dependencies, [&](const IncrementalInterpreter::Dependency& d) {
+        if (d.kind == IncrementalInterpreter::Dependency::Kind::Modifier) {
+            // resolve by the program's own view of the name: the resolution cache keeps it
+            const auto it = defines.find(d.name);
+            return (it != defines.end() ? resolveModifierFlags(it->first) : std::nullopt) == d.value;
+        }
+        const auto zone = lookupRegion(d.name);
+        return (zone ? std::optional<int>{static_cast<int>(*zone)} : std::nullopt) == d.value;
+    });
+    errors_.resize(errorsBefore);
+    return hold;
+}
+
+std::optional<Zone> Interpreter::lookupRegion(std::string_view name) {
+    const auto it = regionZones_.find(name);
+    const auto zone = it != regionZones_.end() ? std::optional{it->second} : std::nullopt;
+    addDependency(IncrementalInterpreter::Dependency::Kind::Region, name, zone ? std::optional<int>{static_cast<int>(*zone)} : std::nullopt);
+    return zone;
 }
 
 void Interpreter::setChordKeyFromKeysym(Chord& chord, const ast::SimpleKeysym& ks) {
@@ -115,13 +191,13 @@ void Interpreter::setChordKeyFromKeysym(Chord& chord, const ast::SimpleKeysym& k
         ks.value);
 }
 
-std::optional<int> Interpreter::resolveModifiers(const std::vector<ast::Modifier>& modifiers) {
+std::optional<int> Interpreter::resolveModifiers(const ast::List<ast::Modifier>& modifiers) {
     int flags = 0;
     for (const auto& mod : modifiers) {
         if (std::holds_alternative<BuiltinModifier>(mod.value)) {
             flags |= builtinModifierToFlags(std::get<BuiltinModifier>(mod.value));
         } else {
-            auto resolvedFlags = resolveModifierFlags(std::get<std::string>(mod.value));
+            auto resolvedFlags = resolveModifierFlags(std::get<std::string_view>(mod.value));
             if (!resolvedFlags) {
                 return std::nullopt;
             }
@@ -160,6 +236,122 @@ std::optional<Chord> Interpreter::buildChord(const ast::Chord& ch) {
     return chord;
 }
 
+std::optional<BindingAction> Interpreter::buildRemapAction(const ast::Remap& node, bool inPlace) {
+    if (node.text) {
+        auto program = planText(*node.text);
+        if (!program) return std::nullopt;
+        return BindingAction{KeyProgram{std::make_shared<const EventProgram>(std::move(*program))}};
+    }
+    auto target = buildChord(node.target);
+    if (!target) return std::nullopt;
+    if (node.macro.empty() && inPlace) return BindingAction{*target};
+
+    EventProgram program;
+    program.events.reserve(2 * (node.macro.size() + 1));
+    const auto press = [&](const Chord& chord) {
+        program.events.push_back(keyEventFor(chord, true, KeyEvent::Pause::Press));
+        program.events.push_back(keyEventFor(chord, false, KeyEvent::Pause::Press));
+    };
+    press(*target);
+    for (const auto& ch : node.macro) {
+        auto chord = buildChord(ch);
+        if (!chord) return std::nullopt;
+        press(*chord);
+    }
+    return BindingAction{KeyProgram{std::make_shared<const EventProgram>(std::move(program))}};
+}
+
+std::optional<EventProgram> Interpreter::planText(std::string_view text) {
+    // UTF-8 to UTF-16; the parser has already taken the escapes
+    std::u16string units;
+    units.reserve(text.size());
+    for (size_t i = 0; i < text.size();) {
+        const auto lead = static_cast<unsigned char>(text[i]);
+        size_t length = 1;
+        char32_t codepoint = lead;
+        if (lead >= 0x80) {
+            // the lead byte's high bits give the sequence length, its low bits start the codepoint.
+            // C0 and C1 only start overlong forms, and F5 and up codepoints past U+10FFFF
+            length = lead >= 0xC2 && lead <= 0xDF ? 2 : (lead & 0xF0) == 0xE0 ? 3 : lead >= 0xF0 && lead <= 0xF4 ? 4 : 0;
+            codepoint = lead & (0x7F >> length);
+            for (size_t k = 1; k < length; k++) {
+                const auto next = i + k < text.size() ? static_cast<unsigned char>(text[i + k]) : 0;
+                if ((next & 0xC0) != 0x80) {
+                    length = 0;
+                    break;
+                }
+                codepoint = codepoint << 6 | (next & 0x3F);
+            }
+            // the shortest form only, no surrogate halves, nothing past the last plane
+            constexpr std::array<char32_t, 5> kSmallest{0, 0, 0x80, 0x800, 0x10000};
+            if (length == 0 || codepoint < kSmallest.at(length) || (codepoint >= 0xD800 && codepoint < 0xE000) ||
+                codepoint > 0x10FFFF) {
+                addError(std::format("remap text is not valid UTF-8 at byte {}", i));
+                return std::nullopt;
+            }
+        }
+        if (codepoint >= 0x10000) {
+            codepoint -= 0x10000;
+            units.push_back(static_cast<char16_t>(0xD800 + (codepoint >> 10)));
+            units.push_back(static_cast<char16_t>(0xDC00 + (codepoint & 0x3FF)));
+        } else {
+            units.push_back(static_cast<char16_t>(codepoint));
+        }
+        i += length;
+    }
+    if (units.empty()) {
+        addError("remap text must not be empty");
+        return std::nullopt;
+    }
+
+    if (units.size() > UINT16_MAX) {
+        addError(std::format("remap text is too long ({} UTF-16 units, at most {})", units.size(), UINT16_MAX));
+        return std::nullopt;
+    }
+
+    EventProgram program;
+    program.events.reserve(units.size() * 2);
+    size_t keys = 0;
+    const auto press = [&](KeyEvent down) {
+        down.keyDown = true;
+        down.pause = keys++ % kTypeBurst == 0 ? KeyEvent::Pause::Burst : KeyEvent::Pause::None;
+        program.events.push_back(down);
+        down.keyDown = false;
+        down.pause = KeyEvent::Pause::None;
+        program.events.push_back(down);
+    };
+    // the half of a surrogate pair is never typed by a key
+    const auto keyAt = [&](size_t i) -> std::optional<CharacterKey> {
+        if (units[i] >= 0xD800 && units[i] < 0xE000) return std::nullopt;
+        return lookupCharacterKey(units[i]);
+    };
+    for (size_t i = 0; i < units.size();) {
+        if (const auto key = keyAt(i)) {
+            const int flags = (key->shift ? Hotkey_Flag_Shift : 0) | (key->option ? Hotkey_Flag_Alt : 0);
+            press({.keycode = static_cast<uint16_t>(key->keycode), .flags = static_cast<uint16_t>(flags), .textOffset = 0, .textLength = 0, .keyDown = true, .pause = {}});
+            i++;
+            continue;
+        }
+        // no key types it, so it goes as unicode text along with the keyless characters after it, while there's room
+        const size_t offset = program.text.size();
+        while (i < units.size() && !keyAt(i)) {
+            const size_t width = units[i] >= 0xD800 && units[i] < 0xDC00 && i + 1 < units.size() ? 2 : 1;
+            if (program.text.size() - offset + width > kMaxEventText) break;
+            program.text.append(units, i, width);
+            i += width;
+        }
+        press({
+            .keycode = 0,
+            .flags = 0,
+            .textOffset = static_cast<uint16_t>(offset),
+            .textLength = static_cast<uint8_t>(program.text.size() - offset),
+            .keyDown = true,
+            .pause = {},
+        });
+    }
+    return program;
+}
+
 bool Interpreter::setHotkeyKeys(Hotkey& hk, const ast::Chords& syn, std::optional<size_t> braceChordIndex, size_t braceItemIndex) {
     for (size_t i = 0; i < syn.sequence.size(); i++) {
         const auto& key = syn.sequence[i].key;
@@ -171,6 +363,8 @@ bool Interpreter::setHotkeyKeys(Hotkey& hk, const ast::Chords& syn, std::optiona
             using T = std::decay_t<decltype(v)>;
             if constexpr (std::is_same_v<T, ast::SimpleKeysym>) {
                 return &v;
+            } else if constexpr (std::is_same_v<T, ast::WildcardKeysym>) {
+                return nullptr;
             } else {
                 if (v.alternatives.empty()) return nullptr;
                 const size_t idx = (i == braceChordIndex && braceItemIndex < v.alternatives.size())
@@ -180,6 +374,10 @@ bool Interpreter::setHotkeyKeys(Hotkey& hk, const ast::Chords& syn, std::optiona
             }
         },
             *key);
+        if (const auto* wildcard = ast::asWildcard(*key)) {
+            hk.chords[i].keysym = {.keycode = 0, .wildcard = wildcard->keyClass};
+            continue;
+        }
         if (!ks) {
             addError(std::format("chord {} in multi-chord sequence has empty brace expansion", i + 1));
             return false;
@@ -210,7 +408,7 @@ std::string Interpreter::unescapeDoubleBraces(std::string_view s) {
     return result;
 }
 
-std::vector<std::string> Interpreter::parseCommandBraceExpansion(const std::string& command) {
+std::vector<std::string> Interpreter::parseCommandBraceExpansion(std::string_view command) {
     size_t braceStart = std::string::npos;
     for (size_t i = 0; i < command.size(); i++) {
         if (command[i] == '{') {
@@ -251,10 +449,9 @@ std::vector<std::string> Interpreter::parseCommandBraceExpansion(const std::stri
         }
     }
 
-    const std::string_view commandView{command};
-    std::string prefix = unescapeDoubleBraces(commandView.substr(0, braceStart));
-    std::string suffix = unescapeDoubleBraces(commandView.substr(braceEnd + 1));
-    std::string braceContent = unescapeDoubleBraces(commandView.substr(braceStart + 1, braceEnd - braceStart - 1));
+    std::string prefix = unescapeDoubleBraces(command.substr(0, braceStart));
+    std::string suffix = unescapeDoubleBraces(command.substr(braceEnd + 1));
+    std::string braceContent = unescapeDoubleBraces(command.substr(braceStart + 1, braceEnd - braceStart - 1));
 
     std::vector<std::string> items;
     for (size_t start = 0; start < braceContent.size();) {
@@ -276,7 +473,44 @@ std::vector<std::string> Interpreter::parseCommandBraceExpansion(const std::stri
 }
 
 void Interpreter::applyDefine(const ast::DefineModifier& node) {
-    defines[node.name] = node.parts;
+    defines[node.name] = &node.parts;
+}
+
+void Interpreter::applyDefineRegion(const ast::DefineRegion& node) {
+    if (parseZone(node.name)) {
+        addError(std::format("cannot redefine built-in trackpad zone '{}'", node.name));
+        return;
+    }
+    const auto& [a, b, c, d] = node.args;
+    ZoneRect rect{};
+    if (node.shape == ast::RegionShape::Rect) {
+        if (a < 0 || b < 0 || c > 100 || d > 100 || a >= c || b >= d) {
+            addError(std::format("region '{}': rect({}, {}, {}, {}) must satisfy 0 <= x0 < x1 <= 100 and 0 <= y0 < y1 <= 100",
+                node.name, a, b, c, d));
+            return;
+        }
+        rect = {a, b, c, d};
+    } else {
+        if (a < 1 || b < 1 || a > 100 || b > 100 || c < 0 || d < 0 || c >= a || d >= b) {
+            addError(std::format("region '{}': grid({}, {}, {}, {}) needs 1-100 columns and rows and a cell inside them",
+                node.name, a, b, c, d));
+            return;
+        }
+        // rows count down from the top, y counts up from the bottom
+        rect = {c * 100 / a, 100 - (d + 1) * 100 / b, (c + 1) * 100 / a, 100 - d * 100 / b};
+    }
+
+    if (!regionZones_.contains(node.name) && regionRects_.size() == kMaxRegions) {
+        addError(std::format("region '{}': at most {} regions can be defined", node.name, kMaxRegions));
+        return;
+    }
+    // redefining a region keeps its zone, so earlier bindings follow the new rect
+    auto [it, inserted] = regionZones_.try_emplace(node.name, regionZone(regionRects_.size()));
+    if (inserted) {
+        regionRects_.push_back(rect);
+    } else {
+        regionRects_[static_cast<uint16_t>(it->second) - kFirstRegionZone] = rect;
+    }
 }
 
 void Interpreter::applyConfig(const ast::ConfigProperty& node, ConfigProperties& config) {
@@ -320,6 +554,24 @@ void Interpreter::applyConfig(const ast::ConfigProperty& node, ConfigProperties&
         return;
     }
 
+    if (node.name == "type_rate") {
+        if (*node.intValue < 1) {
+            addError(std::format("type_rate must be positive (got {})", *node.intValue));
+            return;
+        }
+        config.typeRate = *node.intValue;
+        return;
+    }
+
+    if (node.name == "press_threshold") {
+        if (*node.intValue < 1) {
+            addError(std::format("press_threshold must be positive (got {})", *node.intValue));
+            return;
+        }
+        config.pressThreshold = *node.intValue;
+        return;
+    }
+
     auto ms = std::chrono::milliseconds(*node.intValue);
     if (node.name == "max_chord_interval") config.maxChordInterval = ms;
     else if (node.name == "hold_modifier_threshold") config.holdModifierThreshold = ms;
@@ -327,16 +579,24 @@ void Interpreter::applyConfig(const ast::ConfigProperty& node, ConfigProperties&
     else if (node.name == "tap_timeout") config.tapTimeout = ms;
     else {
         addError(std::format(
-            "unknown config property: '{}'. Valid properties are: max_chord_interval, hold_modifier_threshold, simultaneous_threshold, corner_size, tap_timeout, blacklist, sequence_command",
+            "unknown config property: '{}'. Valid properties are: max_chord_interval, hold_modifier_threshold, simultaneous_threshold, corner_size, tap_timeout, press_threshold, type_rate, blacklist, sequence_command",
             node.name));
     }
 }
 
 void Interpreter::applyRemap(const ast::Remap& node, std::vector<Binding>& bindings) {
-    if (std::ranges::any_of(node.source.sequence, [](const ast::Chord& c) { return c.tap.has_value(); })) {
+    if (std::ranges::any_of(node.source.sequence, [](const ast::Chord& c) { return c.tap || c.tapRegion; })) {
         applyTapRemap(node);
         return;
     }
+    if (std::ranges::any_of(node.source.sequence, [](const ast::Chord& c) { return c.gesture.has_value(); })) {
+        applyGestureRemap(node);
+        return;
+    }
+    if (std::ranges::any_of(node.source.sequence, [](const ast::Chord& c) { return c.press.has_value(); })) {
+        applyPressRemap(node);
+        return;
+    }
     if (node.source.passthrough || node.source.repeat || node.source.onRelease) {
         addError("remaps do not support '~', '&', or '^' flags");
         return;
@@ -345,30 +605,39 @@ void Interpreter::applyRemap(const ast::Remap& node, std::vector<Binding>& bindi
     if (!source) {
         return;
     }
-    if (source->chords.size() != 1) {
-        addError("remaps currently support single-chord sources only");
+    if (std::ranges::any_of(node.source.sequence, [](const ast::Chord& c) { return c.key && ast::isBrace(*c.key); })) {
+        addError("remaps do not support brace expansion in the source key");
         return;
     }
-    if (node.source.sequence[0].key && ast::isBrace(*node.source.sequence[0].key)) {
-        addError("remaps do not support brace expansion in the source key");
+    if (std::ranges::any_of(node.source.sequence, [](const ast::Chord& c) { return c.key && ast::asWildcard(*c.key); })) {
+        addError("remaps do not support key(...) in the source");
         return;
     }
     if (!setHotkeyKeys(*source, node.source, std::nullopt, 0)) {
         return;
     }
-    auto target = buildChord(node.target);
-    if (!target) {
+    // a sequence's last key is consumed with the rest, so there is no event left to rewrite
+    auto action = buildRemapAction(node, source->chords.size() == 1);
+    if (!action) {
         return;
     }
-    bindings.emplace_back(std::move(*source), *target);
+    bindings.emplace_back(std::move(*source), std::move(*action));
 }
 
 void Interpreter::applyHotkey(const ast::Hotkey& h, std::vector<Binding>& bindings) {
     const auto& syn = h.chords;
-    if (std::ranges::any_of(syn.sequence, [](const ast::Chord& c) { return c.tap.has_value(); })) {
+    if (std::ranges::any_of(syn.sequence, [](const ast::Chord& c) { return c.tap || c.tapRegion; })) {
         applyTapHotkey(h);
         return;
     }
+    if (std::ranges::any_of(syn.sequence, [](const ast::Chord& c) { return c.gesture.has_value(); })) {
+        applyGestureHotkey(h);
+        return;
+    }
+    if (std::ranges::any_of(syn.sequence, [](const ast::Chord& c) { return c.press.has_value(); })) {
+        applyPressHotkey(h);
+        return;
+    }
     auto base = buildBaseHotkey(syn);
     if (!base) {
         return;
@@ -385,6 +654,21 @@ void Interpreter::applyHotkey(const ast::Hotkey& h, std::vector<Binding>& bindin
         }
     }
 
+    std::optional<size_t> wildcardChordIndex;
+    for (size_t i = 0; i < syn.sequence.size(); i++) {
+        if (syn.sequence[i].key && ast::asWildcard(*syn.sequence[i].key)) {
+            if (wildcardChordIndex) {
+                addError("key(...) is supported in only one chord of a sequence");
+                return;
+            }
+            wildcardChordIndex = i;
+        }
+    }
+    if (wildcardChordIndex) {
+        applyWildcardHotkey(h, std::move(*base), bindings);
+        return;
+    }
+
     const size_t errorCountBeforeCommandExpansion = errors_.size();
     std::vector<std::string> commandExpansions = parseCommandBraceExpansion(h.command);
     // got more errors, so skip hotkey processing
@@ -415,6 +699,63 @@ void Interpreter::applyHotkey(const ast::Hotkey& h, std::vector<Binding>& bindin
     }
 }
 
+void Interpreter::applyWildcardHotkey(const ast::Hotkey& h, Hotkey base, std::vector<Binding>& bindings) {
+    if (std::ranges::any_of(h.chords.sequence, [](const ast::Chord& c) { return c.key && ast::isBrace(*c.key); })) {
+        addError("key(...) cannot be combined with brace expansion; it already stands for every key in its class");
+        return;
+    }
+    // the command stays a template, braces still escaped, for the engine to fill each '{}' with the key pressed
+    for (size_t i = 0; i < h.command.size(); i++) {
+        if (h.command[i] != '{' && h.command[i] != '}') continue;
+        if (i + 1 < h.command.size() && h.command[i + 1] == h.command[i]) {
+            i++;
+            continue;
+        }
+        if (h.command.substr(i, 2) == "{}") {
+            i++;
+            continue;
+        }
+        addError(std::format(
+            "a key(...) command takes the key pressed as '{{}}' and no other brace group; found '{}' at position {}. escape literal braces as '{{{{' / '}}}}'.",
+            h.command[i], i));
+        return;
+    }
+    if (!setHotkeyKeys(base, h.chords, std::nullopt, 0)) {
+        return;
+    }
+    debug("adding wildcard command: {} : {}", base, h.command);
+    bindings.emplace_back(std::move(base), std::string{h.command});
+}
+
+std::optional<Zone> Interpreter::resolveTapZone(const ast::Chord& chord) {
+    if (chord.tap) return chord.tap;
+    const auto zone = lookupRegion(*chord.tapRegion);
+    if (!zone) {
+        addError(std::format("unknown trackpad region '{}'; define it with define_region before use", *chord.tapRegion));
+        return std::nullopt;
+    }
+    return zone;
+}
+
+// rects for just the zones some tap or press binding uses, which is all the touch layer classifies
+std::vector<TapRegion> Interpreter::boundTapRegions(int cornerSizePct) const {
+    std::vector<TapRegion> regions;
+    const auto add = [&](Zone zone) {
+        if (std::ranges::any_of(regions, [&](const TapRegion& r) { return r.zone == zone; })) return;
+        const ZoneRect rect = isRegionZone(zone)
+                                  ? regionRects_[static_cast<uint16_t>(zone) - kFirstRegionZone]
+                                  : builtinZoneRect(zone, cornerSizePct);
+        regions.push_back({.zone = zone, .rect = rect});
+    };
+    for (const auto& tb : tapBindings_) {
+        add(tb.zone);
+    }
+    for (const auto& pb : pressBindings_) {
+        if (pb.press.zone) add(*pb.press.zone);
+    }
+    return regions;
+}
+
 void Interpreter::applyTapHotkey(const ast::Hotkey& h) {
     const auto& syn = h.chords;
     if (syn.sequence.size() != 1) {
@@ -436,7 +777,9 @@ void Interpreter::applyTapHotkey(const ast::Hotkey& h) {
         addError("trackpad_tap requires at least one modifier");
         return;
     }
-    tapBindings_.push_back(TapBinding{.zone = *chord.tap, .modifiers = {.flags = *flags}, .action = unescapeDoubleBraces(h.command)});
+    auto zone = resolveTapZone(chord);
+    if (!zone) return;
+    tapBindings_.push_back(TapBinding{.zone = *zone, .modifiers = {.flags = *flags}, .action = unescapeDoubleBraces(h.command)});
 }
 
 void Interpreter::applyTapRemap(const ast::Remap& node) {
@@ -460,35 +803,166 @@ void Interpreter::applyTapRemap(const ast::Remap& node) {
         addError("trackpad_tap requires at least one modifier");
         return;
     }
-    auto target = buildChord(node.target);
-    if (!target) return;
-    tapBindings_.push_back(TapBinding{.zone = *chord.tap, .modifiers = {.flags = *flags}, .action = *target});
+    auto zone = resolveTapZone(chord);
+    if (!zone) return;
+    auto action = buildRemapAction(node, true);
+    if (!action) return;
+    tapBindings_.push_back(TapBinding{.zone = *zone, .modifiers = {.flags = *flags}, .action = std::move(*action)});
+}
+
+std::optional<ModifierFlags> Interpreter::resolveGestureChord(const ast::Chords& syn) {
+    if (syn.sequence.size() != 1) {
+        addError("trackpad gestures must be a single chord, not part of a sequence");
+        return std::nullopt;
+    }
+    if (syn.passthrough || syn.repeat || syn.onRelease) {
+        addError("trackpad gestures do not support '~', '&', or '^' flags");
+        return std::nullopt;
+    }
+    const auto& chord = syn.sequence[0];
+    if (chord.fingerCount) {
+        addError("trackpad gestures do not support trackpad_fingers; the gesture sets its own finger count");
+        return std::nullopt;
+    }
+    // unlike corner taps, a gesture is deliberate enough to bind without a modifier
+    auto flags = resolveModifiers(chord.modifiers);
+    if (!flags) return std::nullopt;
+    return ModifierFlags{.flags = *flags};
+}
+
+void Interpreter::applyGestureHotkey(const ast::Hotkey& h) {
+    auto mods = resolveGestureChord(h.chords);
+    if (!mods) return;
+    gestureBindings_.push_back(GestureBinding{.gesture = *h.chords.sequence[0].gesture, .modifiers = *mods, .action = unescapeDoubleBraces(h.command)});
+}
+
+void Interpreter::applyGestureRemap(const ast::Remap& node) {
+    auto mods = resolveGestureChord(node.source);
+    if (!mods) return;
+    auto action = buildRemapAction(node, true);
+    if (!action) return;
+    gestureBindings_.push_back(GestureBinding{.gesture = *node.source.sequence[0].gesture, .modifiers = *mods, .action = std::move(*action)});
+}
+
+std::optional<std::pair<Press, ModifierFlags>> Interpreter::resolvePressChord(const ast::Chords& syn) {
+    if (syn.sequence.size() != 1) {
+        addError("trackpad_press must be a single chord, not part of a sequence");
+        return std::nullopt;
+    }
+    if (syn.passthrough || syn.repeat || syn.onRelease) {
+        addError("trackpad_press does not support '~', '&', or '^' flags");
+        return std::nullopt;
+    }
+    const auto& chord = syn.sequence[0];
+    if (chord.fingerCount) {
+        addError("trackpad_press does not support trackpad_fingers; use trackpad_press(N) for an N-finger press");
+        return std::nullopt;
+    }
+    // a hard press is deliberate, so like gestures it needs no modifier
+    auto flags = resolveModifiers(chord.modifiers);
+    if (!flags) return std::nullopt;
+
+    const auto& trigger = *chord.press;
+    Press press{.zone = trigger.zone, .fingers = trigger.fingers};
+    if (trigger.region) {
+        press.zone = lookupRegion(*trigger.region);
+        if (!press.zone) {
+            addError(std::format("unknown trackpad region '{}'; define it with define_region before use", *trigger.region));
+            return std::nullopt;
+        }
+    }
+    return std::pair{press, ModifierFlags{.flags = *flags}};
+}
+
+void Interpreter::applyPressHotkey(const ast::Hotkey& h) {
+    auto resolved = resolvePressChord(h.chords);
+    if (!resolved) return;
+    pressBindings_.push_back(PressBinding{.press = resolved->first, .modifiers = resolved->second, .action = unescapeDoubleBraces(h.command)});
+}
+
+void Interpreter::applyPressRemap(const ast::Remap& node) {
+    auto resolved = resolvePressChord(node.source);
+    if (!resolved) return;
+    auto action = buildRemapAction(node, true);
+    if (!action) return;
+    pressBindings_.push_back(PressBinding{.press = resolved->first, .modifiers = resolved->second, .action = std::move(*action)});
+}
+
+template <typename Apply>
+void Interpreter::applyReusable(uint64_t key, std::vector<Binding>& bindings, StatementReuse* reuse, Apply&& apply) {
+    if (!reuse) {
+        apply();
+        return;
+    }
+    auto [found, inserted] = reuse->outputs.try_emplace(key);
+    auto& out = found->second;
+    // the same text can now mean something else, when a define or region it names changed
+    if (!inserted && !dependenciesHold(out.dependencies)) {
+        out = {};
+        inserted = true;
+    }
+    if (inserted) {
+        const auto bindingsBefore = static_cast<ptrdiff_t>(bindings.size());
+        const auto tapsBefore = static_cast<ptrdiff_t>(tapBindings_.size());
+        const auto gesturesBefore = static_cast<ptrdiff_t>(gestureBindings_.size());
+        const auto pressesBefore = static_cast<ptrdiff_t>(pressBindings_.size());
+        const auto errorsBefore = static_cast<ptrdiff_t>(errors_.size());
+        dependencies_ = &out.dependencies;
+        apply();
+        dependencies_ = nullptr;
+        out.bindings.assign(bindings.begin() + bindingsBefore, bindings.end());
+        out.tapBindings.assign(tapBindings_.begin() + tapsBefore, tapBindings_.end());
+        out.gestureBindings.assign(gestureBindings_.begin() + gesturesBefore, gestureBindings_.end());
+        out.pressBindings.assign(pressBindings_.begin() + pressesBefore, pressBindings_.end());
+        out.errors.assign(errors_.begin() + errorsBefore, errors_.end());
+        out.revision = ++reuse->revision;
+        reuse->reinterpreted++;
+    } else {
+        bindings.insert(bindings.end(), out.bindings.begin(), out.bindings.end());
+        tapBindings_.insert(tapBindings_.end(), out.tapBindings.begin(), out.tapBindings.end());
+        gestureBindings_.insert(gestureBindings_.end(), out.gestureBindings.begin(), out.gestureBindings.end());
+        pressBindings_.insert(pressBindings_.end(), out.pressBindings.begin(), out.pressBindings.end());
+        errors_.insert(errors_.end(), out.errors.begin(), out.errors.end());
+    }
+    out.generation = reuse->generation;
+    if (!out.bindings.empty()) reuse->keyboardOrder.push_back(out.revision);
+    if (!out.tapBindings.empty() || !out.gestureBindings.empty() || !out.pressBindings.empty()) {
+        reuse->trackpadOrder.push_back(out.revision);
+    }
 }
 
-InterpreterResult Interpreter::interpret(const ast::Program& p) {
+InterpreterResult Interpreter::interpret(const ast::Program& p, StatementReuse* reuse) {
     InterpreterResult result{};
 
     // first pass: defines, config, and remaps
-    for (const auto& stmt : p.statements) {
+    for (size_t i = 0; i < p.statements.size(); i++) {
         std::visit([&](const auto& node) {
             using T = std::decay_t<decltype(node)>;
             if constexpr (std::is_same_v<T, ast::DefineModifier>) {
                 applyDefine(node);
+            } else if constexpr (std::is_same_v<T, ast::DefineRegion>) {
+                applyDefineRegion(node);
             } else if constexpr (std::is_same_v<T, ast::ConfigProperty>) {
                 applyConfig(node, result.config);
             } else if constexpr (std::is_same_v<T, ast::Remap>) {
-                applyRemap(node, result.bindings);
+                // a remap only sees the defines above it, which its dependencies are checked against here
+                const uint64_t key = reuse ? fnv1a64(p.sources[i]) : 0;
+                applyReusable(key, result.bindings, reuse, [&] { applyRemap(node, result.bindings); });
             }
         },
-            stmt);
+            p.statements[i]);
     }
 
     // second pass: hotkeys (need all defines resolved first)
-    for (const auto& stmt : p.statements) {
-        if (!std::holds_alternative<ast::Hotkey>(stmt)) continue;
-        applyHotkey(std::get<ast::Hotkey>(stmt), result.bindings);
+    for (size_t i = 0; i < p.statements.size(); i++) {
+        if (!std::holds_alternative<ast::Hotkey>(p.statements[i])) continue;
+        const uint64_t key = reuse ? fnv1a64(p.sources[i]) : 0;
+        applyReusable(key, result.bindings, reuse, [&] { applyHotkey(std::get<ast::Hotkey>(p.statements[i]), result.bindings); });
     }
+    result.tapRegions = boundTapRegions(result.config.cornerSize);
     result.tapBindings = std::move(tapBindings_);
+    result.gestureBindings = std::move(gestureBindings_);
+    result.pressBindings = std::move(pressBindings_);
     result.errors = std::move(errors_);
     return result;
 }
@@ -504,6 +978,82 @@ InterpreterResult interpretProgram(const ast::Program& p) {
     return Interpreter{}.interpret(p);
 }
 
+InterpreterResult IncrementalInterpreter::interpret(const ast::Program& p) {
+    // programs not built by the parser carry no statement sources to key on
+    if (p.sources.size() != p.statements.size()) {
+        reset();
+        stats_ = {.statements = p.statements.size(), .reinterpreted = p.statements.size()};
+        return interpretProgram(p);
+    }
+
+    uint64_t globals = kFnvOffset;
+    for (size_t i = 0; i < p.statements.size(); i++) {
+        if (std::holds_alternative<ast::Hotkey>(p.statements[i]) || std::holds_alternative<ast::Remap>(p.statements[i])) continue;
+        globals = fnv1a64(p.sources[i], globals);
+        globals = fnv1a64("\n", globals);
+    }
+    const bool full = !loaded_;
+    const bool globalsChanged = globals != globalsHash_;
+
+    StatementReuse reuse{.outputs = outputs_, .generation = ++generation_, .revision = revision_};
+    const auto start = std::chrono::steady_clock::now();
+    auto result = Interpreter{}.interpret(p, &reuse);
+    const auto interpretNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    // drop statements this load no longer has
+    std::erase_if(outputs_, [&](const auto& entry) { return entry.second.generation != generation_; });
+
+    stats_ = {
+        .statements = p.statements.size(),
+        .reinterpreted = reuse.reinterpreted,
+        .interpretNs = interpretNs,
+        .full = full,
+        .keyboardChanged = full || globalsChanged || reuse.keyboardOrder != keyboardOrder_,
+        .trackpadChanged = full || globalsChanged || reuse.trackpadOrder != trackpadOrder_,
+    };
+    keyboardOrder_ = std::move(reuse.keyboardOrder);
+    trackpadOrder_ = std::move(reuse.trackpadOrder);
+    globalsHash_ = globals;
+    loaded_ = true;
+    return result;
+}
+
+void IncrementalInterpreter::reset() {
+    loaded_ = false;
+    globalsHash_ = 0;
+    outputs_.clear();
+    keyboardOrder_.clear();
+    trackpadOrder_.clear();
+}
+
 ChordResult interpretChord(const ast::Chord& ch) {
     return Interpreter{}.interpretChord(ch);
 }
+
+std::string fillKeyCapture(std::string_view command, Keysym pressed) {
+    const auto layoutKey = lookupKeyString(pressed.keycode);
+    const std::string name = layoutKey ? std::string{*layoutKey} : std::format("{}", Keysym{.keycode = pressed.keycode});
+    // the command goes to sh -c, and the key can be any character the layout types: ; $ ' and the rest
+    std::string key = "'";
+    for (const char c : name) {
+        if (c == '\'') {
+            key += "'\\''";
+        } else {
+            key += c;
+        }
+    }
+    key += '\'';
+    std::string filled;
+    filled.reserve(command.size() + key.size());
+    for (size_t i = 0; i < command.size(); i++) {
+        if (command.substr(i, 2) == "{}") {
+            filled += key;
+            i++;
+        } else if ((command[i] == '{' || command[i] == '}') && i + 1 < command.size() && command[i + 1] == command[i]) {
+            filled += command[i];
+            i++;
+        } else {
+            filled += command[i];
+        }
+    }
+    return filled;
+}
@@ -1,13 +1,20 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
 #include "../input/chord.hpp"
+#include "../input/event_program.hpp"
+#include "../input/gesture.hpp"
 #include "../input/hotkey.hpp"
+#include "../input/press.hpp"
 #include "ast.hpp"
 
 struct ConfigProperties {
@@ -21,12 +28,19 @@ struct ConfigProperties {
     // max time between keysyms to be considered as simultaneous
     std::chrono::milliseconds simultaneousThreshold{50};
 
-    // corner size as a percent of each trackpad axis
+    // corner size, and edge strip depth, as a percent of each trackpad axis
     int cornerSize{15};
 
     // max finger-contact time for a corner tap
     std::chrono::milliseconds tapTimeout{300};
 
+    // raw trackpad pressure for a trackpad_press; varies by hardware, so measure
+    // with --record-touch when tuning
+    int pressThreshold{180};
+
+    // keys per second a typed string averages; they go out in short bursts
+    int typeRate{250};
+
     // process names to ignore (case-insensitive)
     std::vector<std::string> blacklist;
 
@@ -39,15 +53,29 @@ struct InterpreterError {
     std::string message;
 };
 
-// a binding's action is either a shell command (hotkey) or a target chord (remap)
-using BindingAction = std::variant<std::string, Chord>;
+// a remap's compiled output, for one that types more than a chord in place of its source: a
+// macro (`a | cmd + c ; cmd + v`), text (`a | "text"`) or the target of a chord sequence. shared so
+// the output thread can keep posting it after a reload replaces the binding
+struct KeyProgram {
+    std::shared_ptr<const EventProgram> program;
+
+    bool operator==(const KeyProgram& other) const { return *program == *other.program; }
+};
+
+// a binding's action is a shell command (hotkey), a target chord (remap) or a compiled program. a
+// key(...) hotkey's command is a template, braces still escaped, whose '{}' is the key pressed
+using BindingAction = std::variant<std::string, Chord, KeyProgram>;
 
 struct Binding {
     Hotkey source;
     BindingAction action;
 };
 
-// a corner-tap trigger and its action, dispatched by the touch layer rather than
+// a key(...) hotkey's command with each '{}' made the key pressed, single-quoted for the shell,
+// and its doubled braces undoubled
+std::string fillKeyCapture(std::string_view command, Keysym pressed);
+
+// a trackpad-zone tap trigger and its action, dispatched by the touch layer rather than
 // the keyboard event tap
 struct TapBinding {
     Zone zone;
@@ -55,9 +83,27 @@ struct TapBinding {
     BindingAction action;
 };
 
+// a multi-finger swipe/pinch/tap trigger and its action, also dispatched by the touch layer
+struct GestureBinding {
+    Gesture gesture;
+    ModifierFlags modifiers;
+    BindingAction action;
+};
+
+// a force-press trigger and its action, also dispatched by the touch layer
+struct PressBinding {
+    Press press;
+    ModifierFlags modifiers;
+    BindingAction action;
+};
+
 struct InterpreterResult {
     std::vector<Binding> bindings;
     std::vector<TapBinding> tapBindings;
+    // where each zone used by tap and press bindings lies on the trackpad
+    std::vector<TapRegion> tapRegions;
+    std::vector<GestureBinding> gestureBindings;
+    std::vector<PressBinding> pressBindings;
     ConfigProperties config;
     std::vector<InterpreterError> errors;
 };
@@ -67,6 +113,69 @@ struct ChordResult {
     std::vector<InterpreterError> errors;
 };
 
+// interprets successive loads of one config. each hotkey and remap statement's output is
+// kept under a hash of its source text along with the define_modifier and define_region names
+// it resolved, so the next load re-interprets only the statements whose text changed or whose
+// names now resolve differently, and copies the output of the rest into the new tables. no
+// statement reads a config property, so changing one re-interprets nothing
+class IncrementalInterpreter {
+   public:
+    struct Stats {
+        size_t statements{};
+        // hotkey and remap statements interpreted rather than reused
+        size_t reinterpreted{};
+        // interpreting the program, reused statements included; parsing and loading are not
+        int64_t interpretNs{};
+        // nothing was reused: the first load, or the first since reset()
+        bool full{true};
+        // whether the keyboard, or trackpad, bindings differ from the previous load's
+        bool keyboardChanged{true};
+        bool trackpadChanged{true};
+    };
+
+    [[nodiscard]] InterpreterResult interpret(const ast::Program& p);
+    [[nodiscard]] const Stats& lastStats() const { return stats_; }
+    [[nodiscard]] bool hasPrevious() const { return loaded_; }
+    // forget the previous load, e.g. when its result was rejected, so the next one is full
+    void reset();
+
+    // a name a statement resolved, and what it resolved to then: a modifier's flags or a region's
+    // zone, nullopt when it wasn't defined
+    struct Dependency {
+        enum class Kind : uint8_t { Modifier, Region };
+        Kind kind;
+        std::string name;
+        std::optional<int> value;
+    };
+
+    // what one hotkey or remap statement added to the compiled tables
+    struct StatementOutput {
+        std::vector<Binding> bindings;
+        std::vector<TapBinding> tapBindings;
+        std::vector<GestureBinding> gestureBindings;
+        std::vector<PressBinding> pressBindings;
+        std::vector<InterpreterError> errors;
+        std::vector<Dependency> dependencies;
+        // the last load that had this statement; older entries are dropped after each load
+        uint32_t generation{};
+        // new each time the statement is interpreted, so the table orders below see a re-interpretation
+        uint64_t revision{};
+    };
+
+   private:
+    bool loaded_{};
+    uint32_t generation_{};
+    uint64_t revision_{};
+    // of the define and config statements' text: config properties reach the engine with the
+    // tables, so a change there counts as a table change even when no binding changed
+    uint64_t globalsHash_{};
+    std::unordered_map<uint64_t, StatementOutput> outputs_;
+    // revisions of the statements with keyboard (trackpad) bindings, in table order
+    std::vector<uint64_t> keyboardOrder_;
+    std::vector<uint64_t> trackpadOrder_;
+    Stats stats_;
+};
+
 [[nodiscard]] InterpreterResult interpretProgram(const ast::Program& p);
 
 [[nodiscard]] ChordResult interpretChord(const ast::Chord& ch);
@@ -1,40 +1,67 @@
 #include "parser.hpp"
 
+#include <algorithm>
+
 #include "ast.hpp"
 
 ast::Program Parser::parseProgram() {
-    ast::Program program;
+    auto statements = makeList<ast::Stmt>();
+    auto sources = makeList<std::string_view>();
+    // at most one statement per line; growing instead would strand every old buffer in the arena
+    const auto maxStatements = static_cast<size_t>(std::ranges::count(storage_->source.view(), '\n')) + 1;
+    statements.reserve(maxStatements);
+    sources.reserve(maxStatements);
     while (true) {
         const Token tk = tokenizer.peek();
         if (tk.type == TokenType::EndOfFile) {
             break;
         }
         const int startRow = tk.row;
+        const char* start = tk.text.data();
         bool parsed = false;
         if (tk.type == TokenType::DefineModifier) {
             if (auto stmt = parseDefineModifierStmt()) {
-                program.statements.emplace_back(std::move(*stmt));
+                statements.emplace_back(std::move(*stmt));
+                parsed = true;
+            }
+        } else if (tk.type == TokenType::DefineRegion) {
+            if (auto stmt = parseDefineRegionStmt()) {
+                statements.emplace_back(std::move(*stmt));
                 parsed = true;
             }
         } else if (tk.type == TokenType::ConfigProperty) {
             if (auto stmt = parseConfigPropertyStmt()) {
-                program.statements.emplace_back(std::move(*stmt));
+                statements.emplace_back(std::move(*stmt));
                 parsed = true;
             }
         } else {
             if (auto stmt = parseBindingStmt()) {
-                program.statements.emplace_back(std::move(*stmt));
+                statements.emplace_back(std::move(*stmt));
                 parsed = true;
             }
         }
-        // drop remaining tokens on the failing line, so only a single error is produced, rather than multiple
-        if (!parsed) {
+        if (parsed) {
+            sources.emplace_back(start, static_cast<size_t>(tokenizer.endOfConsumed() - start));
+        } else {
+            // drop remaining tokens on the failing line, so only a single error is produced, rather than multiple
             skipRemainingTokensOnRow(startRow);
         }
     }
+    ast::Program program{std::move(storage_)};
+    // same arena on both sides, so these take the buffers rather than moving nodes
+    program.statements = std::move(statements);
+    program.sources = std::move(sources);
     return program;
 }
 
+std::string_view Parser::stringValue(const Token& token, Escapes escapes) {
+    if (!token.escaped) return token.text;
+    const std::string value = token.unquoted(escapes);
+    auto* bytes = static_cast<char*>(storage_->arena.allocate(value.size(), alignof(char)));
+    std::ranges::copy(value, bytes);
+    return {bytes, value.size()};
+}
+
 void Parser::addError(const Token& token, std::string message) {
     errors_.push_back(ParseError{
         .row = token.row,
@@ -91,13 +118,12 @@ std::optional<ast::DefineModifier> Parser::parseDefineModifierStmt() {
         addUnexpectedTokenError(nameToken, "after 'define_modifier'", "custom modifier name");
         return std::nullopt;
     }
-    std::string customName = nameToken.text;
+    const std::string_view customName = nameToken.text;
     auto eqToken = expect(TokenType::Equals, "after custom modifier name");
     if (!eqToken) {
         return std::nullopt;
     }
-    ast::DefineModifier stmt;
-    stmt.name = customName;
+    ast::DefineModifier stmt{.name = customName, .parts = makeList<ast::Modifier>()};
     const int currentRow = eqToken->row;
     while (true) {
         const Token& tk = tokenizer.peek();
@@ -125,6 +151,51 @@ std::optional<ast::DefineModifier> Parser::parseDefineModifierStmt() {
     return stmt;
 }
 
+std::optional<ast::DefineRegion> Parser::parseDefineRegionStmt() {
+    // define_region name = rect(x0, y0, x1, y1) | grid(cols, rows, col, row)
+    const Token defineToken = tokenizer.next();
+    const Token nameToken = tokenizer.next();
+    if (nameToken.type != TokenType::Modifier && nameToken.type != TokenType::Key) {
+        addUnexpectedTokenError(nameToken, "after 'define_region'", "region name");
+        return std::nullopt;
+    }
+    if (!expect(TokenType::Equals, "after region name")) {
+        return std::nullopt;
+    }
+    const Token shapeToken = tokenizer.next();
+    ast::DefineRegion stmt{.name = nameToken.text, .shape = ast::RegionShape::Rect, .args = {}};
+    if (shapeToken.text == "grid") {
+        stmt.shape = ast::RegionShape::Grid;
+    } else if (shapeToken.text != "rect") {
+        addUnexpectedTokenError(shapeToken, std::format("in region '{}'", nameToken.text), "rect(...) or grid(...)");
+        return std::nullopt;
+    }
+    if (!expect(TokenType::OpenParen, std::format("after '{}'", shapeToken.text))) {
+        return std::nullopt;
+    }
+    for (size_t i = 0; i < stmt.args.size(); i++) {
+        if (i > 0 && !expect(TokenType::Comma, std::format("between {}(...) arguments", shapeToken.text))) {
+            return std::nullopt;
+        }
+        const Token numTk = tokenizer.next();
+        if (numTk.type != TokenType::Integer) {
+            addUnexpectedTokenError(numTk, std::format("in {}(...)", shapeToken.text), "integer percent");
+            return std::nullopt;
+        }
+        try {
+            stmt.args.at(i) = std::stoi(std::string{numTk.text});
+        } catch (const std::out_of_range&) {
+            addError(numTk, std::format("value '{}' in {}(...) is out of range", numTk.text, shapeToken.text));
+            return std::nullopt;
+        }
+    }
+    if (!expect(TokenType::CloseParen, std::format("after {}(...) arguments", shapeToken.text))) {
+        return std::nullopt;
+    }
+    dropTrailingTokens(defineToken.row, "after region definition");
+    return stmt;
+}
+
 std::optional<ast::ConfigProperty> Parser::parseConfigPropertyStmt() {
     Token cpToken = tokenizer.next();
     if (cpToken.text == "blacklist") {
@@ -137,8 +208,7 @@ std::optional<ast::ConfigProperty> Parser::parseConfigPropertyStmt() {
 }
 
 std::optional<ast::ConfigProperty> Parser::parseBlacklistConfigStmt(const Token& cpToken) {
-    ast::ConfigProperty stmt;
-    stmt.name = cpToken.text;
+    ast::ConfigProperty stmt{.name = cpToken.text, .stringListValues = makeList<std::string_view>()};
 
     if (!expect(TokenType::Equals, "after blacklist config")) {
         return std::nullopt;
@@ -164,7 +234,7 @@ std::optional<ast::ConfigProperty> Parser::parseBlacklistConfigStmt(const Token&
         }
         Token valueToken = tokenizer.next();
         if (!valueToken.text.empty()) {
-            stmt.stringListValues.push_back(valueToken.text);
+            stmt.stringListValues.push_back(stringValue(valueToken));
         }
     }
     if (stmt.stringListValues.empty()) {
@@ -189,7 +259,7 @@ std::optional<ast::ConfigProperty> Parser::parseIntegerConfigStmt(const Token& c
     }
     // tokenizer guarantees all-digit text; only out-of-range can throw
     try {
-        stmt.intValue = std::stoi(intToken.text);
+        stmt.intValue = std::stoi(std::string{intToken.text});
     } catch (const std::out_of_range&) {
         addError(intToken, std::format(
                                "value '{}' for config property '{}' is out of range",
@@ -213,14 +283,14 @@ std::optional<ast::ConfigProperty> Parser::parseStringConfigStmt(const Token& cp
         addUnexpectedTokenError(strToken, std::format("after '=' for config property '{}'", cpToken.text), "string");
         return std::nullopt;
     }
-    stmt.stringValue = strToken.text;
+    stmt.stringValue = stringValue(strToken);
 
     dropTrailingTokens(cpToken.row, std::format("after config property '{}'", cpToken.text));
     return stmt;
 }
 
 std::optional<ast::Keysym> Parser::parseBraceExpansionKeysym() {
-    ast::BraceExpansionKeysym be;
+    ast::BraceExpansionKeysym be{.alternatives = makeList<ast::SimpleKeysym>()};
     if (!expect(TokenType::OpenBrace, "to start brace expansion")) {
         return std::nullopt;
     }
@@ -296,7 +366,7 @@ std::optional<ast::SimpleKeysym> Parser::consumeSimpleKeysym() {
         }
         uint64_t v = 0;
         try {
-            v = std::stoul(tk.text, nullptr, 16);
+            v = std::stoul(std::string{tk.text}, nullptr, 16);
         } catch (const std::out_of_range&) {
             addError(tk, std::format("hex keycode '0x{}' is out of range (max 0xFF)", tk.text));
             return std::nullopt;
@@ -325,7 +395,7 @@ bool Parser::startsChord(const Token& tk) {
 }
 
 std::optional<ast::Chord> Parser::parseChord(int row, const ChordParseOptions& options) {
-    ast::Chord chord;
+    ast::Chord chord = makeChord();
     while (true) {
         const Token& tk = tokenizer.peek();
         if (tk.type == TokenType::EndOfFile || tk.row != row) {
@@ -355,7 +425,7 @@ std::optional<ast::Chord> Parser::parseChord(int row, const ChordParseOptions& o
             tokenizer.next();
             int count = 0;
             try {
-                count = std::stoi(numTk.text);
+                count = std::stoi(std::string{numTk.text});
             } catch (const std::out_of_range&) {
                 addError(numTk, std::format("finger count '{}' is out of range", numTk.text));
                 return std::nullopt;
@@ -371,27 +441,94 @@ std::optional<ast::Chord> Parser::parseChord(int row, const ChordParseOptions& o
                 addError(tk, "trackpad_tap(...) is not allowed here");
                 return std::nullopt;
             }
-            if (chord.key.has_value() || chord.tap.has_value()) {
+            if (ast::hasTrigger(chord)) {
                 addUnexpectedTokenError(tk, "after chord key");
                 return std::nullopt;
             }
             tokenizer.next();
             tokenizer.next();
             const Token zoneTk = tokenizer.peek();
-            if (zoneTk.type != TokenType::Modifier && zoneTk.type != TokenType::Key) {
-                addUnexpectedTokenError(zoneTk, "in trackpad_tap(...)", "corner zone tl/tr/bl/br");
+            if (zoneTk.type == TokenType::Integer) {
+                // trackpad_tap(N): an N-finger tap anywhere on the pad
+                auto fingers = parseGestureFingers("trackpad_tap");
+                if (!fingers) return std::nullopt;
+                if (!expect(TokenType::CloseParen, "after finger count")) {
+                    return std::nullopt;
+                }
+                chord.gesture = Gesture{.kind = GestureKind::Tap, .fingers = *fingers};
+                break;
+            }
+            auto zone = parseZoneArgument("trackpad_tap");
+            if (!zone) return std::nullopt;
+            if (const auto* builtin = std::get_if<Zone>(&*zone)) {
+                chord.tap = *builtin;
+            } else {
+                chord.tapRegion = std::get<std::string_view>(*zone);
+            }
+            if (!expect(TokenType::CloseParen, "after trackpad zone")) {
+                return std::nullopt;
+            }
+            break;
+        }
+        if (tk.type == TokenType::Modifier && tk.text == "trackpad_press" && tokenizer.peek(1).type == TokenType::OpenParen) {
+            if (!options.allowTap) {
+                addError(tk, "trackpad_press(...) is not allowed here");
+                return std::nullopt;
+            }
+            if (ast::hasTrigger(chord)) {
+                addUnexpectedTokenError(tk, "after chord key");
+                return std::nullopt;
+            }
+            const Token triggerTk = tokenizer.next();
+            tokenizer.next();
+            auto press = parsePressTrigger(triggerTk);
+            if (!press) {
+                return std::nullopt;
+            }
+            chord.press = std::move(*press);
+            break;
+        }
+        if (tk.type == TokenType::Modifier && (tk.text == "trackpad_swipe" || tk.text == "trackpad_pinch")
+            && tokenizer.peek(1).type == TokenType::OpenParen) {
+            if (!options.allowTap) {
+                addError(tk, std::format("{}(...) is not allowed here", tk.text));
                 return std::nullopt;
             }
-            auto zone = parseZone(zoneTk.text);
-            if (!zone) {
-                addError(zoneTk, std::format("invalid corner zone '{}', expected tl, tr, bl, or br", zoneTk.text));
+            if (ast::hasTrigger(chord)) {
+                addUnexpectedTokenError(tk, "after chord key");
                 return std::nullopt;
             }
+            const Token triggerTk = tokenizer.next();
             tokenizer.next();
-            if (!expect(TokenType::CloseParen, "after corner zone")) {
+            auto gesture = triggerTk.text == "trackpad_swipe" ? parseSwipeTrigger(triggerTk) : parsePinchTrigger(triggerTk);
+            if (!gesture) {
                 return std::nullopt;
             }
-            chord.tap = *zone;
+            chord.gesture = *gesture;
+            break;
+        }
+        if (tk.type == TokenType::Modifier && tk.text == "key" && tokenizer.peek(1).type == TokenType::OpenParen) {
+            if (!options.allowWildcard) {
+                addError(tk, "key(...) is not allowed here");
+                return std::nullopt;
+            }
+            if (ast::hasTrigger(chord)) {
+                addUnexpectedTokenError(tk, "after chord key");
+                return std::nullopt;
+            }
+            tokenizer.next();
+            tokenizer.next();
+            const Token classTk = tokenizer.peek();
+            auto keyClass = parseKeyClass(classTk.text);
+            if (!keyClass) {
+                addError(classTk, std::format("invalid key class '{}', expected any, letter, or digit", classTk.text));
+                return std::nullopt;
+            }
+            tokenizer.next();
+            if (!expect(TokenType::CloseParen, "after key class")) {
+                return std::nullopt;
+            }
+            chord.key = ast::WildcardKeysym{*keyClass};
             break;
         }
         if (tk.type == TokenType::Modifier && !chord.key.has_value()) {
@@ -440,7 +577,7 @@ std::optional<ast::Chord> Parser::parseChord(int row, const ChordParseOptions& o
         break;
     }
 
-    if (!chord.key.has_value() && !chord.tap.has_value()) {
+    if (!ast::hasTrigger(chord)) {
         const Token& tk = tokenizer.peek();
         addError(tk, "chord is missing a key");
         return std::nullopt;
@@ -448,6 +585,127 @@ std::optional<ast::Chord> Parser::parseChord(int row, const ChordParseOptions& o
     return chord;
 }
 
+std::optional<std::variant<Zone, std::string_view>> Parser::parseZoneArgument(std::string_view trigger) {
+    // zone, or region:name where name is a built-in zone or a define_region name
+    const Token zoneTk = tokenizer.peek();
+    if (zoneTk.type != TokenType::Modifier && zoneTk.type != TokenType::Key) {
+        addUnexpectedTokenError(zoneTk, std::format("in {}(...)", trigger), "zone, region:name, or finger count");
+        return std::nullopt;
+    }
+    tokenizer.next();
+    if (zoneTk.text == "region" && tokenizer.peek().type == TokenType::Colon) {
+        tokenizer.next();
+        const Token regionTk = tokenizer.next();
+        if (regionTk.type != TokenType::Modifier && regionTk.type != TokenType::Key) {
+            addUnexpectedTokenError(regionTk, "after 'region:'", "region name");
+            return std::nullopt;
+        }
+        if (auto zone = parseZone(regionTk.text)) return *zone;
+        return regionTk.text;
+    }
+    if (auto zone = parseZone(zoneTk.text)) return *zone;
+    addError(zoneTk, std::format("invalid trackpad zone '{}', expected tl, tr, bl, br, top_edge, bottom_edge, left_edge, right_edge, or region:name", zoneTk.text));
+    return std::nullopt;
+}
+
+std::optional<ast::PressTrigger> Parser::parsePressTrigger(const Token& triggerTk) {
+    // trackpad_press(zone | region:name) for one finger, trackpad_press(N) for N anywhere
+    ast::PressTrigger press;
+    const Token argTk = tokenizer.peek();
+    if (argTk.type == TokenType::Integer) {
+        tokenizer.next();
+        int fingers = 0;
+        try {
+            fingers = std::stoi(std::string{argTk.text});
+        } catch (const std::out_of_range&) {
+            fingers = -1;
+        }
+        if (fingers < 1 || fingers > kMaxPressFingers) {
+            addError(argTk, std::format("finger count for {}(...) must be between 1 and {} (got {})",
+                                triggerTk.text, kMaxPressFingers, argTk.text));
+            return std::nullopt;
+        }
+        press.fingers = fingers;
+    } else {
+        auto zone = parseZoneArgument(triggerTk.text);
+        if (!zone) return std::nullopt;
+        if (const auto* builtin = std::get_if<Zone>(&*zone)) {
+            press.zone = *builtin;
+        } else {
+            press.region = std::get<std::string_view>(*zone);
+        }
+    }
+    if (!expect(TokenType::CloseParen, std::format("after {}(...) argument", triggerTk.text))) {
+        return std::nullopt;
+    }
+    return press;
+}
+
+std::optional<int> Parser::parseGestureFingers(std::string_view trigger) {
+    const Token numTk = tokenizer.peek();
+    if (numTk.type != TokenType::Integer) {
+        addUnexpectedTokenError(numTk, std::format("in {}(...)", trigger), "finger count");
+        return std::nullopt;
+    }
+    tokenizer.next();
+    int fingers = 0;
+    try {
+        fingers = std::stoi(std::string{numTk.text});
+    } catch (const std::out_of_range&) {
+        fingers = -1;
+    }
+    if (fingers < kMinGestureFingers || fingers > kMaxGestureFingers) {
+        addError(numTk, std::format("finger count for {}(...) must be between {} and {} (got {})",
+                            trigger, kMinGestureFingers, kMaxGestureFingers, numTk.text));
+        return std::nullopt;
+    }
+    return fingers;
+}
+
+std::optional<Gesture> Parser::parseSwipeTrigger(const Token& triggerTk) {
+    // trackpad_swipe(N, left|right|up|down)
+    auto fingers = parseGestureFingers(triggerTk.text);
+    if (!fingers) return std::nullopt;
+    if (!expect(TokenType::Comma, "after finger count")) {
+        return std::nullopt;
+    }
+    const Token dirTk = tokenizer.peek();
+    auto kind = parseSwipeDirection(dirTk.text);
+    if (!kind) {
+        addError(dirTk, std::format("invalid swipe direction '{}', expected left, right, up, or down", dirTk.text));
+        return std::nullopt;
+    }
+    tokenizer.next();
+    if (!expect(TokenType::CloseParen, "after swipe direction")) {
+        return std::nullopt;
+    }
+    return Gesture{.kind = *kind, .fingers = *fingers};
+}
+
+std::optional<Gesture> Parser::parsePinchTrigger(const Token& triggerTk) {
+    // trackpad_pinch(in|out), or trackpad_pinch(N, in|out) for more than two fingers
+    int fingers = kMinGestureFingers;
+    if (tokenizer.peek().type == TokenType::Integer) {
+        auto parsed = parseGestureFingers(triggerTk.text);
+        if (!parsed) return std::nullopt;
+        if (!expect(TokenType::Comma, "after finger count")) {
+            return std::nullopt;
+        }
+        fingers = *parsed;
+    }
+    const Token dirTk = tokenizer.peek();
+    auto kind = parsePinchDirection(dirTk.text);
+    if (!kind) {
+        addError(dirTk, std::format("invalid pinch direction '{}', expected in or out", dirTk.text));
+        return std::nullopt;
+    }
+    tokenizer.next();
+    if (!expect(TokenType::CloseParen, "after pinch direction")) {
+        return std::nullopt;
+    }
+    return Gesture{.kind = *kind, .fingers = fingers};
+}
+
 std::optional<ast::Chord> Parser::parseSequenceElement(const ChordParseOptions& options) {
     const Token start = tokenizer.peek();
     if (start.type == TokenType::EndOfFile) {
@@ -500,8 +758,8 @@ std::optional<ast::Chord> Parser::parseChord(const ChordParseOptions& options) {
     return chord;
 }
 
-std::optional<std::vector<ast::Chord>> Parser::parseChordSequence(const ChordParseOptions& options) {
-    std::vector<ast::Chord> chords;
+std::optional<ast::List<ast::Chord>> Parser::parseChordSequence(const ChordParseOptions& options) {
+    auto chords = makeList<ast::Chord>();
     const int row = tokenizer.peek().row;
     while (true) {
         auto chord = parseSequenceElement(options);
@@ -514,7 +772,7 @@ std::optional<std::vector<ast::Chord>> Parser::parseChordSequence(const ChordPar
 }
 
 std::optional<ast::Stmt> Parser::parseBindingStmt() {
-    auto sequence = parseChordSequence(ChordParseOptions{.allowBraceExpansion = true});
+    auto sequence = parseChordSequence(ChordParseOptions{.allowBraceExpansion = true, .allowWildcard = true});
     if (!sequence) {
         return std::nullopt;
     }
@@ -559,32 +817,43 @@ std::optional<ast::Stmt> Parser::parseBindingStmt() {
 }
 
 std::optional<ast::Hotkey> Parser::parseHotkeyStmt(ast::Chords binding) {
-    ast::Hotkey stmt;
     auto nextTk = expect(TokenType::Command, "after ':'");
     if (!nextTk) return std::nullopt;
     if (nextTk->text.empty()) {
         addUnexpectedTokenError(*nextTk, "after ':'", "non-empty command");
         return std::nullopt;
     }
-    stmt.chords = std::move(binding);
-    stmt.command = nextTk->text;
-    return stmt;
+    // constructed rather than assigned so the node lists stay in the arena
+    return ast::Hotkey{.chords = std::move(binding), .command = nextTk->text};
 }
 
 std::optional<ast::Remap> Parser::parseRemapStmt(ast::Chords binding) {
-    ast::Remap stmt;
-    stmt.source = std::move(binding);
     tokenizer.next();
     const Token start = tokenizer.peek();
     if (start.type == TokenType::EndOfFile) {
         addUnexpectedEofError(start, "after '|'", "remap target chord");
         return std::nullopt;
     }
-    auto target = parseChord(start.row, ChordParseOptions{.allowBraceExpansion = false, .allowFingerCount = false, .allowTap = false});
+    if (start.type == TokenType::String) {
+        tokenizer.next();
+        const auto text = stringValue(start, Escapes::Text);
+        dropTrailingTokens(start.row, "after remap text");
+        return ast::Remap{.source = std::move(binding), .target = makeChord(), .macro = makeList<ast::Chord>(), .text = text};
+    }
+    const ChordParseOptions options{.allowBraceExpansion = false, .allowFingerCount = false, .allowTap = false};
+    auto target = parseChord(start.row, options);
     if (!target) {
         return std::nullopt;
     }
-    stmt.target = std::move(*target);
+    auto macro = makeList<ast::Chord>();
+    while (tokenizer.peek().type == TokenType::Semicolon && tokenizer.peek().row == start.row) {
+        tokenizer.next();
+        auto chord = parseSequenceElement(options);
+        if (!chord) {
+            return std::nullopt;
+        }
+        macro.push_back(std::move(*chord));
+    }
     dropTrailingTokens(start.row, "after remap target");
-    return stmt;
+    return ast::Remap{.source = std::move(binding), .target = std::move(*target), .macro = std::move(macro)};
 }
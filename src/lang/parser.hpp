@@ -1,7 +1,9 @@
 #pragma once
 
+#include <memory>
 #include <optional>
 #include <string>
+#include <variant>
 #include <vector>
 
 #include "ast.hpp"
@@ -17,23 +19,39 @@ struct ParseError {
 struct ChordParseOptions {
     bool allowBraceExpansion{false};
     bool allowFingerCount{true};
+    // trackpad triggers: trackpad_tap, trackpad_swipe, trackpad_pinch
     bool allowTap{true};
+    // key(class) in key position
+    bool allowWildcard{false};
 };
 
 class Parser {
    private:
-    std::string contents_;
+    // source and arena for the AST; handed to the Program by parseProgram
+    std::unique_ptr<ast::ProgramStorage> storage_;
     Tokenizer tokenizer;
     std::vector<ParseError> errors_;
 
    public:
-    explicit Parser(std::string contents) : contents_(std::move(contents)), tokenizer(contents_) {}
+    explicit Parser(SourceBuffer source)
+        : storage_(std::make_unique<ast::ProgramStorage>(std::move(source))), tokenizer(storage_->source.view()) {}
+    explicit Parser(std::string contents) : Parser(SourceBuffer{std::move(contents)}) {}
+    // takes ownership of the source and arena, so call it at most once and not before parseChord.
+    // chords from parseChord point into the parser and must not outlive it
     ast::Program parseProgram();
     std::optional<ast::Chord> parseChord(const ChordParseOptions& options = {});
-    std::optional<std::vector<ast::Chord>> parseChordSequence(const ChordParseOptions& options = {});
+    std::optional<ast::List<ast::Chord>> parseChordSequence(const ChordParseOptions& options = {});
     [[nodiscard]] const std::vector<ParseError>& errors() const { return errors_; }
 
    private:
+    template <typename T>
+    [[nodiscard]] ast::List<T> makeList() {
+        return ast::List<T>(&storage_->arena);
+    }
+    [[nodiscard]] ast::Chord makeChord() { return ast::Chord{.modifiers = makeList<ast::Modifier>()}; }
+    // the value of a String token, unescaped into the arena when it has to be
+    [[nodiscard]] std::string_view stringValue(const Token& token, Escapes escapes = Escapes::Quoting);
+
     [[nodiscard]] static bool isKeyToken(TokenType type);
     [[nodiscard]] static bool isFlagToken(TokenType type);
     [[nodiscard]] static bool startsChord(const Token& tk);
@@ -47,12 +65,18 @@ class Parser {
     void dropTrailingTokens(int row, std::string_view context);
 
     std::optional<ast::DefineModifier> parseDefineModifierStmt();
+    std::optional<ast::DefineRegion> parseDefineRegionStmt();
     std::optional<ast::ConfigProperty> parseConfigPropertyStmt();
     std::optional<ast::ConfigProperty> parseBlacklistConfigStmt(const Token& cpToken);
     std::optional<ast::ConfigProperty> parseIntegerConfigStmt(const Token& cpToken);
     std::optional<ast::ConfigProperty> parseStringConfigStmt(const Token& cpToken);
     std::optional<ast::Keysym> parseBraceExpansionKeysym();
     [[nodiscard]] std::optional<ast::SimpleKeysym> consumeSimpleKeysym();
+    std::optional<std::variant<Zone, std::string_view>> parseZoneArgument(std::string_view trigger);
+    std::optional<ast::PressTrigger> parsePressTrigger(const Token& triggerTk);
+    std::optional<int> parseGestureFingers(std::string_view trigger);
+    std::optional<Gesture> parseSwipeTrigger(const Token& triggerTk);
+    std::optional<Gesture> parsePinchTrigger(const Token& triggerTk);
     std::optional<ast::Chord> parseChord(int row, const ChordParseOptions& options);
     std::optional<ast::Chord> parseSequenceElement(const ChordParseOptions& options);
     std::optional<bool> consumeSequenceSeparator(int row);
@@ -2,10 +2,12 @@
 
 #include <format>
 #include <string>
+#include <string_view>
 
 enum class TokenType {
     Invalid,
     DefineModifier,
+    DefineRegion,
     Modifier,
     Key,
     KeyHex,
@@ -39,6 +41,7 @@ struct std::formatter<TokenType> : std::formatter<std::string_view> {
         switch (tt) {
             case TokenType::Invalid: name = "Invalid"; break;
             case TokenType::DefineModifier: name = "DefineModifier"; break;
+            case TokenType::DefineRegion: name = "DefineRegion"; break;
             case TokenType::Modifier: name = "Modifier"; break;
             case TokenType::Key: name = "Key"; break;
             case TokenType::KeyHex: name = "KeyHex"; break;
@@ -69,11 +72,45 @@ struct std::formatter<TokenType> : std::formatter<std::string_view> {
     }
 };
 
+// which backslash escapes a string takes: \" and \\ in every string, \n and \t as well only
+// in text to type, so a process name or command keeps any other backslash as written
+enum class Escapes { Quoting, Text };
+
+// text is a slice of the tokenizer's input, so a token is only valid while that buffer is.
+// for String tokens it is the raw contents between the quotes; use unquoted() for the value
 struct Token {
     TokenType type;
-    std::string text;
+    std::string_view text;
     int row;
     int col;
+    // a String token whose text still contains backslash escapes
+    bool escaped{};
+
+    // \" and \\ are a quote and a backslash, and with Escapes::Text \n and \t a newline and a
+    // tab; any other backslash is kept
+    [[nodiscard]] std::string unquoted(Escapes escapes = Escapes::Quoting) const {
+        if (!escaped) return std::string{text};
+        std::string out;
+        out.reserve(text.size());
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] != '\\' || i + 1 == text.size()) {
+                out.push_back(text[i]);
+                continue;
+            }
+            const char next = text[i + 1];
+            if (next == '"' || next == '\\') {
+                out.push_back(next);
+            } else if (escapes == Escapes::Text && next == 'n') {
+                out.push_back('\n');
+            } else if (escapes == Escapes::Text && next == 't') {
+                out.push_back('\t');
+            } else {
+                out.append(text.substr(i, 2));
+            }
+            i++;
+        }
+        return out;
+    }
 };
 
 template <>
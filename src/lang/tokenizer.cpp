@@ -1,24 +1,62 @@
 #include "tokenizer.hpp"
 
 #include <algorithm>
+#include <cassert>
 #include <cctype>
 
+#include "../common/perfect_hash.hpp"
 #include "../input/keysym.hpp"
 
+namespace {
+
+struct KeywordEntry {
+    std::string_view name;
+    TokenType type;
+};
+
+constexpr std::array<KeywordEntry, 11> keywords = {{
+    {"define_modifier", TokenType::DefineModifier},
+    {"define_region", TokenType::DefineRegion},
+    {"max_chord_interval", TokenType::ConfigProperty},
+    {"hold_modifier_threshold", TokenType::ConfigProperty},
+    {"simultaneous_threshold", TokenType::ConfigProperty},
+    {"blacklist", TokenType::ConfigProperty},
+    {"sequence_command", TokenType::ConfigProperty},
+    {"corner_size", TokenType::ConfigProperty},
+    {"tap_timeout", TokenType::ConfigProperty},
+    {"press_threshold", TokenType::ConfigProperty},
+    {"type_rate", TokenType::ConfigProperty},
+}};
+
+constexpr auto keyword_index = perfectHashOfNames(keywords);
+
+}  // namespace
+
+std::optional<TokenType> lookupKeyword(std::string_view text) {
+    if (auto i = keyword_index.find(text)) return keywords[*i].type;
+    return std::nullopt;
+}
+
 const Token& Tokenizer::peek(size_t offset) {
-    while (bufferedTokens.size() <= offset) {
-        bufferedTokens.push_back(getNextToken());
+    assert(offset < kMaxLookahead);
+    while (bufferedCount <= offset) {
+        bufferedTokens[(bufferedHead + bufferedCount) % kMaxLookahead] = getNextToken();
+        bufferedCount++;
     }
-    return bufferedTokens[offset];
+    return bufferedTokens[(bufferedHead + offset) % kMaxLookahead];
 }
 
 Token Tokenizer::next() {
-    if (!bufferedTokens.empty()) {
-        Token token = bufferedTokens.front();
-        bufferedTokens.pop_front();
-        return token;
+    Token token{};
+    if (bufferedCount > 0) {
+        token = bufferedTokens[bufferedHead];
+        bufferedHead = (bufferedHead + 1) % kMaxLookahead;
+        bufferedCount--;
+    } else {
+        token = getNextToken();
     }
-    return getNextToken();
+    if (token.type != TokenType::EndOfFile) consumedEnd = token.text.data() + token.text.size();
+    return token;
 }
 
 bool Tokenizer::hasRemainingInput(int offset) {
@@ -38,92 +76,78 @@ Token Tokenizer::getNextToken() {
         char c = peekChar();
         int startRow = row;
         int startCol = col;
+        // single-character tokens are slices too, so a token always says where it sits in the source
+        const auto symbol = [&](TokenType type) {
+            const std::string_view text = contents.substr(position, 1);
+            advance();
+            return Token{type, text, startRow, startCol};
+        };
 
         if (c == '+') {
-            advance();
-            return Token{TokenType::Plus, "+", startRow, startCol};
+            return symbol(TokenType::Plus);
         }
         if (c == '|') {
-            advance();
-            return Token{TokenType::Pipe, "|", startRow, startCol};
+            return symbol(TokenType::Pipe);
         }
         if (c == '=') {
-            advance();
-            return Token{TokenType::Equals, "=", startRow, startCol};
+            return symbol(TokenType::Equals);
         }
         if (c == ':') {
-            advance();
-            nextTokenIsCommand = true;
-            return Token{TokenType::Colon, ":", startRow, startCol};
+            nextTokenIsCommand = parenDepth == 0;
+            return symbol(TokenType::Colon);
         }
         if (c == '^') {
-            advance();
-            return Token{TokenType::Caret, "^", startRow, startCol};
+            return symbol(TokenType::Caret);
         }
         if (c == '~') {
-            advance();
-            return Token{TokenType::Tilde, "~", startRow, startCol};
+            return symbol(TokenType::Tilde);
         }
         if (c == '&') {
-            advance();
-            return Token{TokenType::Ampersand, "&", startRow, startCol};
+            return symbol(TokenType::Ampersand);
         }
         if (c == '{') {
-            advance();
-            return Token{TokenType::OpenBrace, "{", startRow, startCol};
+            return symbol(TokenType::OpenBrace);
         }
         if (c == '}') {
-            advance();
-            return Token{TokenType::CloseBrace, "}", startRow, startCol};
+            return symbol(TokenType::CloseBrace);
         }
         if (c == ',') {
-            advance();
-            return Token{TokenType::Comma, ",", startRow, startCol};
+            return symbol(TokenType::Comma);
         }
         if (c == ';') {
-            advance();
-            return Token{TokenType::Semicolon, ";", startRow, startCol};
+            return symbol(TokenType::Semicolon);
         }
         if (c == '0' && peekChar(1) == 'x') {
-            std::string hex = readHex();
-            return Token{TokenType::KeyHex, hex, startRow, startCol};
+            return Token{TokenType::KeyHex, readHex(), startRow, startCol};
         }
         if (c == '[') {
-            advance();
-            return Token{TokenType::OpenBracket, "[", startRow, startCol};
+            return symbol(TokenType::OpenBracket);
         }
         if (c == ']') {
-            advance();
-            return Token{TokenType::CloseBracket, "]", startRow, startCol};
+            return symbol(TokenType::CloseBracket);
         }
         if (c == '(') {
-            advance();
-            return Token{TokenType::OpenParen, "(", startRow, startCol};
+            parenDepth++;
+            return symbol(TokenType::OpenParen);
         }
         if (c == ')') {
-            advance();
-            return Token{TokenType::CloseParen, ")", startRow, startCol};
+            if (parenDepth > 0) parenDepth--;
+            return symbol(TokenType::CloseParen);
         }
         if (c == '"') {
-            std::string value = readQuotedString();
-            return Token{TokenType::String, value, startRow, startCol};
+            return readQuotedString();
         }
 
-        const std::string text = readIdentifier();
+        const std::string_view text = readIdentifier();
         if (text.empty()) {
-            const std::string invalid(1, c);
-            advance();
-            return Token{TokenType::Invalid, invalid, startRow, startCol};
+            return symbol(TokenType::Invalid);
         }
 
         if (parseLiteralKey(text).has_value()) {
             return Token{TokenType::Literal, text, startRow, startCol};
         }
-        if (text == "define_modifier") {
-            return Token{TokenType::DefineModifier, text, startRow, startCol};
-        }
-        if (text == "max_chord_interval" || text == "hold_modifier_threshold" || text == "simultaneous_threshold" || text == "blacklist" || text == "sequence_command" || text == "corner_size" || text == "tap_timeout") {
-            return Token{TokenType::ConfigProperty, text, startRow, startCol};
+        if (auto keyword = lookupKeyword(text)) {
+            return Token{*keyword, text, startRow, startCol};
         }
         if (std::ranges::all_of(text, [](unsigned char ch) { return std::isdigit(ch) != 0; })) {
             return Token{TokenType::Integer, text, startRow, startCol};
@@ -135,30 +159,29 @@ Token Tokenizer::getNextToken() {
     }
 }
 
-std::string Tokenizer::readHex() {
-    std::string result;
+std::string_view Tokenizer::readHex() {
     advance();
     advance();
-    while (hasRemainingInput()) {
-        char c = peekChar();
-        if (!std::isxdigit(static_cast<unsigned char>(c))) {
-            break;
-        }
-        result.push_back(c);
+    const size_t start = position;
+    while (hasRemainingInput() && std::isxdigit(static_cast<unsigned char>(peekChar()))) {
         advance();
     }
-    return result;
+    return contents.substr(start, position - start);
 }
 
-std::string Tokenizer::readQuotedString() {
-    std::string result;
+Token Tokenizer::readQuotedString() {
+    Token token{TokenType::String, {}, row, col};
     advance();
+    const size_t start = position;
+    size_t end = position;
     while (hasRemainingInput()) {
         char c = peekChar();
-        if (c == '\\' && hasRemainingInput(1) && peekChar(1) == '"') {
-            result.push_back('"');
+        // an escape is taken as a pair, so \\ before the closing quote doesn't escape it
+        if (c == '\\' && hasRemainingInput(1) && peekChar(1) != '\n') {
+            token.escaped = true;
             advance();
             advance();
+            end = position;
             continue;
         }
         if (c == '"') {
@@ -168,45 +191,37 @@ std::string Tokenizer::readQuotedString() {
         if (c == '\n') {
             break;
         }
-        result.push_back(c);
         advance();
+        end = position;
     }
-    return result;
+    token.text = contents.substr(start, end - start);
+    return token;
 }
 
 Token Tokenizer::readCommandToken() {
     int startRow = row;
     int startCol = col;
-    std::string line;
-    while (position < contents.size()) {
-        char c = peekChar();
-        if (c == '\n') {
-            break;
-        }
-        line.push_back(c);
-        advance();
-    }
+    const size_t start = position;
+    const size_t newline = contents.find('\n', position);
+    const size_t end = newline == std::string_view::npos ? contents.size() : newline;
+    col += static_cast<int>(end - position);
+    position = end;
     if (peekChar() == '\n') {
         advanceNewline();
     }
-    return Token{TokenType::Command, line, startRow, startCol};
+    return Token{TokenType::Command, contents.substr(start, end - start), startRow, startCol};
 }
 
 bool Tokenizer::isIdentifierChar(char c) {
     return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
 }
 
-std::string Tokenizer::readIdentifier() {
-    std::string result;
-    while (hasRemainingInput()) {
-        char c = peekChar();
-        if (!isIdentifierChar(c)) {
-            break;
-        }
-        result.push_back(c);
+std::string_view Tokenizer::readIdentifier() {
+    const size_t start = position;
+    while (hasRemainingInput() && isIdentifierChar(peekChar())) {
         advance();
     }
-    return result;
+    return contents.substr(start, position - start);
 }
 
 void Tokenizer::skipWhitespaceAndComments() {
@@ -254,6 +269,8 @@ void Tokenizer::advanceNewline() {
     position++;
     row++;
     col = 0;
+    // an unclosed '(' never carries over to the next statement
+    parenDepth = 0;
 }
 
 char Tokenizer::peekChar(int offset) {
@@ -1,33 +1,47 @@
 #pragma once
 
-#include <deque>
-#include <string>
+#include <array>
+#include <optional>
+#include <string_view>
 
 #include "token.hpp"
 
+// DefineModifier, DefineRegion or ConfigProperty for a reserved identifier
+std::optional<TokenType> lookupKeyword(std::string_view text);
+
 class Tokenizer {
    private:
     std::string_view contents;
     size_t position{};
     int row{};
     int col{};
-    std::deque<Token> bufferedTokens;
+    // the parser looks at most one token ahead; a fixed ring keeps lookahead allocation-free
+    static constexpr size_t kMaxLookahead = 4;
+    std::array<Token, kMaxLookahead> bufferedTokens{};
+    size_t bufferedHead{};
+    size_t bufferedCount{};
     bool nextTokenIsCommand{};
+    // ':' only starts a command outside parentheses, so trackpad_tap(region:name) stays a chord
+    int parenDepth{};
+    // one past the text of the last token handed out by next()
+    const char* consumedEnd{};
 
    public:
     explicit Tokenizer(std::string_view contents) : contents(contents) {}
 
     [[nodiscard]] const Token& peek(size_t offset = 0);
     Token next();
+    // end of the source consumed so far, not counting lookahead; spans a statement with peek()
+    [[nodiscard]] const char* endOfConsumed() const { return consumedEnd; }
 
    private:
     [[nodiscard]] bool hasRemainingInput(int offset = 0);
     Token getNextToken();
-    [[nodiscard]] std::string readHex();
-    [[nodiscard]] std::string readQuotedString();
+    [[nodiscard]] std::string_view readHex();
+    [[nodiscard]] Token readQuotedString();
     [[nodiscard]] Token readCommandToken();
-    [[nodiscard]] bool isIdentifierChar(char c);
-    [[nodiscard]] std::string readIdentifier();
+    [[nodiscard]] static bool isIdentifierChar(char c);
+    [[nodiscard]] std::string_view readIdentifier();
     void skipWhitespaceAndComments();
     void skipWhitespace();
     void eatComment();
@@ -0,0 +1,236 @@
+#include "config_watcher.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <string_view>
+#include <system_error>
+
+#if defined(__APPLE__)
+#include <sys/event.h>
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include "../common/log.hpp"
+
+ConfigWatcher::ConfigWatcher(std::filesystem::path file, std::chrono::milliseconds debounce, Callback onChange)
+    : file_(std::move(file)), debounce_(debounce), onChange_(std::move(onChange)) {}
+
+ConfigWatcher::~ConfigWatcher() {
+    stop();
+}
+
+bool ConfigWatcher::start() {
+    // a symlinked config (e.g. into a dotfiles repo) is edited at its target
+    std::error_code ec;
+    auto resolved = std::filesystem::weakly_canonical(file_, ec);
+    if (!ec) file_ = std::move(resolved);
+
+    if (pipe(wakePipe_.data()) == -1) {
+        warn("failed to create config watcher pipe: {}", std::generic_category().message(errno));
+        return false;
+    }
+    if (!openWatches()) {
+        warn("failed to watch {}: {}", file_.parent_path().string(), std::generic_category().message(errno));
+        stop();
+        return false;
+    }
+    thread_ = std::thread(&ConfigWatcher::run, this);
+    debug("watching {} for changes, {} ms debounce", file_.string(), debounce_.count());
+    return true;
+}
+
+void ConfigWatcher::stop() {
+    if (thread_.joinable()) {
+        const char byte = '\n';
+        const ssize_t result = write(wakePipe_[1], &byte, sizeof(byte));
+        (void)result;
+        thread_.join();
+    }
+    closeWatches();
+    for (int& fd : wakePipe_) {
+        if (fd != -1) {
+            close(fd);
+            fd = -1;
+        }
+    }
+}
+
+std::optional<ConfigWatcher::Identity> ConfigWatcher::statFile() const {
+    struct stat st{};
+    if (::stat(file_.c_str(), &st) == -1) return std::nullopt;
+#if defined(__APPLE__)
+    const auto& mtime = st.st_mtimespec;
+#else
+    const auto& mtime = st.st_mtim;
+#endif
+    return Identity{
+        .device = static_cast<uint64_t>(st.st_dev),
+        .inode = static_cast<uint64_t>(st.st_ino),
+        .size = static_cast<int64_t>(st.st_size),
+        .mtimeNs = static_cast<int64_t>(mtime.tv_sec) * 1'000'000'000 + mtime.tv_nsec,
+    };
+}
+
+bool ConfigWatcher::openWatches() {
+    const auto dir = file_.parent_path();
+#if defined(__APPLE__)
+    queueFd_ = kqueue();
+    if (queueFd_ == -1) return false;
+    dirFd_ = open(dir.c_str(), O_EVTONLY);  // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (dirFd_ == -1) return false;
+    // directory writes are entries being created, renamed or removed
+    std::array<struct kevent, 2> changes{};
+    EV_SET(&changes[0], dirFd_, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE, 0, nullptr);
+    EV_SET(&changes[1], wakePipe_[0], EVFILT_READ, EV_ADD, 0, 0, nullptr);
+    if (kevent(queueFd_, changes.data(), static_cast<int>(changes.size()), nullptr, 0, nullptr) == -1) return false;
+#elif defined(__linux__)
+    queueFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (queueFd_ == -1) return false;
+    if (inotify_add_watch(queueFd_, dir.c_str(), IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) == -1) {
+        return false;
+    }
+#else
+    return false;
+#endif
+    identity_ = statFile();
+    watchFile();
+    return true;
+}
+
+void ConfigWatcher::watchFile() {
+#if defined(__APPLE__)
+    // closing the old descriptor also removes its kevent
+    if (fileFd_ != -1) close(fileFd_);
+    fileFd_ = open(file_.c_str(), O_EVTONLY);  // NOLINT(cppcoreguidelines-pro-type-vararg)
+    // a missing file is picked up again from the directory watch once it is recreated
+    if (fileFd_ == -1) return;
+    struct kevent change{};
+    EV_SET(&change, fileFd_, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE | NOTE_EXTEND | NOTE_DELETE | NOTE_RENAME, 0, nullptr);
+    if (kevent(queueFd_, &change, 1, nullptr, 0, nullptr) == -1) {
+        close(fileFd_);
+        fileFd_ = -1;
+    }
+#endif
+}
+
+void ConfigWatcher::closeWatches() {
+    for (int* fd : {&fileFd_, &dirFd_, &queueFd_}) {
+        if (*fd != -1) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+bool ConfigWatcher::replaced() {
+    auto now = statFile();
+    if (now == identity_) return false;
+    const bool newFile = !now || !identity_ || now->inode != identity_->inode || now->device != identity_->device;
+    identity_ = now;
+    if (newFile) watchFile();
+    return true;
+}
+
+std::optional<ConfigWatcher::Wake> ConfigWatcher::waitOnce(std::optional<std::chrono::milliseconds> timeout) {
+#if defined(__APPLE__)
+    timespec ts{};
+    if (timeout) {
+        ts.tv_sec = static_cast<time_t>(timeout->count() / 1000);
+        ts.tv_nsec = static_cast<long>(timeout->count() % 1000) * 1'000'000;
+    }
+    std::array<struct kevent, 8> events{};
+    const int n = kevent(queueFd_, nullptr, 0, events.data(), static_cast<int>(events.size()), timeout ? &ts : nullptr);
+    if (n == -1) {
+        if (errno == EINTR) return std::nullopt;
+        warn("config watcher stopped: {}", std::generic_category().message(errno));
+        return Wake::Stop;
+    }
+    if (n == 0) return Wake::Timeout;
+
+    bool written = false;
+    bool entries = false;
+    for (int i = 0; i < n; i++) {
+        const auto& event = events.at(static_cast<size_t>(i));
+        const auto ident = static_cast<int>(event.ident);
+        if (ident == wakePipe_[0]) return Wake::Stop;
+        if (ident == fileFd_) {
+            written = true;
+            // renamed away or deleted: the config path now names some other file, or none
+            if ((event.fflags & (NOTE_DELETE | NOTE_RENAME)) != 0) entries = true;
+        } else if (ident == dirFd_) {
+            entries = true;
+        }
+    }
+    // replaced() also re-targets the file watch, so it runs even when a write already counted
+    const bool replacedFile = entries && replaced();
+    if (written) identity_ = statFile();
+    return written || replacedFile ? std::optional{Wake::Change} : std::nullopt;
+#elif defined(__linux__)
+    std::array<pollfd, 2> fds{{
+        {.fd = queueFd_, .events = POLLIN, .revents = 0},
+        {.fd = wakePipe_[0], .events = POLLIN, .revents = 0},
+    }};
+    const int n = poll(fds.data(), fds.size(), timeout ? static_cast<int>(timeout->count()) : -1);
+    if (n == -1) {
+        if (errno == EINTR) return std::nullopt;
+        warn("config watcher stopped: {}", std::generic_category().message(errno));
+        return Wake::Stop;
+    }
+    if (n == 0) return Wake::Timeout;
+    if (fds[1].revents != 0) return Wake::Stop;
+
+    const std::string name = file_.filename().string();
+    bool written = false;
+    bool entries = false;
+    alignas(inotify_event) std::array<char, 4096> buffer{};
+    ssize_t length = 0;
+    while ((length = read(queueFd_, buffer.data(), buffer.size())) > 0) {
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            if (event->len == 0 || std::string_view{event->name} != name) continue;
+            if ((event->mask & IN_CLOSE_WRITE) != 0) {
+                written = true;
+            } else {
+                entries = true;
+            }
+        }
+    }
+    const bool replacedFile = entries && replaced();
+    if (written) identity_ = statFile();
+    return written || replacedFile ? std::optional{Wake::Change} : std::nullopt;
+#else
+    (void)timeout;
+    return Wake::Stop;
+#endif
+}
+
+ConfigWatcher::Wake ConfigWatcher::wait(std::optional<std::chrono::milliseconds> timeout) {
+    using clock = std::chrono::steady_clock;
+    const auto deadline = timeout.transform([](auto t) { return clock::now() + t; });
+    while (true) {
+        std::optional<std::chrono::milliseconds> remaining;
+        if (deadline) {
+            remaining = std::max(std::chrono::ceil<std::chrono::milliseconds>(*deadline - clock::now()), std::chrono::milliseconds{0});
+        }
+        if (auto wake = waitOnce(remaining)) return *wake;
+    }
+}
+
+void ConfigWatcher::run() {
+    while (true) {
+        auto wake = wait(std::nullopt);
+        // trailing debounce: the burst ends with a quiet window
+        while (wake == Wake::Change) {
+            wake = wait(debounce_);
+        }
+        if (wake == Wake::Stop) return;
+        onChange_();
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <thread>
+
+// watches the config file for changes and calls back once per burst of them, on its own thread.
+//
+// the file's directory is watched as well as the file itself, so an editor that saves by writing
+// a temporary and renaming it over the config is seen, and the watch follows the new file.
+// kqueue on macOS, inotify on Linux; the thread blocks in the kernel while nothing changes
+class ConfigWatcher {
+   public:
+    using Callback = std::function<void()>;
+
+    static constexpr auto kDefaultDebounce = std::chrono::milliseconds(100);
+
+    // a change starts the debounce window and each further change restarts it; the callback
+    // runs when it passes quietly
+    ConfigWatcher(std::filesystem::path file, std::chrono::milliseconds debounce, Callback onChange);
+    ~ConfigWatcher();
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+    ConfigWatcher(ConfigWatcher&&) = delete;
+    ConfigWatcher& operator=(ConfigWatcher&&) = delete;
+
+    // false if the watches can't be set up, e.g. the directory doesn't exist
+    bool start();
+    // joins the thread; a pending callback is dropped
+    void stop();
+
+   private:
+    enum class Wake : uint8_t {
+        Change,
+        Timeout,
+        Stop,
+    };
+
+    // enough of a stat to tell a replaced file from an untouched one
+    struct Identity {
+        uint64_t device{};
+        uint64_t inode{};
+        int64_t size{};
+        int64_t mtimeNs{};
+
+        bool operator==(const Identity&) const = default;
+    };
+
+    std::filesystem::path file_;
+    std::chrono::milliseconds debounce_;
+    Callback onChange_;
+
+    std::thread thread_;
+    // written to by stop() to wake the thread
+    std::array<int, 2> wakePipe_ = {-1, -1};
+    // the kqueue or inotify descriptor
+    int queueFd_{-1};
+    // kqueue needs open descriptors for the directory and the file; inotify names the file in its events
+    int dirFd_{-1};
+    int fileFd_{-1};
+    std::optional<Identity> identity_;
+
+    [[nodiscard]] std::optional<Identity> statFile() const;
+    bool openWatches();
+    void watchFile();
+    void closeWatches();
+    // blocks until a change to the file, stop(), or the timeout
+    Wake wait(std::optional<std::chrono::milliseconds> timeout);
+    // one kevent or poll call; nullopt when it only saw events for other files
+    std::optional<Wake> waitOnce(std::optional<std::chrono::milliseconds> timeout);
+    // a directory entry changed: whether the config is now a different (or no) file
+    bool replaced();
+    void run();
+};
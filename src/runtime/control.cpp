@@ -0,0 +1,159 @@
+#include "control.hpp"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <format>
+
+#include "../common/config_path.hpp"
+
+namespace {
+
+constexpr std::array kCommands{
+    control::Command::Reload,
+    control::Command::Status,
+    control::Command::Stats,
+    control::Command::Trigger,
+    control::Command::Mode,
+    control::Command::Key,
+    control::Command::Metrics,
+};
+
+bool takesArgument(control::Command command) {
+    return command == control::Command::Trigger || command == control::Command::Mode || command == control::Command::Key;
+}
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+// a reload of a large config is the slowest command
+constexpr timeval kReplyTimeout{.tv_sec = 10, .tv_usec = 0};
+
+}  // namespace
+
+std::string_view control::commandName(Command command) {
+    switch (command) {
+        case Command::Reload: return "reload";
+        case Command::Status: return "status";
+        case Command::Stats: return "stats";
+        case Command::Trigger: return "trigger";
+        case Command::Mode: return "mode";
+        case Command::Key: return "key";
+        case Command::Metrics: return "metrics";
+    }
+    return "?";
+}
+
+std::vector<std::string_view> control::splitKeySpecs(std::string_view specs) {
+    std::vector<std::string_view> out;
+    while (!specs.empty()) {
+        const auto end = specs.find(';');
+        auto spec = specs.substr(0, end);
+        specs.remove_prefix(end == std::string_view::npos ? specs.size() : end + 1);
+        while (!spec.empty() && spec.front() == ' ') spec.remove_prefix(1);
+        while (!spec.empty() && spec.back() == ' ') spec.remove_suffix(1);
+        if (!spec.empty()) out.push_back(spec);
+    }
+    return out;
+}
+
+std::optional<control::Request> control::parseRequest(std::string_view line) {
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.remove_suffix(1);
+    const auto space = line.find(' ');
+    const auto name = line.substr(0, space);
+    const auto argument = space == std::string_view::npos ? std::string_view{} : line.substr(space + 1);
+    for (const auto command : kCommands) {
+        if (commandName(command) != name) continue;
+        if (takesArgument(command) == argument.empty()) return std::nullopt;
+        return Request{.command = command, .argument = std::string{argument}};
+    }
+    return std::nullopt;
+}
+
+std::string control::formatRequest(const Request& request) {
+    if (request.argument.empty()) return std::format("{}\n", commandName(request.command));
+    return std::format("{} {}\n", commandName(request.command), request.argument);
+}
+
+std::string control::formatResponse(const Response& response) {
+    std::string out = response.ok ? "ok\n" : "error\n";
+    for (const auto& line : response.lines) {
+        out += line;
+        out += '\n';
+    }
+    return out;
+}
+
+std::optional<control::Response> control::parseResponse(std::string_view text) {
+    Response response;
+    const auto status = text.substr(0, text.find('\n'));
+    if (status == "ok") {
+        response.ok = true;
+    } else if (status == "error") {
+        response.ok = false;
+    } else {
+        return std::nullopt;
+    }
+    text.remove_prefix(std::min(text.size(), status.size() + 1));
+    while (!text.empty()) {
+        const auto end = text.find('\n');
+        response.lines.emplace_back(text.substr(0, end));
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+    }
+    return response;
+}
+
+std::optional<std::filesystem::path> control::socketPath() {
+    auto dir = getPrivateDir("smhkd");
+    if (!dir) return std::nullopt;
+    return *dir / SOCKET_FILE;
+}
+
+std::optional<control::Response> control::send(const std::filesystem::path& socket, const Request& request) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const auto& path = socket.native();
+    if (path.size() >= sizeof(address.sun_path)) return std::nullopt;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return std::nullopt;
+#ifdef SO_NOSIGPIPE
+    const int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &kReplyTimeout, sizeof(kReplyTimeout));
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1) {  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        close(fd);
+        return std::nullopt;
+    }
+
+    const auto line = formatRequest(request);
+    for (size_t sent = 0; sent < line.size();) {
+        const ssize_t n = ::send(fd, line.data() + sent, line.size() - sent, kSendFlags);
+        if (n <= 0) {
+            close(fd);
+            return std::nullopt;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    shutdown(fd, SHUT_WR);
+
+    std::string reply;
+    std::array<char, 4096> buffer{};
+    ssize_t n = 0;
+    while ((n = read(fd, buffer.data(), buffer.size())) > 0) {
+        reply.append(buffer.data(), static_cast<size_t>(n));
+    }
+    close(fd);
+    if (n < 0) return std::nullopt;
+    return parseResponse(reply);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// the control socket's line protocol. a client connects, writes one request line,
+// "<command>[ <argument>]\n", and reads the response until the daemon closes the
+// connection: "ok\n" or "error\n", then any number of detail lines
+namespace control {
+
+enum class Command : uint8_t {
+    // reload the config; details are its errors
+    Reload,
+    Status,
+    // the runtime counters, one "name value" per line
+    Stats,
+    // run the binding for a key spec as if it were pressed and released
+    Trigger,
+    // "default", or "passthrough" to let every key through until switched back
+    Mode,
+    // post key presses for one or more key specs, as smhkd -k does
+    Key,
+    // the counters and latency histograms in the Prometheus text format, one line per line
+    Metrics,
+};
+
+struct Request {
+    Command command;
+    std::string argument;
+};
+
+struct Response {
+    bool ok{true};
+    std::vector<std::string> lines;
+};
+
+[[nodiscard]] std::string_view commandName(Command command);
+
+// a batch of key specs is separated by ';', as the chords of a sequence are; empty specs are dropped
+[[nodiscard]] std::vector<std::string_view> splitKeySpecs(std::string_view specs);
+
+// nullopt for an unknown command, or one missing its argument
+[[nodiscard]] std::optional<Request> parseRequest(std::string_view line);
+[[nodiscard]] std::string formatRequest(const Request& request);
+
+[[nodiscard]] std::string formatResponse(const Response& response);
+[[nodiscard]] std::optional<Response> parseResponse(std::string_view text);
+
+// in the user's private directory (see getPrivateDir), so neither another user nor a changed
+// $USER can point the daemon or a client at someone else's socket
+inline constexpr std::string_view SOCKET_FILE = "control.socket";
+[[nodiscard]] std::optional<std::filesystem::path> socketPath();
+
+// nullopt when no daemon is listening on the socket, or it hung up without answering
+[[nodiscard]] std::optional<Response> send(const std::filesystem::path& socket, const Request& request);
+
+}  // namespace control
@@ -0,0 +1,267 @@
+#include "control_server.hpp"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <system_error>
+#include <vector>
+
+#include "../common/log.hpp"
+
+namespace {
+
+// a request is one short line; anything longer is not a client of ours
+constexpr size_t kMaxRequest = 4096;
+// how long a client has to send its request, and then to read the reply
+constexpr auto kIdleTimeout = std::chrono::seconds(2);
+// connections open at once; a new one past this closes the one nearest its deadline
+constexpr size_t kMaxConnections = 16;
+// a fire date, and a repeat interval, the idle timer never reaches unless armed
+constexpr CFTimeInterval kNever = 1e10;
+
+bool setNonBlocking(int fd) {
+    const int flags = fcntl(fd, F_GETFL);  // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (flags == -1) return false;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;  // NOLINT(cppcoreguidelines-pro-type-vararg)
+}
+
+}  // namespace
+
+ControlServer::ControlServer(std::filesystem::path socket, Handler handler)
+    : socket_(std::move(socket)), handler_(std::move(handler)) {}
+
+ControlServer::~ControlServer() {
+    while (!connections_.empty()) {
+        closeConnection(connections_.begin()->first);
+    }
+    if (idleTimer_) {
+        CFRunLoopTimerInvalidate(idleTimer_);
+        CFRelease(idleTimer_);
+    }
+    if (listenSource_) {
+        CFFileDescriptorInvalidate(listenSource_);
+        CFRelease(listenSource_);
+    }
+    if (listenFd_ != -1) {
+        close(listenFd_);
+        unlink(socket_.c_str());
+    }
+}
+
+bool ControlServer::start(CFRunLoopRef runLoop) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const auto& path = socket_.native();
+    if (path.size() >= sizeof(address.sun_path)) {
+        warn("control socket path too long: {}", path);
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // a socket a daemon still answers on is its control channel, not a stale one to replace
+    if (control::send(socket_, {.command = control::Command::Status})) {
+        warn("another smhkd is answering on {}, not taking over its control socket", path);
+        return false;
+    }
+
+    listenFd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd_ == -1 || !setNonBlocking(listenFd_)) {
+        warn("failed to create control socket: {}", std::generic_category().message(errno));
+        return false;
+    }
+    unlink(path.c_str());
+    // only this user may control the daemon
+    const mode_t oldMask = umask(0077);
+    const int bound = bind(listenFd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    umask(oldMask);
+    if (bound == -1 || listen(listenFd_, 16) == -1) {
+        warn("failed to listen on {}: {}", path, std::generic_category().message(errno));
+        close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+
+    CFFileDescriptorContext context{};
+    context.info = this;
+    listenSource_ = CFFileDescriptorCreate(kCFAllocatorDefault, listenFd_, false, acceptCallback, &context);
+    if (!listenSource_) {
+        warn("failed to create control socket file descriptor");
+        return false;
+    }
+    CFFileDescriptorEnableCallBacks(listenSource_, kCFFileDescriptorReadCallBack);
+    CFRunLoopSourceRef source = CFFileDescriptorCreateRunLoopSource(kCFAllocatorDefault, listenSource_, 0);
+    if (!source) {
+        warn("failed to create control socket run loop source");
+        return false;
+    }
+    runLoop_ = runLoop;
+    CFRunLoopAddSource(runLoop_, source, kCFRunLoopCommonModes);
+    CFRelease(source);
+
+    CFRunLoopTimerContext timerContext{};
+    timerContext.info = this;
+    idleTimer_ = CFRunLoopTimerCreate(kCFAllocatorDefault, kNever, kNever, 0, 0, idleCallback, &timerContext);
+    if (idleTimer_) CFRunLoopAddTimer(runLoop_, idleTimer_, kCFRunLoopCommonModes);
+    debug("control socket listening on {}", path);
+    return true;
+}
+
+void ControlServer::acceptCallback(CFFileDescriptorRef fd, CFOptionFlags /*callbackTypes*/, void* info) {
+    auto* server = static_cast<ControlServer*>(info);
+    server->acceptPending();
+    CFFileDescriptorEnableCallBacks(fd, kCFFileDescriptorReadCallBack);
+}
+
+void ControlServer::acceptPending() {
+    while (true) {
+        const int fd = accept(listenFd_, nullptr, nullptr);
+        if (fd == -1) break;
+#ifdef SO_NOSIGPIPE
+        const int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        if (!setNonBlocking(fd)) {
+            close(fd);
+            continue;
+        }
+        auto connection = std::make_unique<Connection>(Connection{.server = this, .fd = fd, .deadline = clock::now() + kIdleTimeout});
+        // the request is usually already buffered and the reply fits the socket buffer, so most
+        // connections finish right here
+        if (!service(*connection) || !watch(*connection)) {
+            if (connection->source) CFRelease(connection->source);
+            close(fd);
+            continue;
+        }
+        if (connections_.size() >= kMaxConnections) {
+            const auto nearest = std::ranges::min_element(connections_, {}, [](const auto& entry) { return entry.second->deadline; });
+            debug("too many control connections, closing fd {}", nearest->first);
+            closeConnection(nearest->first);
+        }
+        connections_.emplace(fd, std::move(connection));
+    }
+    armIdleTimer();
+}
+
+void ControlServer::connectionCallback(CFFileDescriptorRef fd, CFOptionFlags /*callbackTypes*/, void* info) {
+    auto* connection = static_cast<Connection*>(info);
+    auto* server = connection->server;
+    if (server->service(*connection)) {
+        CFFileDescriptorEnableCallBacks(fd, connection->reply.empty() ? kCFFileDescriptorReadCallBack : kCFFileDescriptorWriteCallBack);
+    } else {
+        server->closeConnection(connection->fd);
+    }
+    server->armIdleTimer();
+}
+
+void ControlServer::idleCallback(CFRunLoopTimerRef /*timer*/, void* info) {
+    static_cast<ControlServer*>(info)->closeIdle();
+}
+
+bool ControlServer::service(Connection& connection) {
+    if (connection.reply.empty()) {
+        if (readRequest(connection)) return true;
+        connection.reply = respond(connection.request);
+        // the handler may have taken a while, so the client gets the full time to read
+        connection.deadline = clock::now() + kIdleTimeout;
+    }
+    return writeReply(connection);
+}
+
+bool ControlServer::readRequest(Connection& connection) {
+    std::array<char, 512> buffer{};
+    while (true) {
+        const ssize_t n = read(connection.fd, buffer.data(), buffer.size());
+        if (n > 0) {
+            connection.request.append(buffer.data(), static_cast<size_t>(n));
+            if (connection.request.find('\n') != std::string::npos || connection.request.size() > kMaxRequest) return false;
+            continue;
+        }
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n == -1 && errno == EINTR) continue;
+        // eof: a request without its newline is still answered
+        return false;
+    }
+}
+
+std::string ControlServer::respond(std::string_view request) {
+    const auto line = request.substr(0, request.find('\n'));
+    control::Response response;
+    if (auto parsed = control::parseRequest(line)) {
+        response = handler_(*parsed);
+    } else {
+        response = {.ok = false, .lines = {std::format("invalid request '{}'", line.substr(0, 64))}};
+    }
+    return control::formatResponse(response);
+}
+
+bool ControlServer::writeReply(Connection& connection) {
+    while (connection.sent < connection.reply.size()) {
+        const ssize_t n = write(connection.fd, connection.reply.data() + connection.sent, connection.reply.size() - connection.sent);
+        if (n > 0) {
+            connection.sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n == -1 && errno == EINTR) continue;
+        // the client went away; there's no one left to answer
+        return false;
+    }
+    return false;
+}
+
+bool ControlServer::watch(Connection& connection) {
+    CFFileDescriptorContext context{};
+    context.info = &connection;
+    connection.source = CFFileDescriptorCreate(kCFAllocatorDefault, connection.fd, false, connectionCallback, &context);
+    CFRunLoopSourceRef source = connection.source
+                                  ? CFFileDescriptorCreateRunLoopSource(kCFAllocatorDefault, connection.source, 0)
+                                  : nullptr;
+    if (!source) return false;
+    CFFileDescriptorEnableCallBacks(connection.source, connection.reply.empty() ? kCFFileDescriptorReadCallBack : kCFFileDescriptorWriteCallBack);
+    CFRunLoopAddSource(runLoop_, source, kCFRunLoopCommonModes);
+    CFRelease(source);
+    return true;
+}
+
+void ControlServer::closeConnection(int fd) {
+    const auto it = connections_.find(fd);
+    if (it == connections_.end()) return;
+    if (it->second->source) {
+        CFFileDescriptorInvalidate(it->second->source);
+        CFRelease(it->second->source);
+    }
+    close(fd);
+    connections_.erase(it);
+}
+
+void ControlServer::closeIdle() {
+    const auto now = clock::now();
+    std::vector<int> idle;
+    for (const auto& [fd, connection] : connections_) {
+        if (connection->deadline <= now) idle.push_back(fd);
+    }
+    for (const int fd : idle) {
+        debug("control connection on fd {} idle too long, closing", fd);
+        closeConnection(fd);
+    }
+    armIdleTimer();
+}
+
+void ControlServer::armIdleTimer() {
+    if (!idleTimer_) return;
+    if (connections_.empty()) {
+        CFRunLoopTimerSetNextFireDate(idleTimer_, kNever);
+        return;
+    }
+    const auto nearest = std::ranges::min_element(connections_, {}, [](const auto& entry) { return entry.second->deadline; });
+    const std::chrono::duration<double> wait = nearest->second->deadline - clock::now();
+    CFRunLoopTimerSetNextFireDate(idleTimer_, CFAbsoluteTimeGetCurrent() + std::max(wait.count(), 0.0));
+}
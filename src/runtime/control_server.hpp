@@ -0,0 +1,74 @@
+#pragma once
+
+#include <CoreFoundation/CoreFoundation.h>
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "control.hpp"
+
+// serves the control socket from the run loop, so a handler runs between events on the same
+// thread as the event tap and can use KeyHandler without locking. connections are read and
+// written without blocking: a client that connects and sends nothing, or never reads its
+// reply, never stalls the run loop, and is dropped once it has been idle past a deadline
+class ControlServer {
+   public:
+    using Handler = std::function<control::Response(const control::Request&)>;
+
+    ControlServer(std::filesystem::path socket, Handler handler);
+    ~ControlServer();
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+    ControlServer(ControlServer&&) = delete;
+    ControlServer& operator=(ControlServer&&) = delete;
+
+    // binds the socket, replacing a stale one; false without touching it when a daemon still answers there
+    bool start(CFRunLoopRef runLoop);
+
+   private:
+    using clock = std::chrono::steady_clock;
+
+    struct Connection {
+        ControlServer* server{};
+        int fd{-1};
+        CFFileDescriptorRef source{};
+        std::string request;
+        // empty until the request is complete, then the response being written
+        std::string reply;
+        size_t sent{};
+        // closed if still open by then
+        clock::time_point deadline;
+    };
+
+    std::filesystem::path socket_;
+    Handler handler_;
+    int listenFd_{-1};
+    CFFileDescriptorRef listenSource_{};
+    CFRunLoopRef runLoop_{};
+    // fires at the earliest connection deadline, or never while there are none
+    CFRunLoopTimerRef idleTimer_{};
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+
+    static void acceptCallback(CFFileDescriptorRef fd, CFOptionFlags callbackTypes, void* info);
+    static void connectionCallback(CFFileDescriptorRef fd, CFOptionFlags callbackTypes, void* info);
+    static void idleCallback(CFRunLoopTimerRef timer, void* info);
+    void acceptPending();
+    // reads what it can, answers a complete request and writes what it can of the reply;
+    // true while the connection still waits on the client, false once it is done with
+    bool service(Connection& connection);
+    // true while the request is incomplete and the client may send more
+    bool readRequest(Connection& connection);
+    [[nodiscard]] std::string respond(std::string_view request);
+    // true while part of the reply is left for when the client reads
+    bool writeReply(Connection& connection);
+    // a run loop source for the connection, waiting on whichever of read or write it needs next
+    bool watch(Connection& connection);
+    void closeConnection(int fd);
+    void closeIdle();
+    void armIdleTimer();
+};
@@ -0,0 +1,157 @@
+#include "flight_recorder.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+// a fixed-size line built with no allocation, flushed with write(2)
+class LineWriter {
+   public:
+    explicit LineWriter(int fd) : fd_(fd) {}
+
+    LineWriter& str(std::string_view s) {
+        for (const char c : s) put(c);
+        return *this;
+    }
+
+    LineWriter& dec(int64_t value) {
+        if (value < 0) {
+            put('-');
+            // negate as unsigned so INT64_MIN doesn't overflow
+            return udec(0 - static_cast<uint64_t>(value));
+        }
+        return udec(static_cast<uint64_t>(value));
+    }
+
+    LineWriter& udec(uint64_t value) {
+        std::array<char, 20> digits{};
+        size_t n = 0;
+        do {
+            digits.at(n++) = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (n > 0) put(digits.at(--n));
+        return *this;
+    }
+
+    LineWriter& hex(uint64_t value) {
+        str("0x");
+        bool started = false;
+        for (int shift = 60; shift >= 0; shift -= 4) {
+            const auto nibble = static_cast<unsigned>((value >> shift) & 0xf);
+            if (nibble == 0 && !started && shift != 0) continue;
+            started = true;
+            put("0123456789abcdef"[nibble]);
+        }
+        return *this;
+    }
+
+    void end() {
+        put('\n');
+        flush();
+    }
+
+   private:
+    int fd_;
+    std::array<char, 256> buffer_{};
+    size_t size_{};
+
+    void put(char c) {
+        if (size_ == buffer_.size()) flush();
+        buffer_.at(size_++) = c;
+    }
+
+    void flush() {
+        size_t written = 0;
+        while (written < size_) {
+            const ssize_t n = write(fd_, buffer_.data() + written, size_ - written);
+            if (n <= 0) break;
+            written += static_cast<size_t>(n);
+        }
+        size_ = 0;
+    }
+};
+
+std::string_view kindName(FlightRecorder::Kind kind) {
+    switch (kind) {
+        case FlightRecorder::Kind::Key: return "key";
+        case FlightRecorder::Kind::TapTimeout: return "tap_timeout";
+        case FlightRecorder::Kind::WatchdogSoftDisable: return "watchdog_soft_disable";
+        case FlightRecorder::Kind::WatchdogReEnable: return "watchdog_re_enable";
+        case FlightRecorder::Kind::WatchdogHardExit: return "watchdog_hard_exit";
+    }
+    return "?";
+}
+
+// clock_gettime backs steady_clock on darwin and linux, and is async-signal-safe
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+void FlightRecorder::record(const Entry& entry) {
+    const uint64_t seq = next_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots_.at(seq % kCapacity);
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.timeNs.store(entry.timeNs, std::memory_order_relaxed);
+    slot.durationNs.store(entry.durationNs, std::memory_order_relaxed);
+    slot.flags.store(entry.flags, std::memory_order_relaxed);
+    slot.type.store(entry.type, std::memory_order_relaxed);
+    slot.keycode.store(entry.keycode, std::memory_order_relaxed);
+    slot.binding.store(entry.binding, std::memory_order_relaxed);
+    slot.kind.store(static_cast<uint8_t>(entry.kind), std::memory_order_relaxed);
+    slot.consumed.store(entry.consumed, std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_release);
+}
+
+bool FlightRecorder::read(uint64_t seq, Entry& entry) const {
+    const Slot& slot = slots_.at(seq % kCapacity);
+    if (slot.seq.load(std::memory_order_acquire) != seq + 1) return false;
+    entry.timeNs = slot.timeNs.load(std::memory_order_relaxed);
+    entry.durationNs = slot.durationNs.load(std::memory_order_relaxed);
+    entry.flags = slot.flags.load(std::memory_order_relaxed);
+    entry.type = slot.type.load(std::memory_order_relaxed);
+    entry.keycode = slot.keycode.load(std::memory_order_relaxed);
+    entry.binding = slot.binding.load(std::memory_order_relaxed);
+    entry.kind = static_cast<Kind>(slot.kind.load(std::memory_order_relaxed));
+    entry.consumed = slot.consumed.load(std::memory_order_relaxed);
+    // a writer that claimed the slot meanwhile has zeroed seq first, so a torn read shows here
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.seq.load(std::memory_order_relaxed) == seq + 1;
+}
+
+bool FlightRecorder::setDumpPath(const std::filesystem::path& path) {
+    const auto& native = path.native();
+    if (native.size() >= dumpPath_.size()) return false;
+    std::memcpy(dumpPath_.data(), native.c_str(), native.size() + 1);
+    return true;
+}
+
+void FlightRecorder::dump(std::string_view reason) const {
+    if (dumpPath_.front() == '\0') return;
+    // a symlink in place of the dump fails with ELOOP rather than truncating whatever it points at
+    const int fd = open(dumpPath_.data(), O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);  // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (fd == -1) return;
+    dump(fd, reason);
+    close(fd);
+}
+
+void FlightRecorder::dump(int fd, std::string_view reason) const {
+    const int64_t now = nowNs();
+    LineWriter(fd).str("smhkd flight recorder: ").str(reason).str(", pid ").dec(getpid()).end();
+    forEach([&](const Entry& entry) {
+        LineWriter line(fd);
+        line.str("t-").dec((now - entry.timeNs) / 1000).str("us ").str(kindName(entry.kind));
+        if (entry.kind == Kind::Key) {
+            line.str(" type=").udec(entry.type).str(" keycode=").udec(entry.keycode).str(" flags=").hex(entry.flags);
+            line.str(" binding=").dec(entry.binding).str(entry.consumed ? " consumed" : " passed");
+        }
+        line.str(" took=").dec(entry.durationNs / 1000).str("us").end();
+    });
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+// the last kCapacity events and decisions of the event tap, kept so a safety trip or watchdog
+// exit leaves something to diagnose. recording is a handful of relaxed stores into a ring;
+// dumping is async-signal-safe (no allocation, no locks, only write(2)) because the callback
+// it runs after may be stuck holding the allocator or a log lock
+class FlightRecorder {
+   public:
+    enum class Kind : uint8_t {
+        Key,
+        // kCGEventTapDisabledByTimeout, recovered or not
+        TapTimeout,
+        WatchdogSoftDisable,
+        WatchdogReEnable,
+        // the callback that was stuck when the watchdog gave up
+        WatchdogHardExit,
+    };
+
+    struct Entry {
+        Kind kind{Kind::Key};
+        // steady-clock nanoseconds
+        int64_t timeNs{};
+        // the CGEventType of a key event
+        uint32_t type{};
+        uint32_t keycode{};
+        uint64_t flags{};
+        // index into the engine's bindings, -1 for none
+        int32_t binding{-1};
+        bool consumed{};
+        int64_t durationNs{};
+    };
+
+    static constexpr size_t kCapacity = 256;
+    static_assert((kCapacity & (kCapacity - 1)) == 0);
+
+    // called from the event tap and watchdog threads at once, so a slot is claimed with one fetch_add
+    void record(const Entry& entry);
+
+    // oldest first; entries being overwritten while read are skipped
+    template <typename F>
+    void forEach(F&& f) const {
+        const uint64_t end = next_.load(std::memory_order_acquire);
+        for (uint64_t seq = end > kCapacity ? end - kCapacity : 0; seq < end; seq++) {
+            Entry entry;
+            if (read(seq, entry)) f(entry);
+        }
+    }
+
+    // where dump() writes; resolved up front since dumping can't allocate. false when it doesn't fit
+    bool setDumpPath(const std::filesystem::path& path);
+    // the entries as text, one per line, after a line naming the reason. async-signal-safe
+    void dump(std::string_view reason) const;
+    void dump(int fd, std::string_view reason) const;
+
+   private:
+    struct Slot {
+        // the record's sequence number + 1, or 0 while it is being written
+        std::atomic<uint64_t> seq{};
+        std::atomic<int64_t> timeNs{};
+        std::atomic<int64_t> durationNs{};
+        std::atomic<uint64_t> flags{};
+        std::atomic<uint32_t> type{};
+        std::atomic<uint32_t> keycode{};
+        std::atomic<int32_t> binding{};
+        std::atomic<uint8_t> kind{};
+        std::atomic<bool> consumed{};
+    };
+
+    std::array<Slot, kCapacity> slots_{};
+    std::atomic<uint64_t> next_{};
+    std::array<char, PATH_MAX> dumpPath_{};
+
+    bool read(uint64_t seq, Entry& entry) const;
+};
+
+// the dump file, in the per-user cache directory rather than a shared one another user could plant a link in
+inline constexpr std::string_view FLIGHT_RECORDER_FILE = "smhkd.flight";
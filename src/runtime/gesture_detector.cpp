@@ -0,0 +1,157 @@
+#include "gesture_detector.hpp"
+
+#include <cmath>
+
+namespace {
+
+// spreads below this are fingers stacked on top of each other, too small to pinch from
+constexpr float kMinSpread = 0.01F;
+
+}  // namespace
+
+std::optional<Gesture> GestureDetector::onFrame(const std::vector<Touch>& touches, int64_t nowNs) {
+    for (size_t i = 0; i < count_; i++) {
+        contacts_[i].seen = false;
+    }
+
+    bool membershipChanged = false;
+    for (const auto& t : touches) {
+        Contact* contact = nullptr;
+        for (size_t i = 0; i < count_; i++) {
+            if (contacts_[i].id == t.id) {
+                contact = &contacts_[i];
+                break;
+            }
+        }
+        if (!contact) {
+            // more contacts than the framework can report means a palm or garbage frame
+            if (count_ == kMaxContacts) continue;
+            contact = &contacts_[count_++];
+            *contact = Contact{.id = t.id, .startX = t.x, .startY = t.y, .x = t.x, .y = t.y, .seen = false};
+            membershipChanged = true;
+        }
+        contact->x = t.x;
+        contact->y = t.y;
+        contact->seen = true;
+        if (std::hypot(contact->x - contact->startX, contact->y - contact->startY) > config_.tapSlop) {
+            moved_ = true;
+        }
+    }
+
+    for (size_t i = 0; i < count_;) {
+        if (contacts_[i].seen) {
+            i++;
+            continue;
+        }
+        contacts_[i] = contacts_[--count_];
+        membershipChanged = true;
+    }
+
+    if (!active_) {
+        if (count_ == 0) return std::nullopt;
+        active_ = true;
+        fired_ = false;
+        moved_ = false;
+        maxFingers_ = 0;
+        downNs_ = nowNs;
+    }
+
+    const int fingers = static_cast<int>(count_);
+    if (fingers == 0) {
+        active_ = false;
+        const int64_t timeoutNs = static_cast<int64_t>(config_.tapTimeoutMs) * 1'000'000;
+        if (!fired_ && !moved_ && maxFingers_ >= config_.minFingers && (nowNs - downNs_) <= timeoutNs) {
+            return Gesture{.kind = GestureKind::Tap, .fingers = maxFingers_};
+        }
+        return std::nullopt;
+    }
+
+    if (fingers > maxFingers_) maxFingers_ = fingers;
+    if (membershipChanged) rebaseline();
+
+    // only recognize while every finger of the session is down, so the lift-off
+    // of a finger or two at the end of a gesture never reads as motion
+    if (fired_ || fingers < config_.minFingers || fingers != maxFingers_) return std::nullopt;
+
+    auto gesture = recognizeMotion();
+    if (gesture) fired_ = true;
+    return gesture;
+}
+
+float GestureDetector::spread() const {
+    if (count_ == 0) return 0.0F;
+    float cx = 0.0F;
+    float cy = 0.0F;
+    for (size_t i = 0; i < count_; i++) {
+        cx += contacts_[i].x;
+        cy += contacts_[i].y;
+    }
+    const auto n = static_cast<float>(count_);
+    cx /= n;
+    cy /= n;
+    float total = 0.0F;
+    for (size_t i = 0; i < count_; i++) {
+        total += std::hypot(contacts_[i].x - cx, contacts_[i].y - cy);
+    }
+    return total / n;
+}
+
+void GestureDetector::rebaseline() {
+    for (size_t i = 0; i < count_; i++) {
+        contacts_[i].startX = contacts_[i].x;
+        contacts_[i].startY = contacts_[i].y;
+    }
+    baseSpread_ = spread();
+}
+
+std::optional<Gesture> GestureDetector::recognizeMotion() const {
+    const auto n = static_cast<float>(count_);
+    float dx = 0.0F;
+    float dy = 0.0F;
+    for (size_t i = 0; i < count_; i++) {
+        dx += contacts_[i].x - contacts_[i].startX;
+        dy += contacts_[i].y - contacts_[i].startY;
+    }
+    dx /= n;
+    dy /= n;
+    const float travel = std::hypot(dx, dy);
+
+    if (baseSpread_ >= kMinSpread && travel < config_.swipeDistance) {
+        const float ratio = spread() / baseSpread_;
+        if (ratio <= 1.0F - config_.pinchRatio) {
+            return Gesture{.kind = GestureKind::PinchIn, .fingers = maxFingers_};
+        }
+        if (ratio >= 1.0F + config_.pinchRatio) {
+            return Gesture{.kind = GestureKind::PinchOut, .fingers = maxFingers_};
+        }
+    }
+
+    if (travel < config_.swipeDistance) return std::nullopt;
+
+    // every finger must be heading the same way as the centroid, at least half as far
+    const float travelSq = travel * travel;
+    for (size_t i = 0; i < count_; i++) {
+        const float fx = contacts_[i].x - contacts_[i].startX;
+        const float fy = contacts_[i].y - contacts_[i].startY;
+        if (fx * dx + fy * dy < 0.5F * travelSq) return std::nullopt;
+    }
+
+    // origin is bottom-left, so positive y travel is upward
+    GestureKind kind{};
+    if (std::abs(dx) >= std::abs(dy)) {
+        kind = dx < 0 ? GestureKind::SwipeLeft : GestureKind::SwipeRight;
+    } else {
+        kind = dy < 0 ? GestureKind::SwipeDown : GestureKind::SwipeUp;
+    }
+    return Gesture{.kind = kind, .fingers = maxFingers_};
+}
+
+void GestureDetector::reset() {
+    count_ = 0;
+    active_ = false;
+    fired_ = false;
+    moved_ = false;
+    maxFingers_ = 0;
+    downNs_ = 0;
+    baseSpread_ = 0.0F;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "../input/gesture.hpp"
+#include "tap_detector.hpp"
+
+// pure multi-finger gesture recognizer, fed one frame of touches at a time
+// a session runs from the first finger down to the last finger up. within it:
+// - swipe: every finger travels the same way past swipeDistance, fired on that frame
+// - pinch: the fingers' spread around their centroid grows or shrinks by pinchRatio
+// - tap: all fingers lift within tapTimeoutMs without travelling past tapSlop
+// at most one gesture fires per session, and state is a fixed array of contacts
+class GestureDetector {
+   public:
+    struct Config {
+        int tapTimeoutMs = 300;
+        // distances are fractions of the normalized (0..1) trackpad
+        float swipeDistance = 0.12F;
+        float tapSlop = 0.03F;
+        // relative change in spread, 0.25 = 25% closer together or further apart
+        float pinchRatio = 0.25F;
+        int minFingers = kMinGestureFingers;
+    };
+
+    void setConfig(Config config) { config_ = config; }
+
+    std::optional<Gesture> onFrame(const std::vector<Touch>& touches, int64_t nowNs);
+    void reset();
+
+    // the framework reports at most this many simultaneous contacts per device
+    static constexpr size_t kMaxContacts = 16;
+
+   private:
+    struct Contact {
+        int id;
+        float startX;
+        float startY;
+        float x;
+        float y;
+        bool seen;
+    };
+
+    Config config_;
+    std::array<Contact, kMaxContacts> contacts_{};
+    size_t count_{};
+
+    bool active_{};
+    bool fired_{};
+    bool moved_{};
+    int maxFingers_{};
+    int64_t downNs_{};
+    float baseSpread_{};
+
+    [[nodiscard]] float spread() const;
+    void rebaseline();
+    [[nodiscard]] std::optional<Gesture> recognizeMotion() const;
+};
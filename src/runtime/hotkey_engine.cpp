@@ -3,7 +3,6 @@
 #include <algorithm>
 #include <cctype>
 #include <chrono>
-#include <thread>
 #include <variant>
 
 #include "../common/command.hpp"
@@ -13,6 +12,7 @@
 #include "../common/string_util.hpp"
 #include "../input/modifier.hpp"
 #include "post_media_key.hpp"
+#include "stats.hpp"
 
 namespace {
 
@@ -23,26 +23,33 @@ os_log_t signpostLog() {
 
 }  // namespace
 
-void HotkeyEngine::applyConfig(std::vector<Binding> bindings, std::vector<TapBinding> tapBindings, ConfigProperties config) {
+void HotkeyEngine::applyConfig(std::vector<Binding> bindings, std::vector<TapBinding> tapBindings, ConfigProperties config,
+    std::vector<GestureBinding> gestureBindings, std::vector<PressBinding> pressBindings) {
     {
         std::lock_guard<std::mutex> lock(tapMutex_);
         bindings_ = std::move(bindings);
         tapBindings_ = std::move(tapBindings);
+        gestureBindings_ = std::move(gestureBindings);
+        pressBindings_ = std::move(pressBindings);
         config_ = std::move(config);
     }
     reset();
 }
 
+void HotkeyEngine::applyTrackpadBindings(std::vector<TapBinding> tapBindings, std::vector<GestureBinding> gestureBindings,
+    std::vector<PressBinding> pressBindings) {
+    std::lock_guard<std::mutex> lock(tapMutex_);
+    tapBindings_ = std::move(tapBindings);
+    gestureBindings_ = std::move(gestureBindings);
+    pressBindings_ = std::move(pressBindings);
+}
+
 bool HotkeyEngine::handleTap(Zone zone, ModifierFlags mods) {
     std::lock_guard<std::mutex> lock(tapMutex_);
     for (const auto& tb : tapBindings_) {
         if (tb.zone != zone) continue;
         if (!tb.modifiers.isActivatedBy(mods)) continue;
-        if (const auto* command = std::get_if<std::string>(&tb.action)) {
-            executeHotkeyCommand(*command);
-        } else {
-            synthesizeKeyPress(std::get<Chord>(tb.action));
-        }
+        runTrackpadAction(tb.action);
         return true;
     }
     return false;
@@ -56,30 +63,73 @@ bool HotkeyEngine::hasTapBinding(Zone zone, ModifierFlags mods) const {
     return false;
 }
 
-bool HotkeyEngine::handleEvent(const Chord& current, CGEventType type, bool isRepeat, int fingerCount) {
+bool HotkeyEngine::handleGesture(Gesture gesture, ModifierFlags mods) {
+    std::lock_guard<std::mutex> lock(tapMutex_);
+    for (const auto& gb : gestureBindings_) {
+        if (gb.gesture != gesture) continue;
+        if (!gb.modifiers.isActivatedBy(mods)) continue;
+        debug("gesture matched: {}", gesture);
+        runTrackpadAction(gb.action);
+        return true;
+    }
+    return false;
+}
+
+bool HotkeyEngine::handlePress(Press press, ModifierFlags mods) {
+    std::lock_guard<std::mutex> lock(tapMutex_);
+    for (const auto& pb : pressBindings_) {
+        if (!pb.press.triggeredBy(press)) continue;
+        if (!pb.modifiers.isActivatedBy(mods)) continue;
+        debug("press matched: {}", pb.press);
+        runTrackpadAction(pb.action);
+        return true;
+    }
+    return false;
+}
+
+bool HotkeyEngine::handleEvent(const Chord& current, CGEventType type, bool isRepeat, int fingerCount, std::optional<int64_t> timeNs) {
+    const auto decision = decideEvent(current, type, isRepeat, fingerCount, timeNs);
+    if (decision.kind == EventDecision::Kind::Rewrite) {
+        // no event to rewrite, so a new one goes out through the output thread
+        output_.enqueueEvent(decision.target, type == kCGEventKeyDown);
+        bump(runtimeStats().remapsPosted);
+        return true;
+    }
+    return decision.kind == EventDecision::Kind::Consume;
+}
+
+EventDecision HotkeyEngine::decideEvent(
+    const Chord& current, CGEventType type, bool isRepeat, int fingerCount, std::optional<int64_t> timeNs) {
     os_log_t log = signpostLog();
     os_signpost_id_t spid = SIGNPOST_GENERATE(log);
     SIGNPOST_BEGIN(log, spid, "handleEvent");
+    lastMatch_ = -1;
 
     if (!config_.blacklist.empty()) {
         os_signpost_id_t bp = SIGNPOST_GENERATE(log);
         SIGNPOST_BEGIN(log, bp, "frontProcessLookup");
+        const auto lookupStart = std::chrono::steady_clock::now();
         const auto front = getFrontProcessName();
+        runtimeStats().frontProcessLookup.record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - lookupStart).count());
         SIGNPOST_END(log, bp, "frontProcessLookup");
         if (isBlacklisted(front)) {
             clearSequence();
             SIGNPOST_END(log, spid, "handleEvent", "path=blacklisted");
-            return false;
+            return {};
         }
     }
 
-    if (type == kCGEventKeyDown && !isRepeat && handleSequence(current, fingerCount)) {
+    if (type == kCGEventKeyDown && !isRepeat && handleSequence(current, fingerCount, timeNs ? *timeNs : time_->nowNs())) {
         SIGNPOST_END(log, spid, "handleEvent", "path=sequence");
-        return true;
+        return {.kind = EventDecision::Kind::Consume};
     }
 
     os_signpost_id_t mp = SIGNPOST_GENERATE(log);
     SIGNPOST_BEGIN(log, mp, "hotkeyMatch", "count=%zu", bindings_.size());
+    const Binding* matched = nullptr;
+    // a key(...) binding only runs when no binding names the key itself, wherever each is in the config
+    const Binding* wildcard = nullptr;
     for (const auto& binding : bindings_) {
         const auto& hotkey = binding.source;
         if (hotkey.chords.size() > 1) continue;
@@ -87,36 +137,99 @@ bool HotkeyEngine::handleEvent(const Chord& current, CGEventType type, bool isRe
 
         if (const auto* target = std::get_if<Chord>(&binding.action)) {
             if (type != kCGEventKeyDown && type != kCGEventKeyUp) continue;
-            postKeyEvent(*target, type == kCGEventKeyDown);
+            lastMatch_ = static_cast<int>(&binding - bindings_.data());
+            bump(runtimeStats().bindingsMatched);
             SIGNPOST_END(log, mp, "hotkeyMatch", "matched=1");
             SIGNPOST_END(log, spid, "handleEvent", "path=remap");
-            return true;
+            if (target->modifiers.has(Hotkey_Flag_NX)) {
+                postMediaKey(static_cast<int>(target->keysym.keycode), type == kCGEventKeyDown);
+                bump(runtimeStats().remapsPosted);
+                return {.kind = EventDecision::Kind::Consume};
+            }
+            // rewritten in place the event would go out ahead of a macro still being posted
+            if (output_.pending() > 0) {
+                output_.enqueueEvent(*target, type == kCGEventKeyDown);
+                bump(runtimeStats().remapsPosted);
+                return {.kind = EventDecision::Kind::Consume};
+            }
+            return {.kind = EventDecision::Kind::Rewrite, .target = *target};
+        }
+        if (!std::holds_alternative<std::string>(binding.action)) {
+            // a macro or text: typed once per press, the source's repeats and release swallowed
+            if (type != kCGEventKeyDown && type != kCGEventKeyUp) continue;
+            lastMatch_ = static_cast<int>(&binding - bindings_.data());
+            bump(runtimeStats().bindingsMatched);
+            if (type == kCGEventKeyDown && !isRepeat) synthesizeAction(binding.action);
+            SIGNPOST_END(log, mp, "hotkeyMatch", "matched=1");
+            SIGNPOST_END(log, spid, "handleEvent", "path=macro");
+            return {.kind = EventDecision::Kind::Consume};
         }
+        if (hotkey.chords[0].keysym.wildcard != KeyClass::None) {
+            if (!wildcard) wildcard = &binding;
+            continue;
+        }
+        matched = &binding;
+        break;
+    }
+    if (!matched) matched = wildcard;
+    if (!matched) {
+        SIGNPOST_END(log, mp, "hotkeyMatch", "matched=0");
+        SIGNPOST_END(log, spid, "handleEvent", "path=none");
+        return {};
+    }
 
-        const auto& command = std::get<std::string>(binding.action);
-        debug("hotkey matched: {}", hotkey);
+    const auto& hotkey = matched->source;
+    debug("hotkey matched: {}", hotkey);
+    bump(runtimeStats().bindingsMatched);
+    lastMatch_ = static_cast<int>(matched - bindings_.data());
 
-        const bool runOnDown = !hotkey.on_release && type == kCGEventKeyDown && (!isRepeat || hotkey.repeat);
-        const bool runOnUp = hotkey.on_release && type == kCGEventKeyUp;
-        if ((runOnDown || runOnUp) && !command.empty()) {
-            os_signpost_id_t cp = SIGNPOST_GENERATE(log);
-            SIGNPOST_BEGIN(log, cp, "executeCommand");
-            executeHotkeyCommand(command);
-            SIGNPOST_END(log, cp, "executeCommand");
-        }
-        SIGNPOST_END(log, mp, "hotkeyMatch", "matched=1");
-        SIGNPOST_END(log, spid, "handleEvent", "path=hotkey");
-        return !hotkey.passthrough;
+    const bool runOnDown = !hotkey.on_release && type == kCGEventKeyDown && (!isRepeat || hotkey.repeat);
+    const bool runOnUp = hotkey.on_release && type == kCGEventKeyUp;
+    if (runOnDown || runOnUp) {
+        os_signpost_id_t cp = SIGNPOST_GENERATE(log);
+        SIGNPOST_BEGIN(log, cp, "executeCommand");
+        runHotkeyCommand(*matched, std::span(&current, 1));
+        SIGNPOST_END(log, cp, "executeCommand");
     }
-    SIGNPOST_END(log, mp, "hotkeyMatch", "matched=0");
-    SIGNPOST_END(log, spid, "handleEvent", "path=none");
-    return false;
+    SIGNPOST_END(log, mp, "hotkeyMatch", "matched=1");
+    SIGNPOST_END(log, spid, "handleEvent", "path=hotkey");
+    return {.kind = hotkey.passthrough ? EventDecision::Kind::Pass : EventDecision::Kind::Consume};
 }
 
 void HotkeyEngine::synthesizeKeyPress(const Chord& target) {
-    postKeyEvent(target, true);
-    std::this_thread::sleep_for(std::chrono::milliseconds(3));
-    postKeyEvent(target, false);
+    output_.enqueuePress(target);
+}
+
+size_t HotkeyEngine::bindingCount() const {
+    return bindings_.size();
+}
+
+size_t HotkeyEngine::trackpadBindingCount() const {
+    std::lock_guard<std::mutex> lock(tapMutex_);
+    return tapBindings_.size() + gestureBindings_.size() + pressBindings_.size();
+}
+
+void HotkeyEngine::synthesizeKeyPresses(std::span<const Chord> targets) {
+    output_.enqueuePresses(targets);
+}
+
+void HotkeyEngine::runTrackpadAction(const BindingAction& action) {
+    if (const auto* command = std::get_if<std::string>(&action)) {
+        executeHotkeyCommand(*command);
+    } else {
+        synthesizeAction(action);
+    }
+}
+
+void HotkeyEngine::synthesizeAction(const BindingAction& action) {
+    if (const auto* target = std::get_if<Chord>(&action)) {
+        synthesizeKeyPress(*target);
+    } else if (const auto* program = std::get_if<KeyProgram>(&action)) {
+        // typed text's bursts wait out their share of the type_rate; a macro only has press gaps
+        const std::chrono::microseconds burstGap =
+            std::chrono::microseconds(std::chrono::seconds(1)) * static_cast<int64_t>(kTypeBurst) / std::max(config_.typeRate, 1);
+        output_.enqueue(program->program, burstGap);
+    }
 }
 
 void HotkeyEngine::reset() {
@@ -127,7 +240,7 @@ void HotkeyEngine::clearSequence() {
     const bool wasActive = !sequence_.empty();
     sequence_.clear();
     sequenceFingers_.clear();
-    lastPressTime_ = std::chrono::time_point<std::chrono::system_clock>::min();
+    lastPressNs_.reset();
     if (wasActive) runSequenceCommand();
 }
 
@@ -148,12 +261,11 @@ void HotkeyEngine::runSequenceCommand() const {
     executeCommand(command);
 }
 
-bool HotkeyEngine::handleSequence(const Chord& chord, int fingerCount) {
-    const auto now = std::chrono::system_clock::now();
-    if (lastPressTime_ != std::chrono::time_point<std::chrono::system_clock>::min() && now - lastPressTime_ > config_.maxChordInterval) {
+bool HotkeyEngine::handleSequence(const Chord& chord, int fingerCount, int64_t nowNs) {
+    if (lastPressNs_ && std::chrono::nanoseconds(nowNs - *lastPressNs_) > config_.maxChordInterval) {
         clearSequence();
     }
-    lastPressTime_ = now;
+    lastPressNs_ = nowNs;
     sequence_.push_back(chord);
     sequenceFingers_.push_back(fingerCount);
 
@@ -173,9 +285,14 @@ bool HotkeyEngine::handleSequence(const Chord& chord, int fingerCount) {
 
         if (sequence_.size() == hotkey.chords.size()) {
             debug("Matched complete chord sequence ending with: {}", hotkey);
-            // remaps are always single-chord (enforced at interpret time), so a
-            // multi-chord match here can only be a command action
-            executeHotkeyCommand(std::get<std::string>(binding.action));
+            bump(runtimeStats().bindingsMatched);
+            lastMatch_ = static_cast<int>(&binding - bindings_.data());
+            // a sequence remap types its program once the sequence completes
+            if (std::holds_alternative<std::string>(binding.action)) {
+                runHotkeyCommand(binding, sequence_);
+            } else {
+                synthesizeAction(binding.action);
+            }
             clearSequence();
             return true;
         }
@@ -190,10 +307,27 @@ bool HotkeyEngine::handleSequence(const Chord& chord, int fingerCount) {
     return false;
 }
 
+void HotkeyEngine::runHotkeyCommand(const Binding& binding, std::span<const Chord> pressed) const {
+    const auto& command = std::get<std::string>(binding.action);
+    const auto& chords = binding.source.chords;
+    const auto wildcard = std::ranges::find_if(chords, [](const Chord& c) { return c.keysym.wildcard != KeyClass::None; });
+    if (wildcard == chords.end()) {
+        executeHotkeyCommand(command);
+        return;
+    }
+    const auto index = static_cast<size_t>(wildcard - chords.begin());
+    if (index < pressed.size()) executeHotkeyCommand(fillKeyCapture(command, pressed[index].keysym));
+}
+
 void HotkeyEngine::executeHotkeyCommand(const std::string& command) const {
     if (command.empty()) return;
     debug("executing command: {}", command);
-    executeCommand(command);
+    bump(runtimeStats().commandsRun);
+    runCommand_(command);
+}
+
+void HotkeyEngine::runCommand(const std::string& command) {
+    executeCommand(command, [] { bump(runtimeStats().commandsFailed); }, [] { bump(runtimeStats().commandsDequeued); });
 }
 
 bool HotkeyEngine::isBlacklisted(std::string_view processName) const {
@@ -202,18 +336,45 @@ bool HotkeyEngine::isBlacklisted(std::string_view processName) const {
     return std::ranges::contains(config_.blacklist, processName);
 }
 
+CGEventRef HotkeyEngine::createKeyEvent(const Chord& target, bool keyDown) {
+    CGEventRef event = CGEventCreateKeyboardEvent(nullptr, static_cast<CGKeyCode>(target.keysym.keycode), keyDown);
+    if (!event) return nullptr;
+    CGEventSetFlags(event, hotkeyFlagsToEventFlags(target.modifiers));
+    CGEventSetIntegerValueField(event, kCGEventSourceUserData, SYNTHETIC_REMAP_TAG);
+    return event;
+}
+
+void HotkeyEngine::rewriteKeyEvent(CGEventRef event, const Chord& target) {
+    CGEventSetIntegerValueField(event, kCGKeyboardEventKeycode, target.keysym.keycode);
+    CGEventSetFlags(event, hotkeyFlagsToEventFlags(target.modifiers));
+}
+
+void HotkeyEngine::postEvent(const KeyEvent& event, std::u16string_view text) {
+    if (text.empty()) {
+        postKeyEvent(chordOf(event), event.keyDown);
+        return;
+    }
+    CGEventRef keyEvent = createKeyEvent(chordOf(event), event.keyDown);
+    if (!keyEvent) {
+        warn("failed to create synthetic key event for typed text");
+        return;
+    }
+    static_assert(sizeof(UniChar) == sizeof(char16_t));
+    CGEventKeyboardSetUnicodeString(keyEvent, static_cast<UniCharCount>(text.size()), reinterpret_cast<const UniChar*>(text.data()));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    CGEventPost(kCGSessionEventTap, keyEvent);
+    CFRelease(keyEvent);
+}
+
 void HotkeyEngine::postKeyEvent(const Chord& target, bool keyDown) {
     if (target.modifiers.has(Hotkey_Flag_NX)) {
         postMediaKey(static_cast<int>(target.keysym.keycode), keyDown);
         return;
     }
-    CGEventRef event = CGEventCreateKeyboardEvent(nullptr, static_cast<CGKeyCode>(target.keysym.keycode), keyDown);
+    CGEventRef event = createKeyEvent(target, keyDown);
     if (!event) {
         warn("failed to create synthetic key event for remap");
         return;
     }
-    CGEventSetFlags(event, hotkeyFlagsToEventFlags(target.modifiers));
-    CGEventSetIntegerValueField(event, kCGEventSourceUserData, SYNTHETIC_REMAP_TAG);
     CGEventPost(kCGSessionEventTap, event);
     CFRelease(event);
 }
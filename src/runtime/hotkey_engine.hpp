@@ -4,46 +4,125 @@
 
 #include <chrono>
 #include <cstdint>
+#include <functional>
 #include <mutex>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
 
 #include "../input/chord.hpp"
+#include "../input/gesture.hpp"
 #include "../input/hotkey.hpp"
+#include "../input/press.hpp"
 #include "../input/zone.hpp"
 #include "../lang/interpreter.hpp"
+#include "output_scheduler.hpp"
+#include "time_source.hpp"
+
+// what the event tap does with a key event
+struct EventDecision {
+    enum class Kind : uint8_t {
+        Pass,
+        Consume,
+        // pass the event on changed into target, see HotkeyEngine::rewriteKeyEvent
+        Rewrite,
+    };
+    Kind kind{Kind::Pass};
+    Chord target{};
+};
 
 class HotkeyEngine {
    public:
-    void applyConfig(std::vector<Binding> bindings, std::vector<TapBinding> tapBindings, ConfigProperties config);
-    [[nodiscard]] bool handleEvent(const Chord& current, CGEventType type, bool isRepeat, int fingerCount);
+    // runs a matched binding's command, already filled in
+    using RunCommand = std::function<void(const std::string& command)>;
+
+    // the clock for events that arrive without a timestamp; it must outlive the engine. synthesized
+    // presses, macros and posted remaps go out through post on the engine's output thread, and
+    // commands through run
+    explicit HotkeyEngine(
+        const TimeSource& time = steadyTimeSource(), OutputScheduler::Post post = postEvent, RunCommand run = runCommand)
+        : time_(&time), runCommand_(std::move(run)), output_(std::move(post)) {}
+
+    void applyConfig(std::vector<Binding> bindings, std::vector<TapBinding> tapBindings, ConfigProperties config,
+        std::vector<GestureBinding> gestureBindings = {}, std::vector<PressBinding> pressBindings = {});
+    // swap only the trackpad tables, keeping the keyboard bindings and any chord sequence in progress
+    void applyTrackpadBindings(std::vector<TapBinding> tapBindings, std::vector<GestureBinding> gestureBindings,
+        std::vector<PressBinding> pressBindings);
+    // timeNs is the event's own time (see TimeSource), which the chord interval is measured in;
+    // without one the engine asks its clock. a remap comes back as a Rewrite for the caller to
+    // apply to the event it holds, unless output is still queued: then it is posted behind that,
+    // like a remap to a media key, which has no keycode to become, and the event is consumed
+    [[nodiscard]] EventDecision decideEvent(
+        const Chord& current, CGEventType type, bool isRepeat, int fingerCount, std::optional<int64_t> timeNs = std::nullopt);
+    // decideEvent for callers with no event to rewrite, so a remap is posted as a new event; whether the event is consumed
+    [[nodiscard]] bool handleEvent(
+        const Chord& current, CGEventType type, bool isRepeat, int fingerCount, std::optional<int64_t> timeNs = std::nullopt);
+    // the index of the binding the last handleEvent ran, -1 for none
+    [[nodiscard]] int lastMatch() const { return lastMatch_; }
 
-    // run a matching corner-tap binding; returns whether one fired
+    // run a matching zone-tap binding; returns whether one fired
     [[nodiscard]] bool handleTap(Zone zone, ModifierFlags mods);
-    // whether a corner-tap binding exists for this zone + modifiers (for click suppression)
+    // whether a zone-tap binding exists for this zone + modifiers (for click suppression)
     [[nodiscard]] bool hasTapBinding(Zone zone, ModifierFlags mods) const;
+    // run a matching swipe/pinch/multi-finger-tap binding; returns whether one fired
+    [[nodiscard]] bool handleGesture(Gesture gesture, ModifierFlags mods);
+    // run a matching force-press binding; returns whether one fired
+    [[nodiscard]] bool handlePress(Press press, ModifierFlags mods);
+
+    [[nodiscard]] size_t bindingCount() const;
+    // tap, gesture and press bindings
+    [[nodiscard]] size_t trackpadBindingCount() const;
 
     void reset();
-    static void synthesizeKeyPress(const Chord& target);
+    // queued on the output thread, returning at once; the press's down and up go out a gap apart
+    void synthesizeKeyPress(const Chord& target);
+    // a press and release of each in turn, queued as one batch so nothing lands between them
+    void synthesizeKeyPresses(std::span<const Chord> targets);
+    // blocks until everything synthesized so far has been posted
+    void drainOutput() { output_.drain(); }
+    // a keyboard event for target, tagged SYNTHETIC_REMAP_TAG so our own tap lets it by; the caller releases it
+    [[nodiscard]] static CGEventRef createKeyEvent(const Chord& target, bool keyDown);
+    // makes a key event into target: its keycode and flags change, its timestamp and autorepeat stay
+    static void rewriteKeyEvent(CGEventRef event, const Chord& target);
+
+    // posts one key event for target now, from whichever thread calls it
+    static void postKeyEvent(const Chord& target, bool keyDown);
+    // postKeyEvent for an event of a program, with its unicode string when it has one
+    static void postEvent(const KeyEvent& event, std::u16string_view text);
+    // hands command to the shell on the command queue, counting fork failures and drops
+    static void runCommand(const std::string& command);
 
     static constexpr int64_t SYNTHETIC_REMAP_TAG = 0x534d484b44;
 
    private:
     std::vector<Binding> bindings_;
     std::vector<TapBinding> tapBindings_;
+    std::vector<GestureBinding> gestureBindings_;
+    std::vector<PressBinding> pressBindings_;
     ConfigProperties config_;
-    // guards tapBindings_ across the MultitouchSupport callback thread and run-loop reloads
+    // guards the trackpad bindings (tap, gesture, press) across the MultitouchSupport callback thread and run-loop reloads
     mutable std::mutex tapMutex_;
+    const TimeSource* time_;
+    RunCommand runCommand_;
     std::vector<Chord> sequence_;
     std::vector<int> sequenceFingers_;
-    std::chrono::time_point<std::chrono::system_clock> lastPressTime_;
+    // when the sequence's last chord was pressed
+    std::optional<int64_t> lastPressNs_;
+    int lastMatch_{-1};
+    // last, so its thread stops before the rest of the engine goes
+    OutputScheduler output_;
 
     void clearSequence();
     void runSequenceCommand() const;
-    [[nodiscard]] bool handleSequence(const Chord& chord, int fingerCount);
+    [[nodiscard]] bool handleSequence(const Chord& chord, int fingerCount, int64_t nowNs);
     [[nodiscard]] bool isBlacklisted(std::string_view processName) const;
     void executeHotkeyCommand(const std::string& command) const;
-    static void postKeyEvent(const Chord& target, bool keyDown);
+    // a hotkey's command, a key(...) one filled with the key pressed at its chord of the sequence
+    void runHotkeyCommand(const Binding& binding, std::span<const Chord> pressed) const;
+    // a trackpad binding's action: the command, or whatever synthesizeAction types
+    void runTrackpadAction(const BindingAction& action);
+    // a remap's target as a press, or its compiled program, queued on the output thread
+    void synthesizeAction(const BindingAction& action);
 };
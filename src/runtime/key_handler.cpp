@@ -1,15 +1,22 @@
 #include "key_handler.hpp"
 
+#include <mach/mach_time.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <chrono>
+#include <cstdlib>
+#include <format>
+#include <system_error>
 
+#include "../common/config_path.hpp"
 #include "../common/log.hpp"
 #include "../common/signpost.hpp"
 #include "../lang/config_loader.hpp"
 #include "../runtime/service.hpp"
 #include "../runtime/touch_handler.hpp"
+#include "stats.hpp"
+#include "time_source.hpp"
 
 namespace {
 
@@ -18,10 +25,22 @@ os_log_t signpostLog() {
     return log;
 }
 
+// for durations; event times come from eventTimeNs
 int64_t nowNs() {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::steady_clock::now().time_since_epoch())
-        .count();
+    return steadyTimeSource().nowNs();
+}
+
+// the event's own timestamp on the TimeSource clock, saving a syscall per event. CGEvent
+// timestamps count mach absolute time, which is nanoseconds only on Intel
+int64_t eventTimeNs(CGEventRef event) {
+    const CGEventTimestamp ticks = CGEventGetTimestamp(event);
+    if (ticks == 0) return nowNs();
+    static const mach_timebase_info_data_t timebase = [] {
+        mach_timebase_info_data_t info{};
+        mach_timebase_info(&info);
+        return info;
+    }();
+    return static_cast<int64_t>(ticks * timebase.numer / timebase.denom);
 }
 
 // how recently a finger must have been in a corner to suppress a click there
@@ -39,6 +58,12 @@ bool KeyHandler::init() {
     runLoop = CFRunLoopGetCurrent();
     if (!runLoop) return false;
     debug("run loop initialized");
+    if (const auto dir = getCacheDir("smhkd")) {
+        std::error_code ec;
+        std::filesystem::create_directories(*dir, ec);
+        const auto path = *dir / FLIGHT_RECORDER_FILE;
+        if (!ec && recorder.setDumpPath(path)) debug("flight recorder dumps to {}", path.string());
+    }
     if (!setupEventTap()) return false;
     debug("event tap initialized");
 
@@ -68,7 +93,8 @@ bool KeyHandler::setupEventTap() {
 CGEventRef KeyHandler::eventCallback(CGEventTapProxy /*proxy*/, CGEventType type, CGEventRef event, void* refcon) {
     auto* keyHandler = static_cast<KeyHandler*>(refcon);
 
-    keyHandler->callbackStartNs.store(nowNs(), std::memory_order_release);
+    const int64_t startNs = nowNs();
+    keyHandler->callbackStartNs.store(startNs, std::memory_order_release);
 
     // fail open: on any error, pass the event through untouched, never consume
     CGEventRef result = event;
@@ -78,13 +104,17 @@ CGEventRef KeyHandler::eventCallback(CGEventTapProxy /*proxy*/, CGEventType type
             CGEventTapEnable(keyHandler->eventTap, true);
         } else if (type == kCGEventTapDisabledByTimeout) {
             // a callback overran the OS timeout, the breaker decides recover vs bail
+            keyHandler->recorder.record({.kind = FlightRecorder::Kind::TapTimeout, .timeNs = startNs});
             switch (keyHandler->safety.recordTimeout()) {
                 case SafetyMonitor::Action::Trip:
+                    bump(runtimeStats().safetyTrips);
+                    keyHandler->recorder.dump("safety trip, event tap timing out repeatedly");
                     error("event tap timing out repeatedly, exiting for a clean restart");
                     CGEventTapEnable(keyHandler->eventTap, false);
                     _exit(1);
                 case SafetyMonitor::Action::ReEnable:
                 case SafetyMonitor::Action::None:
+                    bump(runtimeStats().safetyNearTrips);
                     warn("event tap disabled by timeout; re-enabled");
                     CGEventTapEnable(keyHandler->eventTap, true);
                     break;
@@ -95,32 +125,55 @@ CGEventRef KeyHandler::eventCallback(CGEventTapProxy /*proxy*/, CGEventType type
             os_log_t log = signpostLog();
             os_signpost_id_t spid = SIGNPOST_GENERATE(log);
             SIGNPOST_BEGIN(log, spid, "eventCallback", "type=%d", static_cast<int>(type));
-            const bool consumed = keyHandler->handleKeyEvent(event, type);
+            const int64_t eventNs = eventTimeNs(event);
+            const EventDecision decision = keyHandler->handleKeyEvent(event, type, eventNs);
+            // a rewrite replaces the keystroke as typed, so it counts as consumed for the breaker
+            const bool consumed = decision.kind != EventDecision::Kind::Pass;
             SIGNPOST_END(log, spid, "eventCallback", "consumed=%d", consumed ? 1 : 0);
 
             const bool isKeyDown = type == kCGEventKeyDown;
             const auto keycode = static_cast<uint32_t>(CGEventGetIntegerValueField(event, kCGKeyboardEventKeycode));
-            if (keyHandler->safety.recordEvent(isKeyDown, consumed, keycode, SafetyMonitor::clock::now()) == SafetyMonitor::Action::Trip) {
+            keyHandler->recorder.record({
+                .timeNs = startNs,
+                .type = static_cast<uint32_t>(type),
+                .keycode = keycode,
+                .flags = CGEventGetFlags(event),
+                .binding = keyHandler->lastBinding,
+                .consumed = consumed,
+                .durationNs = nowNs() - startNs,
+            });
+            if (keyHandler->safety.recordEvent(isKeyDown, consumed, keycode, SafetyMonitor::time_point{std::chrono::nanoseconds{eventNs}}) == SafetyMonitor::Action::Trip) {
+                bump(runtimeStats().safetyTrips);
+                keyHandler->recorder.dump("safety trip, event tap consuming nearly all input");
                 error("event tap consuming nearly all input, exiting for a clean restart");
                 CGEventTapEnable(keyHandler->eventTap, false);
                 _exit(1);
             }
             keyHandler->safety.recordHealthy();
 
-            result = consumed ? nullptr : event;
+            // in place, after the recorder has the original: the event goes on to the next tap
+            // as the target, rather than being dropped and a new one posted back through this tap
+            if (decision.kind == EventDecision::Kind::Rewrite) {
+                HotkeyEngine::rewriteKeyEvent(event, decision.target);
+                bump(runtimeStats().remapsRewritten);
+            }
+            result = decision.kind == EventDecision::Kind::Consume ? nullptr : event;
         }
     } catch (...) {
         result = event;
     }
 
+    runtimeStats().eventCallback.record(nowNs() - startNs);
     keyHandler->callbackStartNs.store(0, std::memory_order_release);
     keyHandler->callbackGen.fetch_add(1, std::memory_order_release);
     return result;
 }
 
-bool KeyHandler::handleKeyEvent(CGEventRef event, CGEventType type) {
+EventDecision KeyHandler::handleKeyEvent(CGEventRef event, CGEventType type, int64_t eventNs) {
+    lastBinding = -1;
+    // posted by the engine itself, by handleEvent for a triggered remap or by synthesizeKeyPress
     if (CGEventGetIntegerValueField(event, kCGEventSourceUserData) == HotkeyEngine::SYNTHETIC_REMAP_TAG) {
-        return false;
+        return {};
     }
 
     auto keyCode = static_cast<CGKeyCode>(CGEventGetIntegerValueField(event, kCGKeyboardEventKeycode));
@@ -145,7 +198,14 @@ bool KeyHandler::handleKeyEvent(CGEventRef event, CGEventType type) {
         std::exit(1);
     }
 
-    return engine.handleEvent(current, type, isRepeat, fingers);
+    bump(runtimeStats().keyEvents);
+    if (passthrough) return {};
+    const int64_t engineStartNs = nowNs();
+    const EventDecision decision = engine.decideEvent(current, type, isRepeat, fingers, eventNs);
+    runtimeStats().handleEvent.record(nowNs() - engineStartNs);
+    lastBinding = engine.lastMatch();
+    if (decision.kind != EventDecision::Kind::Pass) bump(runtimeStats().consumedEvents);
+    return decision;
 }
 
 CGEventRef KeyHandler::handleMouseEvent(CGEventType type, CGEventRef event) {
@@ -158,7 +218,7 @@ CGEventRef KeyHandler::handleMouseEvent(CGEventType type, CGEventRef event) {
     }
 
     // left mouse down: swallow the tap-to-click that follows a modified corner tap
-    const auto zone = touch::recentCornerZone(kSuppressWindowNs);
+    const auto zone = touch::recentCornerZone(kSuppressWindowNs, eventTimeNs(event));
     if (zone) {
         const ModifierFlags mods = eventModifierFlagsToHotkeyFlags(CGEventSourceFlagsState(kCGEventSourceStateCombinedSessionState));
         if (engine.hasTapBinding(*zone, mods)) {
@@ -194,6 +254,8 @@ void KeyHandler::watchdogLoop() {
                 // deadlock the run loop can't recover from
                 // _exit lets launchd restart clean
                 CGEventTapEnable(eventTap, false);
+                recorder.record({.kind = FlightRecorder::Kind::WatchdogHardExit, .timeNs = start, .durationNs = elapsed});
+                recorder.dump("watchdog, event tap callback stuck past the hard overrun");
                 _exit(1);
             }
             if (elapsed > softNs && !softDisabled && callbackStartNs.load(std::memory_order_acquire) == start) {
@@ -202,6 +264,8 @@ void KeyHandler::watchdogLoop() {
                 genWhenDisabled = gen;
                 CGEventTapEnable(eventTap, false);
                 softDisabled = true;
+                bump(runtimeStats().watchdogSoftDisables);
+                recorder.record({.kind = FlightRecorder::Kind::WatchdogSoftDisable, .timeNs = start, .durationNs = elapsed});
             }
         }
 
@@ -209,6 +273,7 @@ void KeyHandler::watchdogLoop() {
         if (softDisabled && callbackGen.load(std::memory_order_acquire) != genWhenDisabled) {
             CGEventTapEnable(eventTap, true);
             softDisabled = false;
+            recorder.record({.kind = FlightRecorder::Kind::WatchdogReEnable, .timeNs = nowNs()});
         }
     }
 }
@@ -219,33 +284,104 @@ void KeyHandler::run() const {
     CFRunLoopRun();
 }
 
-void KeyHandler::loadConfig(const std::filesystem::path& configFile) {
+std::vector<std::string> KeyHandler::loadConfig(const std::filesystem::path& configFile) {
     info("config file set to: {}", configFile.string());
-    auto result = ConfigLoader::loadFromFile(configFile);
+    const int64_t loadStartNs = nowNs();
+    auto result = ConfigLoader::loadFromFile(configFile, {.useCache = true, .interpreter = &interpreter});
+    const int64_t loadNs = nowNs() - loadStartNs;
+    bump(runtimeStats().reloads);
+    runtimeStats().configLoad.record(loadNs);
+    std::vector<std::string> errors;
     if (result.fileError) {
-        warn("config error: {}", *result.fileError);
+        errors.push_back(std::format("config error: {}", *result.fileError));
     }
     for (const auto& parse_error : result.parseErrors) {
-        warn("parse error at line {}, column {}: {}", parse_error.row, parse_error.col, parse_error.message);
+        errors.push_back(std::format("parse error at line {}, column {}: {}", parse_error.row, parse_error.col, parse_error.message));
     }
     for (const auto& interpreter_error : result.interpreterErrors) {
-        warn("config error: {}", interpreter_error.message);
+        errors.push_back(std::format("config error: {}", interpreter_error.message));
     }
 
-    if (result.fileError || !result.parseErrors.empty() || !result.interpreterErrors.empty()) {
+    if (!errors.empty()) {
+        for (const auto& message : errors) warn(message);
         warn("config has errors, keeping previous config");
-        return;
+        bump(runtimeStats().reloadsFailed);
+        // the interpreter now holds the rejected config; diffing the next load against it
+        // could skip changes the engine never received
+        interpreter.reset();
+        return errors;
+    }
+
+    const auto& stats = interpreter.lastStats();
+    const bool full = result.fromCache || stats.full;
+    const bool keyboardChanged = full || stats.keyboardChanged;
+    const bool trackpadChanged = full || stats.trackpadChanged;
+    if (result.fromCache) {
+        debug("config loaded from cache in {:.2f} ms", static_cast<double>(loadNs) / 1e6);
+    } else if (stats.full) {
+        debug("config loaded in {:.2f} ms, {} statements", static_cast<double>(loadNs) / 1e6, stats.statements);
+    } else {
+        // the interpreting is what scales with the edit; per statement it shows whether one edit got slower
+        debug("config reloaded in {:.2f} ms, {} of {} statements re-interpreted in {:.2f} ms ({:.1f} us per changed statement)",
+            static_cast<double>(loadNs) / 1e6, stats.reinterpreted, stats.statements, static_cast<double>(stats.interpretNs) / 1e6,
+            static_cast<double>(stats.interpretNs) / 1e3 / static_cast<double>(std::max<size_t>(stats.reinterpreted, 1)));
+    }
+    if (!keyboardChanged && !trackpadChanged) {
+        debug("bindings unchanged, keeping engine and touch state");
+        return errors;
     }
 
     const bool hasFingerBinding = std::ranges::any_of(result.bindings, [](const Binding& b) {
         return std::ranges::any_of(b.source.chords, [](const Chord& c) { return c.fingerCount.has_value(); });
     });
-    const bool needsTouch = hasFingerBinding || !result.tapBindings.empty();
-    touch::setTapConfig(result.config.cornerSize, static_cast<int>(result.config.tapTimeout.count()));
-    engine.applyConfig(std::move(result.bindings), std::move(result.tapBindings), std::move(result.config));
+    const bool needsTouch = hasFingerBinding || !result.tapBindings.empty() || !result.gestureBindings.empty() || !result.pressBindings.empty();
+    // re-registering the callbacks drops in-flight gesture and press detection, so only on a trackpad change
+    if (trackpadChanged) {
+        touch::setTapConfig(result.config.cornerSize, static_cast<int>(result.config.tapTimeout.count()), result.tapRegions);
+        if (result.gestureBindings.empty()) {
+            touch::setGestureCallback(nullptr);
+        } else {
+            touch::setGestureCallback([this](Gesture gesture) {
+                const ModifierFlags mods = eventModifierFlagsToHotkeyFlags(CGEventSourceFlagsState(kCGEventSourceStateCombinedSessionState));
+                (void)engine.handleGesture(gesture, mods);
+            });
+        }
+        touch::setPressThreshold(result.config.pressThreshold);
+        if (result.pressBindings.empty()) {
+            touch::setPressCallback(nullptr);
+        } else {
+            touch::setPressCallback([this](Press press) {
+                const ModifierFlags mods = eventModifierFlagsToHotkeyFlags(CGEventSourceFlagsState(kCGEventSourceStateCombinedSessionState));
+                (void)engine.handlePress(press, mods);
+            });
+        }
+    }
+    if (keyboardChanged) {
+        engine.applyConfig(std::move(result.bindings), std::move(result.tapBindings), std::move(result.config),
+            std::move(result.gestureBindings), std::move(result.pressBindings));
+    } else {
+        engine.applyTrackpadBindings(std::move(result.tapBindings), std::move(result.gestureBindings), std::move(result.pressBindings));
+    }
     if (needsTouch) {
         touch::start();
     } else {
         touch::stop();
     }
+    return errors;
+}
+
+bool KeyHandler::trigger(const Chord& chord) {
+    const int fingers = touch::fingerCount();
+    const bool down = engine.handleEvent(chord, kCGEventKeyDown, false, fingers);
+    const bool up = engine.handleEvent(chord, kCGEventKeyUp, false, fingers);
+    return down || up;
+}
+
+KeyHandler::Status KeyHandler::status() const {
+    return {
+        .configFile = configFile,
+        .bindings = engine.bindingCount(),
+        .trackpadBindings = engine.trackpadBindingCount(),
+        .passthrough = passthrough,
+    };
 }
@@ -5,8 +5,13 @@
 #include <atomic>
 #include <cstdint>
 #include <filesystem>
+#include <span>
+#include <string>
 #include <thread>
+#include <vector>
 
+#include "../lang/interpreter.hpp"
+#include "flight_recorder.hpp"
 #include "hotkey_engine.hpp"
 #include "safety_monitor.hpp"
 
@@ -17,8 +22,12 @@ class KeyHandler {
     CFRunLoopRef runLoop{};
     CFMachPortRef eventTap{};
     HotkeyEngine engine;
+    // keeps per-statement results between loads, so a reload re-interprets only what changed
+    IncrementalInterpreter interpreter;
 
     SafetyMonitor safety;
+    // dumped before each _exit(1), so a lockout can be diagnosed after the restart
+    FlightRecorder recorder;
 
     // watchdog: an independent thread that force-disables the tap if a callback
     // runs too long, so a true deadlock in the run loop can never lock out input
@@ -31,18 +40,24 @@ class KeyHandler {
 
     // set when a corner-tap click's down is suppressed, so its up is suppressed too
     bool suppressNextMouseUp{false};
+    // every key event passes through untouched; the exit hotkey still works
+    bool passthrough{false};
+    // the engine binding the last key event ran, for the flight recorder
+    int lastBinding{-1};
 
     bool setupEventTap();
     void startWatchdog();
     void watchdogLoop();
     [[nodiscard]] static CGEventRef eventCallback(CGEventTapProxy proxy, CGEventType type, CGEventRef event, void* refcon);
-    [[nodiscard]] bool handleKeyEvent(CGEventRef event, CGEventType type);
+    // eventNs is the event's timestamp on the TimeSource clock
+    [[nodiscard]] EventDecision handleKeyEvent(CGEventRef event, CGEventType type, int64_t eventNs);
     [[nodiscard]] CGEventRef handleMouseEvent(CGEventType type, CGEventRef event);
-    void loadConfig(const std::filesystem::path& configFile);
+    // the config's errors, logged; with any, the previous config stays
+    std::vector<std::string> loadConfig(const std::filesystem::path& configFile);
 
    public:
     explicit KeyHandler(std::filesystem::path configFile) : configFile(std::move(configFile)) {
-        loadConfig(this->configFile);
+        (void)loadConfig(this->configFile);
     }
 
     ~KeyHandler();
@@ -54,8 +69,20 @@ class KeyHandler {
     bool init();
     void run() const;
 
-    void reload() {
-        engine.reset();
-        loadConfig(configFile);
-    }
+    // leaves engine and touch state alone for the parts of the config that didn't change
+    std::vector<std::string> reload() { return loadConfig(configFile); }
+
+    // runs the binding for a chord as a press and release would; whether one matched
+    bool trigger(const Chord& chord);
+    // a press and release of each, queued on the engine's output thread
+    void pressKeys(std::span<const Chord> chords) { engine.synthesizeKeyPresses(chords); }
+    void setPassthrough(bool enabled) { passthrough = enabled; }
+
+    struct Status {
+        std::filesystem::path configFile;
+        size_t bindings;
+        size_t trackpadBindings;
+        bool passthrough;
+    };
+    [[nodiscard]] Status status() const;
 };
@@ -0,0 +1,146 @@
+#include "metrics.hpp"
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <format>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+
+#include "../common/log.hpp"
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+// a scraper that connects and stalls holds up the next scrape by at most this
+constexpr timeval kClientTimeout{.tv_sec = 1, .tv_usec = 0};
+
+void sendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t n = send(fd, data.data(), data.size(), kSendFlags);
+        if (n <= 0) return;
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+}
+
+}  // namespace
+
+std::string formatPrometheus(const RuntimeStats& stats) {
+    std::string out;
+    for (const auto& counter : kCounters) {
+        std::format_to(std::back_inserter(out), "# HELP smhkd_{0}_total {1}\n# TYPE smhkd_{0}_total counter\nsmhkd_{0}_total {2}\n",
+            counter.name, counter.help, (stats.*counter.counter).load(std::memory_order_relaxed));
+    }
+    for (const auto& info : kHistograms) {
+        const auto& histogram = stats.*info.histogram;
+        const auto buckets = histogram.buckets();
+        std::format_to(std::back_inserter(out), "# HELP smhkd_{0}_seconds {1}\n# TYPE smhkd_{0}_seconds histogram\n", info.name, info.help);
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < LatencyHistogram::kBoundsNs.size(); i++) {
+            cumulative += buckets.at(i);
+            std::format_to(std::back_inserter(out), "smhkd_{}_seconds_bucket{{le=\"{}\"}} {}\n", info.name,
+                static_cast<double>(LatencyHistogram::kBoundsNs.at(i)) / 1e9, cumulative);
+        }
+        cumulative += buckets.back();
+        std::format_to(std::back_inserter(out), "smhkd_{0}_seconds_bucket{{le=\"+Inf\"}} {1}\nsmhkd_{0}_seconds_sum {2}\nsmhkd_{0}_seconds_count {1}\n",
+            info.name, cumulative, static_cast<double>(histogram.sumNs()) / 1e9);
+    }
+    return out;
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start() {
+    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd_ == -1) {
+        warn("failed to create metrics socket: {}", std::generic_category().message(errno));
+        return false;
+    }
+    const int on = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port_);
+    // loopback only: the counters say when keys are pressed
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listenFd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        || listen(listenFd_, 8) == -1 || pipe(wakePipe_.data()) == -1) {
+        warn("failed to serve metrics on 127.0.0.1:{}: {}", port_, std::generic_category().message(errno));
+        stop();
+        return false;
+    }
+    thread_ = std::thread(&MetricsServer::run, this);
+    info("serving metrics on http://127.0.0.1:{}/metrics", port_);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (thread_.joinable()) {
+        const char byte = '\n';
+        const ssize_t result = write(wakePipe_[1], &byte, sizeof(byte));
+        (void)result;
+        thread_.join();
+    }
+    for (int* fd : {&listenFd_, &wakePipe_[0], &wakePipe_[1]}) {
+        if (*fd != -1) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void MetricsServer::run() {
+    std::array<pollfd, 2> fds{{
+        {.fd = listenFd_, .events = POLLIN, .revents = 0},
+        {.fd = wakePipe_[0], .events = POLLIN, .revents = 0},
+    }};
+    while (true) {
+        if (poll(fds.data(), fds.size(), -1) == -1) {
+            if (errno == EINTR) continue;
+            warn("metrics server stopped: {}", std::generic_category().message(errno));
+            return;
+        }
+        if (fds[1].revents != 0) return;
+        const int client = accept(listenFd_, nullptr, nullptr);
+        if (client == -1) continue;
+#ifdef SO_NOSIGPIPE
+        const int on = 1;
+        setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &kClientTimeout, sizeof(kClientTimeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &kClientTimeout, sizeof(kClientTimeout));
+        serve(client);
+        close(client);
+    }
+}
+
+void MetricsServer::serve(int client) const {
+    // only the request line matters; headers are read up to the blank line and ignored
+    std::string request;
+    std::array<char, 1024> buffer{};
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        const ssize_t n = recv(client, buffer.data(), buffer.size(), 0);
+        if (n <= 0) break;
+        request.append(buffer.data(), static_cast<size_t>(n));
+    }
+    const std::string_view line = std::string_view{request}.substr(0, request.find("\r\n"));
+    if (!line.starts_with("GET /metrics ") && !line.starts_with("GET / ")) {
+        sendAll(client, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        return;
+    }
+    const auto body = formatPrometheus(runtimeStats());
+    sendAll(client, std::format("HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: {}\r\nConnection: close\r\n\r\n", body.size()));
+    sendAll(client, body);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "stats.hpp"
+
+// the runtime counters and latency histograms in the Prometheus text exposition format,
+// each metric prefixed "smhkd_"; counters get "_total", histograms are in seconds
+[[nodiscard]] std::string formatPrometheus(const RuntimeStats& stats);
+
+// serves formatPrometheus over HTTP on 127.0.0.1 from its own thread. a scrape only reads
+// the relaxed atomics, so it never contends with the event tap thread
+class MetricsServer {
+   public:
+    explicit MetricsServer(uint16_t port) : port_(port) {}
+    ~MetricsServer();
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+    MetricsServer(MetricsServer&&) = delete;
+    MetricsServer& operator=(MetricsServer&&) = delete;
+
+    bool start();
+    void stop();
+
+   private:
+    uint16_t port_;
+    int listenFd_{-1};
+    // written to by stop() to wake the thread
+    std::array<int, 2> wakePipe_ = {-1, -1};
+    std::thread thread_;
+
+    void run();
+    void serve(int client) const;
+};
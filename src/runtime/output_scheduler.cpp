@@ -0,0 +1,131 @@
+#include "output_scheduler.hpp"
+
+#include <utility>
+
+#include "stats.hpp"
+
+namespace {
+
+// runs the ring holds before it first has to grow
+constexpr size_t kInitialRuns = 16;
+
+}  // namespace
+
+OutputScheduler::OutputScheduler(Post post, std::chrono::microseconds pressGap)
+    : post_(std::move(post)), pressGap_(pressGap), runs_(kInitialRuns) {}
+
+OutputScheduler::~OutputScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void OutputScheduler::enqueue(std::shared_ptr<const EventProgram> program, std::chrono::microseconds burstGap) {
+    if (!program || program->events.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        push({.program = std::move(program), .inlineEvents = {}, .inlineCount = 0, .burstGap = burstGap});
+    }
+    changed_.notify_all();
+}
+
+void OutputScheduler::enqueuePress(const Chord& target) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        push({
+            .program = nullptr,
+            .inlineEvents = {keyEventFor(target, true, KeyEvent::Pause::Press), keyEventFor(target, false, KeyEvent::Pause::Press)},
+            .inlineCount = 2,
+            .burstGap = {},
+        });
+    }
+    changed_.notify_all();
+}
+
+void OutputScheduler::enqueueEvent(const Chord& target, bool keyDown) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        push({
+            .program = nullptr,
+            .inlineEvents = {keyEventFor(target, keyDown, KeyEvent::Pause::None)},
+            .inlineCount = 1,
+            .burstGap = {},
+        });
+    }
+    changed_.notify_all();
+}
+
+void OutputScheduler::enqueuePresses(std::span<const Chord> targets) {
+    auto program = std::make_shared<EventProgram>();
+    program->events.reserve(targets.size() * 2);
+    for (const auto& target : targets) {
+        program->events.push_back(keyEventFor(target, true, KeyEvent::Pause::Press));
+        program->events.push_back(keyEventFor(target, false, KeyEvent::Pause::Press));
+    }
+    enqueue(std::move(program));
+}
+
+void OutputScheduler::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [&] { return count_ == 0; });
+}
+
+size_t OutputScheduler::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t events = 0;
+    for (size_t i = 0; i < count_; i++) events += runs_[(head_ + i) % runs_.size()].events().size();
+    return count_ > 0 ? events - next_ : 0;
+}
+
+void OutputScheduler::push(Run run) {
+    if (count_ == runs_.size()) {
+        std::vector<Run> grown(runs_.size() * 2);
+        for (size_t i = 0; i < count_; i++) grown[i] = std::move(runs_[(head_ + i) % runs_.size()]);
+        runs_ = std::move(grown);
+        head_ = 0;
+    }
+    runs_[(head_ + count_) % runs_.size()] = std::move(run);
+    count_++;
+    if (!thread_.joinable()) thread_ = std::thread(&OutputScheduler::run, this);
+}
+
+std::chrono::microseconds OutputScheduler::pauseBefore(const KeyEvent& event, const Run& run) const {
+    switch (event.pause) {
+        case KeyEvent::Pause::None: return {};
+        case KeyEvent::Pause::Press: return pressGap_;
+        case KeyEvent::Pause::Burst: return run.burstGap;
+    }
+    return {};
+}
+
+void OutputScheduler::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        changed_.wait(lock, [&] { return stopping_ || count_ > 0; });
+        if (count_ == 0) return;
+        const KeyEvent event = runs_[head_].events()[next_];
+        // new runs only ever go behind this one, so nothing but stop can make the wait shorter
+        const auto due = lastPosted_ + pauseBefore(event, runs_[head_]);
+        if (!stopping_ && clock::now() < due) {
+            changed_.wait_until(lock, due, [&] { return stopping_; });
+            continue;
+        }
+        // the ring can grow while unlocked and move the run, but not the program it points at
+        const std::shared_ptr<const EventProgram> program = runs_[head_].program;
+        lock.unlock();
+        post_(event, program ? program->textOf(event) : std::u16string_view{});
+        bump(runtimeStats().keysSynthesized);
+        lock.lock();
+        lastPosted_ = clock::now();
+        if (++next_ == runs_[head_].events().size()) {
+            runs_[head_] = Run{};
+            head_ = (head_ + 1) % runs_.size();
+            count_--;
+            next_ = 0;
+        }
+        changed_.notify_all();
+    }
+}
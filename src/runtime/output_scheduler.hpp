@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../input/chord.hpp"
+#include "../input/event_program.hpp"
+
+// posts synthetic key events on its own thread, so whoever asks for a press or a macro returns at
+// once instead of sleeping between the down and the up on an input thread.
+//
+// one FIFO for everything: a run of events is queued whole behind the ones before it, so runs
+// never interleave and each key's up stays behind its down. each event waits its pause after the
+// one posted before it, measured from when that one was actually posted. a compiled program is
+// queued by reference, so queueing one copies a pointer and allocates nothing once the ring of
+// runs has grown to the most ever waiting
+class OutputScheduler {
+   public:
+    // posts one event, with its unicode string when it has one; only ever called from the scheduler's thread
+    using Post = std::function<void(const KeyEvent& event, std::u16string_view text)>;
+
+    // between each event of a press: long enough for apps that poll key state to see the key down
+    static constexpr auto kPressGap = std::chrono::milliseconds(3);
+
+    explicit OutputScheduler(Post post, std::chrono::microseconds pressGap = kPressGap);
+    // posts anything still queued without the pauses, so no key is left held down
+    ~OutputScheduler();
+    OutputScheduler(const OutputScheduler&) = delete;
+    OutputScheduler& operator=(const OutputScheduler&) = delete;
+    OutputScheduler(OutputScheduler&&) = delete;
+    OutputScheduler& operator=(OutputScheduler&&) = delete;
+
+    // the program's events in order, Burst pauses waiting burstGap. the thread starts with the first run
+    void enqueue(std::shared_ptr<const EventProgram> program, std::chrono::microseconds burstGap = {});
+    // a press and release of target
+    void enqueuePress(const Chord& target);
+    // a single event, with no pause before it
+    void enqueueEvent(const Chord& target, bool keyDown);
+    // a press and release of each target in turn, compiled into a program here
+    void enqueuePresses(std::span<const Chord> targets);
+    // blocks until everything queued so far has been posted
+    void drain();
+    // events queued and not yet posted
+    [[nodiscard]] size_t pending() const;
+
+   private:
+    using clock = std::chrono::steady_clock;
+
+    // a program, or the event or two of a press held inline
+    struct Run {
+        std::shared_ptr<const EventProgram> program;
+        std::array<KeyEvent, 2> inlineEvents{};
+        uint8_t inlineCount{};
+        std::chrono::microseconds burstGap{};
+
+        [[nodiscard]] std::span<const KeyEvent> events() const {
+            if (program) return program->events;
+            return {inlineEvents.data(), inlineCount};
+        }
+    };
+
+    Post post_;
+    std::chrono::microseconds pressGap_;
+    mutable std::mutex mutex_;
+    // wakes the thread for new runs and stop, and drain() after each post
+    std::condition_variable changed_;
+    // a ring of runs, doubled when full. the front run stays in it until its last event is out
+    std::vector<Run> runs_;
+    size_t head_{};
+    size_t count_{};
+    // the front run's next event
+    size_t next_{};
+    bool stopping_{false};
+    clock::time_point lastPosted_{};
+    std::thread thread_;
+
+    // with mutex_ held
+    void push(Run run);
+    [[nodiscard]] std::chrono::microseconds pauseBefore(const KeyEvent& event, const Run& run) const;
+    void run();
+};
@@ -0,0 +1,23 @@
+#include "press_detector.hpp"
+
+#include <algorithm>
+
+std::optional<Press> PressDetector::onFrame(const std::vector<Touch>& touches) {
+    float peak = 0.0F;
+    for (const auto& t : touches) {
+        peak = std::max(peak, t.pressure);
+    }
+
+    if (pressed_) {
+        if (touches.empty() || peak < config_.releaseThreshold) pressed_ = false;
+        return std::nullopt;
+    }
+    if (touches.empty() || peak < config_.pressThreshold) return std::nullopt;
+
+    pressed_ = true;
+    Press press{.zone = std::nullopt, .fingers = static_cast<int>(touches.size())};
+    if (touches.size() == 1) {
+        press.zone = classifyZone(config_.zones.get(), touches[0].x, touches[0].y, config_.cornerSizePct);
+    }
+    return press;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "../input/press.hpp"
+#include "../input/zone.hpp"
+#include "tap_detector.hpp"
+
+// pure force-press detector, fed one frame of touches at a time
+// a press fires once when the hardest finger's pressure rises to pressThreshold and
+// re-arms only after it falls below releaseThreshold (or every finger lifts), so a
+// press that hovers around the threshold does not retrigger. state is two scalars,
+// so a frame costs one pass over the touches and never allocates
+class PressDetector {
+   public:
+    // releaseThreshold as a fraction of pressThreshold, unless configured otherwise
+    static constexpr float kReleaseRatio = 0.6F;
+
+    struct Config {
+        // raw MultitouchSupport pressure units
+        float pressThreshold = 180.0F;
+        float releaseThreshold = 180.0F * kReleaseRatio;
+        int cornerSizePct = 15;
+        std::shared_ptr<const ZoneMap> zones;
+    };
+
+    void setConfig(Config config) { config_ = std::move(config); }
+
+    std::optional<Press> onFrame(const std::vector<Touch>& touches);
+    void reset() { pressed_ = false; }
+
+   private:
+    Config config_;
+    bool pressed_{};
+};
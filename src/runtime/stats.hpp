@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+// a latency distribution in fixed buckets, recorded with relaxed atomics: a few adds per sample
+class LatencyHistogram {
+   public:
+    // upper bounds, in nanoseconds; samples above the last land in the +Inf bucket
+    static constexpr std::array<int64_t, 12> kBoundsNs{
+        1'000, 5'000, 10'000, 25'000, 50'000, 100'000, 250'000, 500'000, 1'000'000, 5'000'000, 25'000'000, 100'000'000};
+
+    void record(int64_t ns) {
+        size_t bucket = 0;
+        while (bucket < kBoundsNs.size() && ns > kBoundsNs.at(bucket)) bucket++;
+        buckets_.at(bucket).fetch_add(1, std::memory_order_relaxed);
+        sumNs_.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    // samples in each bucket, not cumulative; the last is +Inf
+    [[nodiscard]] std::array<uint64_t, kBoundsNs.size() + 1> buckets() const {
+        std::array<uint64_t, kBoundsNs.size() + 1> out{};
+        for (size_t i = 0; i < out.size(); i++) out.at(i) = buckets_.at(i).load(std::memory_order_relaxed);
+        return out;
+    }
+    [[nodiscard]] int64_t sumNs() const { return sumNs_.load(std::memory_order_relaxed); }
+
+   private:
+    std::array<std::atomic<uint64_t>, kBoundsNs.size() + 1> buckets_{};
+    std::atomic<int64_t> sumNs_{};
+};
+
+// process-wide counters. bumped with relaxed atomics from the event tap and touch threads,
+// so reading them (the control socket's stats command, a metrics scrape) never takes a lock they use
+struct RuntimeStats {
+    // key events that reached the engine (synthetic remap events excluded)
+    std::atomic<uint64_t> keyEvents{};
+    std::atomic<uint64_t> consumedEvents{};
+    // hotkeys, remaps and completed sequences
+    std::atomic<uint64_t> bindingsMatched{};
+    // remaps applied to the event in place, and those posted as a new event (media keys, trigger,
+    // behind queued output)
+    std::atomic<uint64_t> remapsRewritten{};
+    std::atomic<uint64_t> remapsPosted{};
+    // events the output scheduler posted: synthesized presses, macros and posted remaps
+    std::atomic<uint64_t> keysSynthesized{};
+    std::atomic<uint64_t> commandsRun{};
+    // commands the background queue has picked up; commandsRun minus this is the queue depth
+    std::atomic<uint64_t> commandsDequeued{};
+    // fork failures; a failed exec happens in the child, which can't report back
+    std::atomic<uint64_t> commandsFailed{};
+    std::atomic<uint64_t> safetyTrips{};
+    // event tap timeouts recovered by re-enabling the tap, short of a trip
+    std::atomic<uint64_t> safetyNearTrips{};
+    std::atomic<uint64_t> watchdogSoftDisables{};
+    std::atomic<uint64_t> tapsDetected{};
+    std::atomic<uint64_t> gesturesDetected{};
+    std::atomic<uint64_t> pressesDetected{};
+    std::atomic<uint64_t> reloads{};
+    // reloads rejected for config errors, keeping the previous config
+    std::atomic<uint64_t> reloadsFailed{};
+
+    // the signposted stages: the whole event tap callback, the engine's part of it, and
+    // the front app lookup a blacklist needs
+    LatencyHistogram eventCallback;
+    LatencyHistogram handleEvent;
+    LatencyHistogram frontProcessLookup;
+    LatencyHistogram configLoad;
+};
+
+inline RuntimeStats& runtimeStats() {
+    static RuntimeStats stats;
+    return stats;
+}
+
+inline void bump(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+    counter.fetch_add(n, std::memory_order_relaxed);
+}
+
+struct CounterInfo {
+    std::string_view name;
+    std::string_view help;
+    std::atomic<uint64_t> RuntimeStats::* counter;
+};
+
+inline constexpr std::array kCounters{
+    CounterInfo{"key_events", "Key events seen by the engine", &RuntimeStats::keyEvents},
+    CounterInfo{"consumed_events", "Key events consumed", &RuntimeStats::consumedEvents},
+    CounterInfo{"bindings_matched", "Hotkeys, remaps and sequences matched", &RuntimeStats::bindingsMatched},
+    CounterInfo{"remaps_rewritten", "Remapped key events rewritten in place", &RuntimeStats::remapsRewritten},
+    CounterInfo{"remaps_posted", "Remap key events posted as new events", &RuntimeStats::remapsPosted},
+    CounterInfo{"keys_synthesized", "Synthetic key events posted by the output scheduler", &RuntimeStats::keysSynthesized},
+    CounterInfo{"commands_run", "Commands spawned", &RuntimeStats::commandsRun},
+    CounterInfo{"commands_dequeued", "Commands picked up by the background queue", &RuntimeStats::commandsDequeued},
+    CounterInfo{"commands_failed", "Commands that failed to fork", &RuntimeStats::commandsFailed},
+    CounterInfo{"safety_trips", "Safety monitor trips", &RuntimeStats::safetyTrips},
+    CounterInfo{"safety_near_trips", "Event tap timeouts recovered without a trip", &RuntimeStats::safetyNearTrips},
+    CounterInfo{"watchdog_soft_disables", "Event tap soft disables by the watchdog", &RuntimeStats::watchdogSoftDisables},
+    CounterInfo{"taps_detected", "Trackpad corner and region taps detected", &RuntimeStats::tapsDetected},
+    CounterInfo{"gestures_detected", "Trackpad gestures detected", &RuntimeStats::gesturesDetected},
+    CounterInfo{"presses_detected", "Trackpad force presses detected", &RuntimeStats::pressesDetected},
+    CounterInfo{"reloads", "Config loads", &RuntimeStats::reloads},
+    CounterInfo{"reloads_failed", "Config loads rejected for errors", &RuntimeStats::reloadsFailed},
+};
+
+struct HistogramInfo {
+    std::string_view name;
+    std::string_view help;
+    LatencyHistogram RuntimeStats::* histogram;
+};
+
+inline constexpr std::array kHistograms{
+    HistogramInfo{"event_callback", "Event tap callback duration", &RuntimeStats::eventCallback},
+    HistogramInfo{"handle_event", "Hotkey engine matching duration", &RuntimeStats::handleEvent},
+    HistogramInfo{"front_process_lookup", "Front app lookup duration for the blacklist", &RuntimeStats::frontProcessLookup},
+    HistogramInfo{"config_load", "Config load duration", &RuntimeStats::configLoad},
+};
+
+// every counter by name, read once each, for the control socket's stats command
+inline std::array<std::pair<std::string_view, uint64_t>, kCounters.size()> snapshot(const RuntimeStats& stats) {
+    std::array<std::pair<std::string_view, uint64_t>, kCounters.size()> out{};
+    for (size_t i = 0; i < kCounters.size(); i++) {
+        out.at(i) = {kCounters.at(i).name, (stats.*kCounters.at(i).counter).load(std::memory_order_relaxed)};
+    }
+    return out;
+}
@@ -2,6 +2,10 @@
 
 #include <unordered_set>
 
+std::optional<Zone> TapDetector::classify(const Config& config, float x, float y) {
+    return classifyZone(config.zones.get(), x, y, config.cornerSizePct);
+}
+
 std::optional<Zone> TapDetector::onFrame(const std::vector<Touch>& touches, int64_t nowNs) {
     std::unordered_set<int> current;
     current.reserve(touches.size());
@@ -30,13 +34,13 @@ std::optional<Zone> TapDetector::onFrame(const std::vector<Touch>& touches, int6
         Active& a = it->second;
         if (inserted) {
             a.downNs = nowNs;
-            a.startZone = classifyZone(t.x, t.y, config_.cornerSizePct);
+            a.startZone = classify(config_, t.x, t.y);
             a.valid = a.startZone.has_value();
         }
         if (multi) {
             a.valid = false;
         }
-        if (classifyZone(t.x, t.y, config_.cornerSizePct) != a.startZone) {
+        if (classify(config_, t.x, t.y) != a.startZone) {
             a.valid = false;
         }
     }
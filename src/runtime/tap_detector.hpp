@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <unordered_map>
 #include <vector>
@@ -11,19 +12,24 @@ struct Touch {
     int id;
     float x;
     float y;
+    float pressure{};
 };
 
-// pure single-finger corner-tap detector, fed one frame of touches at a time
-// a tap = one finger down and up within tapTimeoutMs, staying in the same corner,
+// pure single-finger zone-tap detector, fed one frame of touches at a time
+// a tap = one finger down and up within tapTimeoutMs, staying in the same zone,
 // single-finger throughout
 class TapDetector {
    public:
     struct Config {
         int cornerSizePct = 15;
         int tapTimeoutMs = 300;
+        // zones from the loaded config; without one, only the four corners are classified
+        std::shared_ptr<const ZoneMap> zones;
     };
 
-    void setConfig(Config config) { config_ = config; }
+    void setConfig(Config config) { config_ = std::move(config); }
+
+    [[nodiscard]] static std::optional<Zone> classify(const Config& config, float x, float y);
 
     std::optional<Zone> onFrame(const std::vector<Touch>& touches, int64_t nowNs);
     void reset();
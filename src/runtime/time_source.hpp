@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// the event pipeline's monotonic clock, in nanoseconds on the steady clock's epoch: uptime on
+// darwin, the base CGEvent and MultitouchSupport timestamps count from too. code handling an
+// event takes the time from the event itself; nowNs() is for when there is no event at hand.
+// tests, replay and benchmarks inject a ManualTimeSource and run in simulated time
+class TimeSource {
+   public:
+    TimeSource() = default;
+    virtual ~TimeSource() = default;
+    TimeSource(const TimeSource&) = delete;
+    TimeSource& operator=(const TimeSource&) = delete;
+    TimeSource(TimeSource&&) = delete;
+    TimeSource& operator=(TimeSource&&) = delete;
+
+    [[nodiscard]] virtual int64_t nowNs() const = 0;
+};
+
+class SteadyTimeSource final : public TimeSource {
+   public:
+    [[nodiscard]] int64_t nowNs() const override {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+// moves only when told to
+class ManualTimeSource final : public TimeSource {
+   public:
+    explicit ManualTimeSource(int64_t startNs = 0) : nowNs_(startNs) {}
+
+    [[nodiscard]] int64_t nowNs() const override { return nowNs_.load(std::memory_order_relaxed); }
+    void set(int64_t ns) { nowNs_.store(ns, std::memory_order_relaxed); }
+    void advance(std::chrono::nanoseconds by) { nowNs_.fetch_add(by.count(), std::memory_order_relaxed); }
+
+   private:
+    std::atomic<int64_t> nowNs_;
+};
+
+inline const TimeSource& steadyTimeSource() {
+    static const SteadyTimeSource source;
+    return source;
+}
@@ -5,25 +5,24 @@
 #include <unistd.h>
 
 #include <atomic>
-#include <chrono>
 #include <cstdio>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <unordered_map>
 #include <vector>
 
+#include "gesture_detector.hpp"
 #include "multitouch_support.hpp"
+#include "press_detector.hpp"
+#include "stats.hpp"
 #include "tap_detector.hpp"
+#include "time_source.hpp"
+#include "touch_recording.hpp"
 
 namespace {
 
-int64_t nowNs() {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::steady_clock::now().time_since_epoch())
-        .count();
-}
-
 std::atomic<int> g_totalFingers{0};
 
 // guards state shared between the MultitouchSupport callback thread and the run loop
@@ -32,6 +31,18 @@ std::unordered_map<int, int> g_perDevice;
 std::unordered_map<int, TapDetector> g_detectors;
 TapDetector::Config g_tapConfig;
 std::function<void(Zone)> g_tapCallback;
+std::unordered_map<int, GestureDetector> g_gestureDetectors;
+GestureDetector::Config g_gestureConfig;
+std::function<void(Gesture)> g_gestureCallback;
+std::unordered_map<int, PressDetector> g_pressDetectors;
+PressDetector::Config g_pressConfig;
+std::function<void(Press)> g_pressCallback;
+// reused every frame so the callback thread does not allocate once warmed up
+std::vector<Touch> g_touches;
+TouchRecorder* g_recorder = nullptr;
+// for frames that arrive without a timestamp
+const TimeSource* g_time = &steadyTimeSource();
+RecordedFrame g_recordedFrame{};
 
 // most recent single-finger corner contact, read from the event tap for suppression
 std::atomic<int> g_lastCornerZone{-1};
@@ -40,11 +51,34 @@ std::atomic<int64_t> g_lastCornerNs{0};
 CFMutableArrayRef g_deviceList = nullptr;
 bool g_started = false;
 
-int contactCallback(int device, Finger* fingers, int nFingers, double /*timestamp*/, int /*frame*/) {
+void recordFrame(int device, const Finger* fingers, int nFingers, double timestamp, int frame) {
+    g_recordedFrame.device = device;
+    g_recordedFrame.frame = frame;
+    g_recordedFrame.timestamp = timestamp;
+    g_recordedFrame.fingers.clear();
+    for (int i = 0; i < nFingers; i++) {
+        const Finger& f = fingers[i];
+        g_recordedFrame.fingers.push_back({
+            .id = f.identifier,
+            .x = f.normalized.position.x,
+            .y = f.normalized.position.y,
+            .vx = f.normalized.velocity.x,
+            .vy = f.normalized.velocity.y,
+            .pressure = static_cast<float>(f.pressure),
+            .size = f.size,
+        });
+    }
+    g_recorder->record(g_recordedFrame);
+}
+
+int contactCallback(int device, Finger* fingers, int nFingers, double timestamp, int frame) {
     std::lock_guard<std::mutex> lock(g_touchMtx);
     if (!g_started) return 0;
 
-    const int64_t now = nowNs();
+    if (g_recorder) recordFrame(device, fingers, nFingers, timestamp, frame);
+
+    // MultitouchSupport stamps frames in seconds of uptime, the TimeSource clock's base
+    const int64_t now = timestamp > 0 ? static_cast<int64_t>(timestamp * 1e9) : g_time->nowNs();
 
     g_perDevice[device] = nFingers;
     int total = 0;
@@ -53,26 +87,46 @@ int contactCallback(int device, Finger* fingers, int nFingers, double /*timestam
     }
     g_totalFingers.store(total, std::memory_order_release);
 
-    std::vector<Touch> touches;
-    touches.reserve(static_cast<size_t>(nFingers));
+    std::vector<Touch>& touches = g_touches;
+    touches.clear();
     for (int i = 0; i < nFingers; i++) {
-        touches.push_back({fingers[i].identifier, fingers[i].normalized.position.x, fingers[i].normalized.position.y});
+        const Finger& f = fingers[i];
+        touches.push_back({f.identifier, f.normalized.position.x, f.normalized.position.y, static_cast<float>(f.pressure)});
     }
 
-    // recent corner contact (single finger only) for click suppression
+    // recent zone contact (single finger only) for click suppression
     if (nFingers == 1) {
-        if (auto zone = classifyZone(touches[0].x, touches[0].y, g_tapConfig.cornerSizePct)) {
+        if (auto zone = TapDetector::classify(g_tapConfig, touches[0].x, touches[0].y)) {
             g_lastCornerZone.store(static_cast<int>(*zone), std::memory_order_release);
             g_lastCornerNs.store(now, std::memory_order_release);
         }
     }
 
     // per-device detector so finger ids from different pads never collide
-    auto& detector = g_detectors[device];
-    detector.setConfig(g_tapConfig);
-    if (auto zone = detector.onFrame(touches, now)) {
+    auto [detector, inserted] = g_detectors.try_emplace(device);
+    if (inserted) detector->second.setConfig(g_tapConfig);
+    if (auto zone = detector->second.onFrame(touches, now)) {
+        bump(runtimeStats().tapsDetected);
         if (g_tapCallback) g_tapCallback(*zone);
     }
+
+    if (g_gestureCallback) {
+        auto [gestures, created] = g_gestureDetectors.try_emplace(device);
+        if (created) gestures->second.setConfig(g_gestureConfig);
+        if (auto gesture = gestures->second.onFrame(touches, now)) {
+            bump(runtimeStats().gesturesDetected);
+            g_gestureCallback(*gesture);
+        }
+    }
+
+    if (g_pressCallback) {
+        auto [presses, created] = g_pressDetectors.try_emplace(device);
+        if (created) presses->second.setConfig(g_pressConfig);
+        if (auto press = presses->second.onFrame(touches)) {
+            bump(runtimeStats().pressesDetected);
+            g_pressCallback(*press);
+        }
+    }
     return 0;
 }
 
@@ -131,6 +185,8 @@ void touch::stop() {
     g_deviceList = nullptr;
     g_perDevice.clear();
     g_detectors.clear();
+    g_gestureDetectors.clear();
+    g_pressDetectors.clear();
     g_lastCornerZone.store(-1, std::memory_order_release);
     g_totalFingers.store(0, std::memory_order_release);
     g_started = false;
@@ -140,9 +196,24 @@ int touch::fingerCount() {
     return g_totalFingers.load(std::memory_order_acquire);
 }
 
-void touch::setTapConfig(int cornerSizePct, int tapTimeoutMs) {
+void touch::setTapConfig(int cornerSizePct, int tapTimeoutMs, const std::vector<TapRegion>& regions) {
+    // rasterize outside the lock; the callback thread only ever sees a finished map
+    auto zones = regions.empty() ? nullptr : std::make_shared<const ZoneMap>(regions);
+
     std::lock_guard<std::mutex> lock(g_touchMtx);
-    g_tapConfig = {.cornerSizePct = cornerSizePct, .tapTimeoutMs = tapTimeoutMs};
+    g_tapConfig = {.cornerSizePct = cornerSizePct, .tapTimeoutMs = tapTimeoutMs, .zones = std::move(zones)};
+    g_gestureConfig.tapTimeoutMs = tapTimeoutMs;
+    g_pressConfig.cornerSizePct = cornerSizePct;
+    g_pressConfig.zones = g_tapConfig.zones;
+    for (auto& [device, detector] : g_detectors) {
+        detector.setConfig(g_tapConfig);
+    }
+    for (auto& [device, detector] : g_gestureDetectors) {
+        detector.setConfig(g_gestureConfig);
+    }
+    for (auto& [device, detector] : g_pressDetectors) {
+        detector.setConfig(g_pressConfig);
+    }
 }
 
 void touch::setTapCallback(std::function<void(Zone)> callback) {
@@ -150,10 +221,41 @@ void touch::setTapCallback(std::function<void(Zone)> callback) {
     g_tapCallback = std::move(callback);
 }
 
-std::optional<Zone> touch::recentCornerZone(int64_t maxAgeNs) {
+void touch::setGestureCallback(std::function<void(Gesture)> callback) {
+    std::lock_guard<std::mutex> lock(g_touchMtx);
+    g_gestureCallback = std::move(callback);
+    g_gestureDetectors.clear();
+}
+
+void touch::setPressCallback(std::function<void(Press)> callback) {
+    std::lock_guard<std::mutex> lock(g_touchMtx);
+    g_pressCallback = std::move(callback);
+    g_pressDetectors.clear();
+}
+
+void touch::setPressThreshold(int threshold) {
+    std::lock_guard<std::mutex> lock(g_touchMtx);
+    g_pressConfig.pressThreshold = static_cast<float>(threshold);
+    g_pressConfig.releaseThreshold = static_cast<float>(threshold) * PressDetector::kReleaseRatio;
+    for (auto& [device, detector] : g_pressDetectors) {
+        detector.setConfig(g_pressConfig);
+    }
+}
+
+void touch::setRecorder(TouchRecorder* recorder) {
+    std::lock_guard<std::mutex> lock(g_touchMtx);
+    g_recorder = recorder;
+}
+
+void touch::setTimeSource(const TimeSource& time) {
+    std::lock_guard<std::mutex> lock(g_touchMtx);
+    g_time = &time;
+}
+
+std::optional<Zone> touch::recentCornerZone(int64_t maxAgeNs, int64_t nowNs) {
     const int zone = g_lastCornerZone.load(std::memory_order_acquire);
     if (zone < 0) return std::nullopt;
     const int64_t last = g_lastCornerNs.load(std::memory_order_acquire);
-    if (nowNs() - last > maxAgeNs) return std::nullopt;
+    if (nowNs - last > maxAgeNs) return std::nullopt;
     return static_cast<Zone>(zone);
 }
@@ -2,9 +2,15 @@
 
 #include <functional>
 #include <optional>
+#include <vector>
 
+#include "../input/gesture.hpp"
+#include "../input/press.hpp"
 #include "../input/zone.hpp"
 
+class TimeSource;
+class TouchRecorder;
+
 namespace touch {
 
 void start();
@@ -13,10 +19,25 @@ void stop();
 // live total fingers across all trackpads
 int fingerCount();
 
-void setTapConfig(int cornerSizePct, int tapTimeoutMs);
+// regions are the zones tap bindings use; when empty, taps classify into the four corners
+void setTapConfig(int cornerSizePct, int tapTimeoutMs, const std::vector<TapRegion>& regions = {});
 void setTapCallback(std::function<void(Zone)> callback);
+// gesture recognition only runs while a callback is set
+void setGestureCallback(std::function<void(Gesture)> callback);
+
+// press recognition only runs while a callback is set
+void setPressCallback(std::function<void(Press)> callback);
+// raw pressure a press must reach; it re-arms once pressure falls well below it
+void setPressThreshold(int threshold);
+
+// every raw frame is also written to the recorder while one is set. the recorder must
+// outlive its registration; pass nullptr to detach before destroying it
+void setRecorder(TouchRecorder* recorder);
+
+// the clock for frames that carry no timestamp; it must outlive its registration
+void setTimeSource(const TimeSource& time);
 
-// corner of a single-finger contact seen within maxAgeNs, for click suppression
-std::optional<Zone> recentCornerZone(int64_t maxAgeNs);
+// zone of a single-finger contact seen within maxAgeNs of nowNs (on the TimeSource clock), for click suppression
+std::optional<Zone> recentCornerZone(int64_t maxAgeNs, int64_t nowNs);
 
 }  // namespace touch
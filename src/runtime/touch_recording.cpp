@@ -0,0 +1,174 @@
+#include "touch_recording.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iterator>
+#include <numeric>
+#include <unordered_map>
+
+void touch_recording::encodeHeader(ByteWriter& out) {
+    out.putBytes(kMagic);
+    out.put<uint16_t>(kVersion);
+}
+
+void touch_recording::encodeFrame(ByteWriter& out, const RecordedFrame& frame) {
+    out.put<int32_t>(frame.device);
+    out.put<int32_t>(frame.frame);
+    out.put<double>(frame.timestamp);
+    out.put<uint16_t>(static_cast<uint16_t>(frame.fingers.size()));
+    for (const auto& f : frame.fingers) {
+        out.put<int32_t>(f.id);
+        out.put<float>(f.x);
+        out.put<float>(f.y);
+        out.put<float>(f.vx);
+        out.put<float>(f.vy);
+        out.put<float>(f.pressure);
+        out.put<float>(f.size);
+    }
+}
+
+TouchRecordingLoad decodeTouchRecording(std::string_view bytes) {
+    ByteReader in{bytes};
+    if (in.getBytes(touch_recording::kMagic.size()) != touch_recording::kMagic) {
+        return {.frames = {}, .error = "not a touch recording (bad magic)"};
+    }
+    const auto version = in.get<uint16_t>();
+    if (in.failed() || version != touch_recording::kVersion) {
+        return {.frames = {}, .error = std::format("unsupported touch recording version {}", version)};
+    }
+
+    TouchRecordingLoad result;
+    while (!in.atEnd()) {
+        const size_t frameOffset = in.offset();
+        RecordedFrame frame{
+            .device = in.get<int32_t>(),
+            .frame = in.get<int32_t>(),
+            .timestamp = in.get<double>(),
+            .fingers = {},
+        };
+        const auto count = in.get<uint16_t>();
+        frame.fingers.reserve(count);
+        for (uint16_t i = 0; i < count && !in.failed(); i++) {
+            frame.fingers.push_back({
+                .id = in.get<int32_t>(),
+                .x = in.get<float>(),
+                .y = in.get<float>(),
+                .vx = in.get<float>(),
+                .vy = in.get<float>(),
+                .pressure = in.get<float>(),
+                .size = in.get<float>(),
+            });
+        }
+        if (in.failed()) {
+            // a recording cut off mid-frame (e.g. killed while writing) keeps its complete frames
+            result.error = std::format("truncated frame at byte {}", frameOffset);
+            break;
+        }
+        result.frames.push_back(std::move(frame));
+    }
+    return result;
+}
+
+TouchRecordingLoad loadTouchRecording(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return {.frames = {}, .error = std::format("failed to open {}", path.string())};
+    }
+    const std::string contents{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    return decodeTouchRecording(contents);
+}
+
+bool TouchRecorder::open(const std::filesystem::path& path) {
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_) return false;
+    buf_.clear();
+    touch_recording::encodeHeader(buf_);
+    file_.write(buf_.bytes().data(), static_cast<std::streamsize>(buf_.size()));
+    frames_ = 0;
+    return static_cast<bool>(file_);
+}
+
+void TouchRecorder::record(const RecordedFrame& frame) {
+    if (!file_.is_open()) return;
+    buf_.clear();
+    touch_recording::encodeFrame(buf_, frame);
+    file_.write(buf_.bytes().data(), static_cast<std::streamsize>(buf_.size()));
+    frames_++;
+}
+
+void TouchRecorder::close() {
+    if (file_.is_open()) file_.close();
+}
+
+DurationStats summarizeDurations(std::vector<int64_t> samples) {
+    if (samples.empty()) return {};
+    std::ranges::sort(samples);
+    const auto at = [&](double q) {
+        const auto idx = static_cast<size_t>(q * static_cast<double>(samples.size() - 1));
+        return samples[idx];
+    };
+    const int64_t total = std::accumulate(samples.begin(), samples.end(), int64_t{0});
+    return {
+        .meanNs = total / static_cast<int64_t>(samples.size()),
+        .p50Ns = at(0.50),
+        .p99Ns = at(0.99),
+        .maxNs = samples.back(),
+    };
+}
+
+ReplayReport replayTouchFrames(const std::vector<RecordedFrame>& frames,
+    TapDetector::Config tapConfig, GestureDetector::Config gestureConfig, PressDetector::Config pressConfig) {
+    struct DeviceState {
+        TapDetector taps;
+        GestureDetector gestures;
+        PressDetector presses;
+        int64_t sessionStartNs{};
+        bool touching{};
+    };
+    std::unordered_map<int32_t, DeviceState> devices;
+
+    ReplayReport report;
+    report.frames = frames.size();
+    std::vector<int64_t> processing;
+    processing.reserve(frames.size());
+
+    std::vector<Touch> touches;
+    for (const auto& frame : frames) {
+        const auto nowNs = static_cast<int64_t>(frame.timestamp * 1e9);
+        auto [it, inserted] = devices.try_emplace(frame.device);
+        DeviceState& dev = it->second;
+        if (inserted) {
+            dev.taps.setConfig(tapConfig);
+            dev.gestures.setConfig(gestureConfig);
+            dev.presses.setConfig(pressConfig);
+        }
+        if (!dev.touching && !frame.fingers.empty()) {
+            dev.sessionStartNs = nowNs;
+        }
+        dev.touching = !frame.fingers.empty();
+
+        const auto start = std::chrono::steady_clock::now();
+        touches.clear();
+        for (const auto& f : frame.fingers) {
+            touches.push_back({f.id, f.x, f.y, f.pressure});
+        }
+        auto zone = dev.taps.onFrame(touches, nowNs);
+        auto gesture = dev.gestures.onFrame(touches, nowNs);
+        auto press = dev.presses.onFrame(touches);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        processing.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+        if (zone) {
+            report.events.push_back({frame.device, *zone, nowNs, nowNs - dev.sessionStartNs});
+        }
+        if (gesture) {
+            report.events.push_back({frame.device, *gesture, nowNs, nowNs - dev.sessionStartNs});
+        }
+        if (press) {
+            report.events.push_back({frame.device, *press, nowNs, nowNs - dev.sessionStartNs});
+        }
+    }
+    report.frameProcessing = summarizeDurations(std::move(processing));
+    return report;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "../common/binary_io.hpp"
+#include "../input/gesture.hpp"
+#include "../input/press.hpp"
+#include "../input/zone.hpp"
+#include "gesture_detector.hpp"
+#include "press_detector.hpp"
+#include "tap_detector.hpp"
+
+// one contact as reported by MultitouchSupport. positions and velocities are normalized
+struct RecordedFinger {
+    int32_t id;
+    float x;
+    float y;
+    float vx;
+    float vy;
+    float pressure;
+    float size;
+
+    bool operator==(const RecordedFinger&) const = default;
+};
+
+struct RecordedFrame {
+    int32_t device;
+    int32_t frame;
+    // seconds on the framework's clock, as passed to the contact callback
+    double timestamp;
+    std::vector<RecordedFinger> fingers;
+
+    bool operator==(const RecordedFrame&) const = default;
+};
+
+// file layout: "SMTR" magic, u16 version, then frames back to back until end of file
+// frame: i32 device, i32 frame, f64 timestamp, u16 finger count, then per finger
+// i32 id and f32 x, y, vx, vy, pressure, size. all little-endian
+namespace touch_recording {
+
+inline constexpr std::string_view kMagic = "SMTR";
+inline constexpr uint16_t kVersion = 1;
+
+void encodeHeader(ByteWriter& out);
+void encodeFrame(ByteWriter& out, const RecordedFrame& frame);
+
+}  // namespace touch_recording
+
+struct TouchRecordingLoad {
+    std::vector<RecordedFrame> frames;
+    std::optional<std::string> error;
+};
+
+TouchRecordingLoad decodeTouchRecording(std::string_view bytes);
+TouchRecordingLoad loadTouchRecording(const std::filesystem::path& path);
+
+// streams frames to a file. called from the MultitouchSupport thread, so record()
+// reuses one encode buffer and leaves flushing to the stream
+class TouchRecorder {
+   public:
+    bool open(const std::filesystem::path& path);
+    void record(const RecordedFrame& frame);
+    void close();
+
+    [[nodiscard]] size_t framesWritten() const { return frames_; }
+
+   private:
+    std::ofstream file_;
+    ByteWriter buf_;
+    size_t frames_{};
+};
+
+struct ReplayEvent {
+    int32_t device;
+    std::variant<Zone, Gesture, Press> trigger;
+    // recorded time of the frame that produced the event
+    int64_t timeNs;
+    // time from the first finger down in that device's touch session to detection
+    int64_t latencyNs;
+};
+
+struct DurationStats {
+    int64_t meanNs{};
+    int64_t p50Ns{};
+    int64_t p99Ns{};
+    int64_t maxNs{};
+};
+
+DurationStats summarizeDurations(std::vector<int64_t> samples);
+
+struct ReplayReport {
+    std::vector<ReplayEvent> events;
+    size_t frames{};
+    // wall-clock time spent in the detectors for each frame
+    DurationStats frameProcessing;
+};
+
+// push recorded frames through the same per-device tap, gesture, and press detectors
+// the live contact callback uses, timed against the recorded timestamps
+ReplayReport replayTouchFrames(const std::vector<RecordedFrame>& frames,
+    TapDetector::Config tapConfig, GestureDetector::Config gestureConfig, PressDetector::Config pressConfig = {});
@@ -0,0 +1,300 @@
+// performance regression gate: fixed scenarios timed against the budgets in perf_budgets.txt.
+// times are normalized by a calibration loop run in the same process, so a budget carries
+// across machines of one architecture better than raw nanoseconds would, though not across
+// CPUs: the budgets file names the host they were recorded on, and any other host exits 77,
+// which ctest reports as skipped. so does an unoptimized or sanitized build.
+//
+// usage: smhkd_perf_gate [budgets file] [--update]
+// --update rewrites the budgets from this run, keeping each scenario's tolerance
+// without it, an unreadable budgets file or a scenario with no budget fails the gate
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <optional>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+
+#include "bench_common.hpp"
+#include "config_gen.hpp"
+#include "lang/config_loader.hpp"
+#include "lang/parser.hpp"
+#include "runtime/hotkey_engine.hpp"
+#include "runtime/tap_detector.hpp"
+
+#ifndef SMHKD_PERF_BUDGETS
+#define SMHKD_PERF_BUDGETS "tests/perf_budgets.txt"
+#endif
+
+namespace {
+
+constexpr int kSkip = 77;
+// runs per scenario; the fastest counts, since noise only ever adds time
+constexpr int kRuns = 15;
+constexpr double kDefaultTolerancePercent = 15;
+
+template <typename Fn>
+double bestNs(Fn&& fn) {
+    double best = 0;
+    for (int i = 0; i < kRuns; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        best = i == 0 ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+// a fixed mix of arithmetic, branches and loads from a table that fits in L2: the unit
+// every scenario is measured in
+double calibrationNs() {
+    std::vector<uint32_t> table(16 * 1024);
+    for (size_t i = 0; i < table.size(); i++) table[i] = static_cast<uint32_t>(i * 2654435761U);
+    return bestNs([&] {
+        uint64_t x = 0x9e3779b97f4a7c15;
+        for (int i = 0; i < 1 << 20; i++) {
+            x ^= x >> 31;
+            x *= 0xbf58476d1ce4e5b9;
+            x += table[x % table.size()];
+            if (x & 1) x ^= 0x94d049bb133111eb;
+        }
+        doNotOptimize(x);
+    });
+}
+
+struct Scenario {
+    std::string_view name;
+    std::function<double()> run;
+};
+
+double missPath() {
+    auto bindings = ConfigLoader::loadFromContents(generateConfig({.bindings = 10'000})).bindings;
+    blankActions(bindings);
+    HotkeyEngine engine;
+    engine.applyConfig(std::move(bindings), {}, {});
+    const Chord miss{.keysym = {0xFFFF}, .modifiers = {0}, .fingerCount = std::nullopt};
+    return bestNs([&] {
+        for (int i = 0; i < 100; i++) {
+            bool consumed = engine.handleEvent(miss, kCGEventKeyDown, false, 0);
+            doNotOptimize(consumed);
+        }
+    });
+}
+
+double deepSequence() {
+    auto bindings = ConfigLoader::loadFromContents(generateConfig({.bindings = 1'000, .sequenceDepth = 5, .sequencePercent = 30})).bindings;
+    const auto sequence = std::ranges::find_if(bindings, [](const Binding& b) { return b.source.chords.size() == 5; });
+    if (sequence == bindings.end()) return -1;
+    const auto chords = sequence->source.chords;
+    blankActions(bindings);
+    HotkeyEngine engine;
+    engine.applyConfig(std::move(bindings), {}, {});
+    return bestNs([&] {
+        for (int i = 0; i < 1000; i++) {
+            for (const auto& chord : chords) {
+                bool consumed = engine.handleEvent(chord, kCGEventKeyDown, false, 0);
+                doNotOptimize(consumed);
+            }
+        }
+    });
+}
+
+double parseOneMegabyte() {
+    const std::string config = generateConfigBytes(1024 * 1024);
+    return bestNs([&] {
+        Parser parser{config};
+        auto program = parser.parseProgram();
+        doNotOptimize(program);
+    });
+}
+
+// taps in each corner and the center, with two-finger frames between, cycled
+double tapStream() {
+    const std::array<std::vector<Touch>, 8> frames{{
+        {{.id = 1, .x = 0.95F, .y = 0.95F}},
+        {{.id = 1, .x = 0.95F, .y = 0.95F}},
+        {},
+        {{.id = 2, .x = 0.05F, .y = 0.05F}},
+        {},
+        {{.id = 3, .x = 0.5F, .y = 0.5F}, {.id = 4, .x = 0.6F, .y = 0.5F}},
+        {{.id = 3, .x = 0.5F, .y = 0.55F}},
+        {},
+    }};
+    return bestNs([&] {
+        TapDetector detector;
+        detector.setConfig({.cornerSizePct = 15, .tapTimeoutMs = 300});
+        size_t taps = 0;
+        for (int64_t frame = 0; frame < 100'000; frame++) {
+            taps += detector.onFrame(frames.at(static_cast<size_t>(frame) % frames.size()), frame * 8'000'000).has_value() ? 1 : 0;
+        }
+        doNotOptimize(taps);
+    });
+}
+
+struct Budget {
+    double normalized;
+    double tolerancePercent;
+};
+
+using Budgets = std::map<std::string, Budget, std::less<>>;
+
+struct BudgetsFile {
+    // hostId() of the machine the budgets were recorded on
+    std::string host;
+    Budgets budgets;
+};
+
+// "<architecture> <cpu model>": the calibration loop and the scenarios scale differently
+// from one CPU to another, so budgets only hold on the host that recorded them
+std::string hostId() {
+#if defined(__aarch64__)
+    std::string id = "arm64";
+#elif defined(__x86_64__)
+    std::string id = "x86_64";
+#else
+    std::string id = "unknown";
+#endif
+    std::string cpu = "unknown";
+#ifdef __APPLE__
+    std::array<char, 256> brand{};
+    size_t size = brand.size();
+    if (sysctlbyname("machdep.cpu.brand_string", brand.data(), &size, nullptr, 0) == 0) cpu = brand.data();
+#else
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    for (std::string line; std::getline(cpuinfo, line);) {
+        if (!line.starts_with("model name")) continue;
+        const auto colon = line.find(": ");
+        if (colon != std::string::npos) cpu = line.substr(colon + 2);
+        break;
+    }
+#endif
+    return id + " " + cpu;
+}
+
+// "host <hostId()>" once, then "<scenario> <normalized budget> <tolerance percent>" per
+// line, # for comments. nullopt when the file can't be opened
+std::optional<BudgetsFile> readBudgets(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return std::nullopt;
+    BudgetsFile read;
+    auto& budgets = read.budgets;
+    for (std::string line; std::getline(file, line);) {
+        if (line.empty() || line.starts_with('#')) continue;
+        if (line.starts_with("host ")) {
+            read.host = line.substr(5);
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string name;
+        Budget budget{.normalized = 0, .tolerancePercent = kDefaultTolerancePercent};
+        if (fields >> name >> budget.normalized) {
+            fields >> budget.tolerancePercent;
+            budgets[name] = budget;
+        }
+    }
+    return read;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+#if !defined(NDEBUG) || defined(__SANITIZE_ADDRESS__)
+    std::print("perf gate needs an optimized, unsanitized build (-DCMAKE_BUILD_TYPE=Release), skipping\n");
+    (void)argc;
+    (void)argv;
+    return kSkip;
+#else
+    std::string path = SMHKD_PERF_BUDGETS;
+    bool update = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+        if (arg == "--update") {
+            update = true;
+        } else {
+            path = arg;
+        }
+    }
+
+    const std::array<Scenario, 4> scenarios{{
+        // 100 misses against 10k bindings
+        {"miss_10k", missPath},
+        // 1000 five-chord sequences, each completed
+        {"sequence_5", deepSequence},
+        {"parse_1mb", parseOneMegabyte},
+        {"tap_stream_100k", tapStream},
+    }};
+
+    // --update may create the file; checking against nothing would pass every scenario
+    auto read = readBudgets(path);
+    if (!read && !update) {
+        std::print(stderr, "can't read budgets from {}; run with --update to record them\n", path);
+        return 1;
+    }
+    const std::string host = hostId();
+    if (read && !update && read->host != host) {
+        std::print("budgets are for host '{}', not '{}'; skipping (--update records this host's)\n", read->host, host);
+        return kSkip;
+    }
+    auto budgets = read ? std::move(read->budgets) : Budgets{};
+    const double unit = calibrationNs();
+    std::print("calibration: {:.0f} us per unit\n", unit / 1e3);
+    std::print("{:<16} {:>12} {:>10} {:>10} {:>9}  {}\n", "scenario", "time_us", "units", "budget", "change", "status");
+
+    int regressions = 0;
+    for (const auto& scenario : scenarios) {
+        const double ns = scenario.run();
+        if (ns < 0) {
+            std::print("{:<16} could not be set up\n", scenario.name);
+            regressions++;
+            continue;
+        }
+        const double normalized = ns / unit;
+        const auto found = budgets.find(scenario.name);
+        if (update) {
+            const double tolerance = found != budgets.end() ? found->second.tolerancePercent : kDefaultTolerancePercent;
+            budgets[std::string{scenario.name}] = {.normalized = normalized, .tolerancePercent = tolerance};
+            std::print("{:<16} {:>12.1f} {:>10.4f}  recorded\n", scenario.name, ns / 1e3, normalized);
+            continue;
+        }
+        if (found == budgets.end()) {
+            std::print("{:<16} {:>12.1f} {:>10.4f} {:>10} {:>9}  FAILED (no budget)\n", scenario.name, ns / 1e3, normalized, "-", "-");
+            regressions++;
+            continue;
+        }
+        const auto& budget = found->second;
+        const double change = (normalized / budget.normalized - 1) * 100;
+        const bool regressed = change > budget.tolerancePercent;
+        regressions += regressed ? 1 : 0;
+        std::print("{:<16} {:>12.1f} {:>10.4f} {:>10.4f} {:>+8.1f}%  {}\n", scenario.name, ns / 1e3, normalized, budget.normalized,
+            change, regressed ? std::format("REGRESSION (over the {:.0f}% tolerance)", budget.tolerancePercent) : std::string{"ok"});
+    }
+
+    if (update) {
+        std::ofstream out(path);
+        out << "# perf gate budgets, in calibration units (see tests/perf_gate.cpp)\n"
+               "# scenario normalized_budget tolerance_percent\n"
+            << std::format("host {}\n", host);
+        for (const auto& [name, budget] : budgets) {
+            out << std::format("{} {:.4f} {:.0f}\n", name, budget.normalized, budget.tolerancePercent);
+        }
+        std::print("budgets written to {}\n", path);
+        return 0;
+    }
+    if (regressions > 0) std::print("{} scenario(s) regressed or had no budget\n", regressions);
+    return regressions > 0 ? 1 : 0;
+#endif
+}
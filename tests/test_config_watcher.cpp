@@ -0,0 +1,127 @@
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "doctest.h"
+#include "runtime/config_watcher.hpp"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr auto kDebounce = 50ms;
+// how long to wait for an expected reload before failing; only a broken watcher waits it out
+constexpr auto kDeadline = 5s;
+// how long to watch for a reload that shouldn't come: a few debounce windows
+constexpr auto kQuiet = 4 * kDebounce;
+
+// the watcher's callback count, which a test can wait on
+class Reloads {
+   public:
+    void operator()() {
+        {
+            std::lock_guard lock(mutex_);
+            count_++;
+        }
+        changed_.notify_all();
+    }
+
+    // true once the count reaches n, false at the deadline
+    bool waitFor(int n) {
+        std::unique_lock lock(mutex_);
+        return changed_.wait_for(lock, kDeadline, [&] { return count_ >= n; });
+    }
+
+    int count() {
+        std::lock_guard lock(mutex_);
+        return count_;
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    int count_{};
+};
+
+std::filesystem::path makeDir(const std::string& name) {
+    const auto dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+// the way editors that keep a backup save: write a temporary, rename it over the file
+void saveAtomically(const std::filesystem::path& path, const std::string& contents) {
+    auto temp = path;
+    temp += ".tmp";
+    std::ofstream{temp, std::ios::trunc} << contents;
+    std::filesystem::rename(temp, path);
+}
+
+}  // namespace
+
+TEST_CASE("a burst of atomic saves reloads once") {
+    const auto dir = makeDir("smhkd_test_watch_burst");
+    const auto path = dir / "smhkdrc";
+    std::ofstream{path} << "cmd + a : echo 0\n";
+
+    Reloads reloads;
+    ConfigWatcher watcher{path, kDebounce, [&] { reloads(); }};
+    REQUIRE(watcher.start());
+
+    for (int i = 1; i <= 5; i++) {
+        saveAtomically(path, "cmd + a : echo " + std::to_string(i) + "\n");
+        std::this_thread::sleep_for(5ms);
+    }
+    CHECK(reloads.waitFor(1));
+    std::this_thread::sleep_for(kQuiet);
+    CHECK(reloads.count() == 1);
+
+    // the watch follows the renamed-in file, so a later in-place write is still seen
+    std::ofstream{path, std::ios::app} << "cmd + b : echo b\n";
+    CHECK(reloads.waitFor(2));
+
+    watcher.stop();
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("other files in the config's directory are ignored") {
+    const auto dir = makeDir("smhkd_test_watch_other");
+    const auto path = dir / "smhkdrc";
+    std::ofstream{path} << "cmd + a : echo a\n";
+
+    Reloads reloads;
+    ConfigWatcher watcher{path, kDebounce, [&] { reloads(); }};
+    REQUIRE(watcher.start());
+
+    std::ofstream{dir / "notes.txt"} << "unrelated\n";
+    saveAtomically(dir / "other", "unrelated\n");
+    std::this_thread::sleep_for(kQuiet);
+    CHECK(reloads.count() == 0);
+
+    watcher.stop();
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("a config deleted and written again reloads") {
+    const auto dir = makeDir("smhkd_test_watch_recreate");
+    const auto path = dir / "smhkdrc";
+    std::ofstream{path} << "cmd + a : echo a\n";
+
+    Reloads reloads;
+    ConfigWatcher watcher{path, kDebounce, [&] { reloads(); }};
+    REQUIRE(watcher.start());
+
+    std::filesystem::remove(path);
+    std::ofstream{path} << "cmd + a : echo b\n";
+    CHECK(reloads.waitFor(1));
+    std::this_thread::sleep_for(kQuiet);
+    CHECK(reloads.count() == 1);
+
+    watcher.stop();
+    std::filesystem::remove_all(dir);
+}
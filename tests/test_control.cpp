@@ -0,0 +1,65 @@
+#include <filesystem>
+#include <string>
+
+#include "doctest.h"
+#include "runtime/control.hpp"
+
+TEST_CASE("control requests parse by command name") {
+    const auto reload = control::parseRequest("reload\n");
+    REQUIRE(reload);
+    CHECK(reload->command == control::Command::Reload);
+    CHECK(reload->argument.empty());
+
+    const auto trigger = control::parseRequest("trigger cmd + shift - a\r\n");
+    REQUIRE(trigger);
+    CHECK(trigger->command == control::Command::Trigger);
+    CHECK(trigger->argument == "cmd + shift - a");
+
+    CHECK_FALSE(control::parseRequest("restart"));
+    // trigger and mode need an argument, the others take none
+    CHECK_FALSE(control::parseRequest("trigger"));
+    CHECK_FALSE(control::parseRequest("mode"));
+    CHECK_FALSE(control::parseRequest("status now"));
+}
+
+TEST_CASE("control requests and responses round-trip") {
+    const control::Request request{.command = control::Command::Mode, .argument = "passthrough"};
+    CHECK(control::formatRequest(request) == "mode passthrough\n");
+    const auto parsed = control::parseRequest(control::formatRequest(request));
+    REQUIRE(parsed);
+    CHECK(parsed->command == request.command);
+    CHECK(parsed->argument == request.argument);
+
+    const control::Response failed{.ok = false, .lines = {"parse error at line 1, column 5: x", "config error: y"}};
+    CHECK(control::formatResponse(failed) == "error\nparse error at line 1, column 5: x\nconfig error: y\n");
+    const auto response = control::parseResponse(control::formatResponse(failed));
+    REQUIRE(response);
+    CHECK_FALSE(response->ok);
+    CHECK(response->lines == failed.lines);
+
+    const auto ok = control::parseResponse("ok\n");
+    REQUIRE(ok);
+    CHECK(ok->ok);
+    CHECK(ok->lines.empty());
+    CHECK_FALSE(control::parseResponse("garbage\n"));
+}
+
+TEST_CASE("sending to a socket nobody listens on fails instead of blocking") {
+    const auto path = std::filesystem::temp_directory_path() / "smhkd_test_no_daemon.socket";
+    std::filesystem::remove(path);
+    CHECK_FALSE(control::send(path, {.command = control::Command::Status}));
+}
+
+TEST_CASE("a batch of key specs splits on semicolons") {
+    const auto specs = control::splitKeySpecs("cmd + a ; shift + b;;  return ");
+    REQUIRE(specs.size() == 3);
+    CHECK(specs[0] == "cmd + a");
+    CHECK(specs[1] == "shift + b");
+    CHECK(specs[2] == "return");
+    CHECK(control::splitKeySpecs(" ; ").empty());
+
+    const auto request = control::parseRequest("key cmd + a ; b\n");
+    REQUIRE(request);
+    CHECK(request->command == control::Command::Key);
+    CHECK(request->argument == "cmd + a ; b");
+}
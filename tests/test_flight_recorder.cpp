@@ -0,0 +1,72 @@
+#include <unistd.h>
+
+#include <array>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "doctest.h"
+#include "runtime/flight_recorder.hpp"
+
+TEST_CASE("the flight recorder keeps the newest entries, oldest first") {
+    FlightRecorder recorder;
+    const auto total = FlightRecorder::kCapacity + 10;
+    for (size_t i = 0; i < total; i++) {
+        recorder.record({.timeNs = static_cast<int64_t>(i), .keycode = static_cast<uint32_t>(i)});
+    }
+    std::vector<uint32_t> keycodes;
+    recorder.forEach([&](const FlightRecorder::Entry& entry) { keycodes.push_back(entry.keycode); });
+    REQUIRE(keycodes.size() == FlightRecorder::kCapacity);
+    CHECK(keycodes.front() == 10);
+    CHECK(keycodes.back() == total - 1);
+}
+
+TEST_CASE("a flight recorder dump has the reason and one line per entry") {
+    FlightRecorder recorder;
+    recorder.record({.type = 10, .keycode = 8, .flags = 0x80120, .binding = 3, .consumed = true, .durationNs = 42'000});
+    recorder.record({.kind = FlightRecorder::Kind::TapTimeout});
+
+    std::array<int, 2> fds{};
+    REQUIRE(pipe(fds.data()) == 0);
+    recorder.dump(fds[1], "safety trip");
+    close(fds[1]);
+    std::string text;
+    std::array<char, 512> buffer{};
+    for (ssize_t n; (n = read(fds[0], buffer.data(), buffer.size())) > 0;) text.append(buffer.data(), static_cast<size_t>(n));
+    close(fds[0]);
+
+    CHECK(text.starts_with("smhkd flight recorder: safety trip, pid "));
+    CHECK(text.find(" key type=10 keycode=8 flags=0x80120 binding=3 consumed took=42us\n") != std::string::npos);
+    CHECK(text.find(" tap_timeout took=0us\n") != std::string::npos);
+}
+
+TEST_CASE("a flight recorder dump won't follow a symlink planted at its path") {
+    const auto dir = std::filesystem::temp_directory_path() / std::format("smhkd_test_flight_{}", getpid());
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto target = dir / "target";
+    const auto link = dir / "smhkd.flight";
+    std::ofstream(target) << "keep";
+    std::filesystem::create_symlink(target, link);
+
+    FlightRecorder recorder;
+    recorder.record({.keycode = 1});
+    REQUIRE(recorder.setDumpPath(link));
+    recorder.dump("safety trip");
+
+    std::ifstream in(target);
+    std::string contents;
+    std::getline(in, contents);
+    CHECK(contents == "keep");
+
+    // a real file at the path is written as before
+    std::filesystem::remove(link);
+    recorder.dump("safety trip");
+    std::ifstream dumped(link);
+    std::string first;
+    std::getline(dumped, first);
+    CHECK(first.starts_with("smhkd flight recorder: safety trip"));
+    std::filesystem::remove_all(dir);
+}
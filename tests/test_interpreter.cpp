@@ -1,7 +1,14 @@
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <future>
 #include <set>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -9,10 +16,12 @@
 #include "input/keysym.hpp"
 #include "input/locale.hpp"
 #include "input/modifier.hpp"
+#include "lang/config_cache.hpp"
 #include "lang/config_loader.hpp"
 #include "lang/interpreter.hpp"
 #include "lang/parser.hpp"
 #include "runtime/hotkey_engine.hpp"
+#include "runtime/time_source.hpp"
 
 namespace {
 
@@ -175,6 +184,89 @@ TEST_CASE("a keyboard remap to a media key is allowed") {
     CHECK(std::get<Chord>(remaps[0].action).modifiers.has(Hotkey_Flag_NX));
 }
 
+TEST_CASE("define_region names resolve to region zones with their rects") {
+    auto r = interpret_source(
+        "define_region middle = rect(30, 30, 70, 70)\n"
+        "define_region top_mid = grid(3, 3, 1, 0)\n"
+        "cmd + trackpad_tap(region:top_mid) : echo top\n"
+        "cmd + trackpad_tap(region:middle) : echo mid\n"
+        "cmd + trackpad_tap(region:top_mid) | a\n");
+    REQUIRE(r.errors.empty());
+    REQUIRE(r.tapBindings.size() == 3);
+    CHECK(r.tapBindings[0].zone == regionZone(1));
+    CHECK(r.tapBindings[1].zone == regionZone(1));
+    CHECK(r.tapBindings[2].zone == regionZone(0));
+    // one rect per bound zone, the grid cell's row 0 being the top third
+    REQUIRE(r.tapRegions.size() == 2);
+    CHECK(r.tapRegions[0].zone == regionZone(1));
+    CHECK(r.tapRegions[0].rect == ZoneRect{33, 67, 66, 100});
+    CHECK(r.tapRegions[1].rect == ZoneRect{30, 30, 70, 70});
+}
+
+TEST_CASE("built-in zones are sized by corner_size in tapRegions") {
+    auto r = interpret_source("corner_size = 20\ncmd + trackpad_tap(top_edge) : x\ncmd + trackpad_tap(br) : y");
+    REQUIRE(r.errors.empty());
+    REQUIRE(r.tapRegions.size() == 2);
+    CHECK(r.tapRegions[0].rect == ZoneRect{0, 80, 100, 100});
+    CHECK(r.tapRegions[1].rect == ZoneRect{80, 0, 100, 20});
+}
+
+TEST_CASE("an undefined or invalid region is an error") {
+    auto unknown = interpret_source("cmd + trackpad_tap(region:nowhere) : x");
+    REQUIRE_FALSE(unknown.errors.empty());
+    CHECK(unknown.errors[0].message.contains("unknown trackpad region 'nowhere'"));
+    CHECK(unknown.tapBindings.empty());
+
+    auto inverted = interpret_source("define_region r = rect(50, 0, 40, 10)");
+    CHECK_FALSE(inverted.errors.empty());
+
+    auto builtin = interpret_source("define_region tl = rect(0, 0, 10, 10)");
+    REQUIRE_FALSE(builtin.errors.empty());
+    CHECK(builtin.errors[0].message.contains("built-in"));
+}
+
+TEST_CASE("define_region past the zone map's limit is an error, a redefinition is not") {
+    std::string src;
+    for (size_t i = 0; i <= kMaxRegions; i++) src += std::format("define_region r{} = rect(0, 0, 10, 10)\n", i);
+    src += "define_region r0 = rect(0, 0, 20, 20)\n";
+    auto r = interpret_source(src);
+    REQUIRE(r.errors.size() == 1);
+    CHECK(r.errors[0].message == std::format("region 'r{}': at most {} regions can be defined", kMaxRegions, kMaxRegions));
+}
+
+TEST_CASE("trackpad_press lowers to press bindings, with zones in tapRegions") {
+    auto r = interpret_source(
+        "press_threshold = 250\n"
+        "trackpad_press(tl) : echo corner\n"
+        "cmd + trackpad_press(2) | f11\n");
+    REQUIRE(r.errors.empty());
+    CHECK(r.config.pressThreshold == 250);
+    CHECK(r.tapBindings.empty());
+    REQUIRE(r.pressBindings.size() == 2);
+    CHECK(r.pressBindings[0].press == Press{.zone = std::nullopt, .fingers = 2});
+    CHECK(r.pressBindings[0].modifiers.flags == Hotkey_Flag_Cmd);
+    CHECK(r.pressBindings[1].press == Press{.zone = Zone::TopLeft, .fingers = 1});
+    CHECK(std::get<std::string>(r.pressBindings[1].action) == "echo corner");
+    REQUIRE(r.tapRegions.size() == 1);
+    CHECK(r.tapRegions[0].zone == Zone::TopLeft);
+}
+
+TEST_CASE("engine matches a press by trigger and modifiers") {
+    auto r = interpret_source("cmd + trackpad_press(tr) : echo hi");
+    REQUIRE(r.errors.empty());
+    // recorded rather than spawned
+    std::vector<std::string> ran;
+    HotkeyEngine engine(steadyTimeSource(), HotkeyEngine::postEvent, [&](const std::string& command) { ran.push_back(command); });
+    engine.applyConfig({}, {}, r.config, {}, r.pressBindings);
+    const ModifierFlags cmd{.flags = Hotkey_Flag_Cmd};
+    CHECK_FALSE(engine.handlePress(Press{.zone = Zone::TopLeft, .fingers = 1}, cmd));
+    CHECK_FALSE(engine.handlePress(Press{.zone = std::nullopt, .fingers = 2}, cmd));
+    CHECK_FALSE(engine.handlePress(Press{.zone = Zone::TopRight, .fingers = 1}, ModifierFlags{.flags = 0}));
+    CHECK(ran.empty());
+    CHECK(engine.handlePress(Press{.zone = Zone::TopRight, .fingers = 1}, cmd));
+    CHECK(ran == std::vector<std::string>{"echo hi"});
+}
+
 TEST_CASE("engine matches a corner tap by zone and modifiers") {
     auto r = interpret_source("cmd + trackpad_tap(tr) : echo hi");
     REQUIRE(r.errors.empty());
@@ -186,6 +278,255 @@ TEST_CASE("engine matches a corner tap by zone and modifiers") {
     CHECK_FALSE(engine.handleTap(Zone::BottomRight, ModifierFlags{.flags = Hotkey_Flag_Cmd}));
 }
 
+TEST_CASE("trackpad gestures lower to gesture bindings and need no modifier") {
+    auto r = interpret_source(
+        "trackpad_swipe(3, left) : echo left\n"
+        "cmd + trackpad_pinch(in) | f11\n");
+    REQUIRE(r.errors.empty());
+    CHECK(r.bindings.empty());
+    CHECK(r.tapBindings.empty());
+    REQUIRE(r.gestureBindings.size() == 2);
+    // remaps are applied in the first pass, ahead of hotkeys
+    CHECK(r.gestureBindings[0].gesture == Gesture{.kind = GestureKind::PinchIn, .fingers = 2});
+    CHECK(r.gestureBindings[0].modifiers.flags == Hotkey_Flag_Cmd);
+    CHECK(std::holds_alternative<Chord>(r.gestureBindings[0].action));
+    CHECK(r.gestureBindings[1].gesture == Gesture{.kind = GestureKind::SwipeLeft, .fingers = 3});
+    CHECK(r.gestureBindings[1].modifiers.flags == 0);
+    CHECK(std::get<std::string>(r.gestureBindings[1].action) == "echo left");
+}
+
+TEST_CASE("a trackpad gesture inside a chord sequence is an error") {
+    auto r = interpret_source("cmd + a ; trackpad_swipe(3, up) : echo hi");
+    REQUIRE_FALSE(r.errors.empty());
+    CHECK(r.errors[0].message.contains("single chord"));
+    CHECK(r.gestureBindings.empty());
+}
+
+TEST_CASE("engine matches a gesture by kind, finger count, and modifiers") {
+    auto r = interpret_source("cmd + trackpad_swipe(3, up) : echo hi");
+    REQUIRE(r.errors.empty());
+    // recorded rather than spawned
+    std::vector<std::string> ran;
+    HotkeyEngine engine(steadyTimeSource(), HotkeyEngine::postEvent, [&](const std::string& command) { ran.push_back(command); });
+    engine.applyConfig({}, {}, r.config, r.gestureBindings);
+    const ModifierFlags cmd{.flags = Hotkey_Flag_Cmd};
+    CHECK_FALSE(engine.handleGesture(Gesture{.kind = GestureKind::SwipeDown, .fingers = 3}, cmd));
+    CHECK_FALSE(engine.handleGesture(Gesture{.kind = GestureKind::SwipeUp, .fingers = 4}, cmd));
+    CHECK_FALSE(engine.handleGesture(Gesture{.kind = GestureKind::SwipeUp, .fingers = 3}, ModifierFlags{.flags = 0}));
+    CHECK(ran.empty());
+    CHECK(engine.handleGesture(Gesture{.kind = GestureKind::SwipeUp, .fingers = 3}, cmd));
+    CHECK(ran == std::vector<std::string>{"echo hi"});
+}
+
+TEST_CASE("engine measures the chord interval on its clock or the event's timestamp") {
+    using namespace std::chrono_literals;
+    auto r = interpret_source("max_chord_interval = 500\na ; b : echo hi");
+    REQUIRE(r.errors.empty());
+    REQUIRE(r.bindings.size() == 1);
+    const auto chords = r.bindings[0].source.chords;
+    // matched but never run
+    r.bindings[0].action = std::string{};
+    ManualTimeSource time;
+    HotkeyEngine engine(time);
+    engine.applyConfig(r.bindings, {}, r.config);
+
+    CHECK(engine.handleEvent(chords[0], kCGEventKeyDown, false, 0));
+    time.advance(400ms);
+    CHECK(engine.handleEvent(chords[1], kCGEventKeyDown, false, 0));
+    CHECK(engine.lastMatch() == 0);
+
+    CHECK(engine.handleEvent(chords[0], kCGEventKeyDown, false, 0));
+    time.advance(600ms);
+    CHECK_FALSE(engine.handleEvent(chords[1], kCGEventKeyDown, false, 0));
+    CHECK(engine.lastMatch() == -1);
+
+    // an event's own timestamp wins over the clock, which no longer moves
+    CHECK(engine.handleEvent(chords[0], kCGEventKeyDown, false, 0, 10'000'000'000));
+    CHECK_FALSE(engine.handleEvent(chords[1], kCGEventKeyDown, false, 0, 10'600'000'000));
+    CHECK(engine.handleEvent(chords[0], kCGEventKeyDown, false, 0, 11'000'000'000));
+    CHECK(engine.handleEvent(chords[1], kCGEventKeyDown, false, 0, 11'100'000'000));
+    CHECK(engine.lastMatch() == 0);
+}
+
+TEST_CASE("engine hands a remap back as a rewrite of the event") {
+    auto r = interpret_source("a | b\nc : echo hi\nd ~ : echo hi");
+    REQUIRE(r.errors.empty());
+    const auto remap = remap_bindings(r.bindings).at(0);
+    const auto commands = hotkey_bindings(r.bindings);
+    REQUIRE(commands.size() == 2);
+    // matched but never run
+    for (auto& b : r.bindings) {
+        if (std::holds_alternative<std::string>(b.action)) b.action = std::string{};
+    }
+    HotkeyEngine engine;
+    engine.applyConfig(r.bindings, {}, r.config);
+
+    const Chord& from = remap.source.chords[0];
+    for (const auto type : {kCGEventKeyDown, kCGEventKeyUp}) {
+        const auto decision = engine.decideEvent(from, type, false, 0);
+        CHECK(decision.kind == EventDecision::Kind::Rewrite);
+        CHECK(decision.target == std::get<Chord>(remap.action));
+    }
+    const auto consume = std::ranges::find_if(commands, [](const Binding& b) { return !b.source.passthrough; });
+    const auto pass = std::ranges::find_if(commands, [](const Binding& b) { return b.source.passthrough; });
+    REQUIRE(consume != commands.end());
+    REQUIRE(pass != commands.end());
+    CHECK(engine.decideEvent(consume->source.chords[0], kCGEventKeyDown, false, 0).kind == EventDecision::Kind::Consume);
+    CHECK(engine.decideEvent(pass->source.chords[0], kCGEventKeyDown, false, 0).kind == EventDecision::Kind::Pass);
+    const Chord miss{.keysym = {0xFFFF}, .modifiers = {0}, .fingerCount = std::nullopt};
+    CHECK(engine.decideEvent(miss, kCGEventKeyDown, false, 0).kind == EventDecision::Kind::Pass);
+}
+
+TEST_CASE("macro remap types its chords on the output thread once per press") {
+    auto r = interpret_source("a | cmd + c ; cmd + v\ntrackpad_swipe(3, left) | b ; c");
+    REQUIRE(r.errors.empty());
+    REQUIRE(r.bindings.size() == 1);
+    const auto& events = std::get<KeyProgram>(r.bindings[0].action).program->events;
+    REQUIRE(events.size() == 4);
+    CHECK(events[0].keyDown);
+    CHECK_FALSE(events[1].keyDown);
+    CHECK((events[0].flags & Hotkey_Flag_Cmd) != 0);
+    REQUIRE(r.gestureBindings.size() == 1);
+    CHECK(std::get<KeyProgram>(r.gestureBindings[0].action).program->events.size() == 4);
+
+    std::vector<std::pair<uint32_t, bool>> posted;
+    HotkeyEngine engine(steadyTimeSource(), [&](const KeyEvent& event, std::u16string_view) { posted.emplace_back(event.keycode, event.keyDown); });
+    engine.applyConfig(r.bindings, r.tapBindings, r.config, r.gestureBindings);
+
+    const Chord& from = r.bindings[0].source.chords[0];
+    CHECK(engine.decideEvent(from, kCGEventKeyDown, false, 0).kind == EventDecision::Kind::Consume);
+    CHECK(engine.decideEvent(from, kCGEventKeyDown, true, 0).kind == EventDecision::Kind::Consume);
+    CHECK(engine.decideEvent(from, kCGEventKeyUp, false, 0).kind == EventDecision::Kind::Consume);
+    engine.drainOutput();
+    const uint32_t c = events[0].keycode;
+    const uint32_t v = events[2].keycode;
+    CHECK(posted == std::vector<std::pair<uint32_t, bool>>{{c, true}, {c, false}, {v, true}, {v, false}});
+
+    posted.clear();
+    CHECK(engine.handleGesture(r.gestureBindings[0].gesture, r.gestureBindings[0].modifiers));
+    engine.drainOutput();
+    CHECK(posted.size() == 4);
+}
+
+TEST_CASE("sequence remap posts its program once the sequence completes") {
+    auto r = interpret_source("a ; b | cmd + c ; cmd + v\nx ; y | z");
+    REQUIRE(r.errors.empty());
+    REQUIRE(r.bindings.size() == 2);
+    // a sequence has no event of its own to rewrite, so even a single target is compiled
+    CHECK(std::get<KeyProgram>(r.bindings[1].action).program->events.size() == 2);
+
+    std::vector<std::pair<uint32_t, bool>> posted;
+    HotkeyEngine engine(steadyTimeSource(), [&](const KeyEvent& event, std::u16string_view) { posted.emplace_back(event.keycode, event.keyDown); });
+    engine.applyConfig(r.bindings, {}, r.config);
+
+    const auto& chords = r.bindings[0].source.chords;
+    REQUIRE(chords.size() == 2);
+    CHECK(engine.decideEvent(chords[0], kCGEventKeyDown, false, 0, 0).kind == EventDecision::Kind::Consume);
+    engine.drainOutput();
+    CHECK(posted.empty());
+    CHECK(engine.decideEvent(chords[1], kCGEventKeyDown, false, 0, 1).kind == EventDecision::Kind::Consume);
+    CHECK(engine.lastMatch() == 0);
+    engine.drainOutput();
+    REQUIRE(posted.size() == 4);
+    CHECK(posted[0] == std::pair<uint32_t, bool>{getKeycode('c'), true});
+    CHECK(posted[2] == std::pair<uint32_t, bool>{getKeycode('v'), true});
+}
+
+TEST_CASE("a remap waits behind a macro that is still being posted") {
+    auto r = interpret_source("cmd + s | \"ab\"\nx | y");
+    REQUIRE(r.errors.empty());
+    REQUIRE(r.bindings.size() == 2);
+
+    // the macro's first event holds the output thread until the remap has been decided
+    std::promise<void> release;
+    const auto released = release.get_future().share();
+    std::vector<std::pair<uint32_t, bool>> posted;
+    HotkeyEngine engine(steadyTimeSource(), [&](const KeyEvent& event, std::u16string_view) {
+        released.wait();
+        posted.emplace_back(event.keycode, event.keyDown);
+    });
+    engine.applyConfig(r.bindings, {}, r.config);
+
+    CHECK(engine.decideEvent(r.bindings[0].source.chords[0], kCGEventKeyDown, false, 0).kind == EventDecision::Kind::Consume);
+    const Chord& from = r.bindings[1].source.chords[0];
+    CHECK(engine.decideEvent(from, kCGEventKeyDown, false, 0).kind == EventDecision::Kind::Consume);
+    release.set_value();
+    engine.drainOutput();
+    REQUIRE(posted.size() == 5);
+    CHECK(posted[4] == std::pair<uint32_t, bool>{getKeycode('y'), true});
+
+    // with nothing queued the event is rewritten in place again
+    CHECK(engine.decideEvent(from, kCGEventKeyUp, false, 0).kind == EventDecision::Kind::Rewrite);
+}
+
+TEST_CASE("text remap is planned into layout keys, with unicode text for the rest") {
+    auto r = interpret_source("cmd + s | \"aA\\n\U0001F600\U0001F600\"\ntype_rate = 100\ncmd + e | \"\"");
+    REQUIRE(r.errors.size() == 1);
+    CHECK(r.errors[0].message == "remap text must not be empty");
+    REQUIRE(r.bindings.size() == 1);
+    const auto& program = *std::get<KeyProgram>(r.bindings[0].action).program;
+    // a press for each of the three keys, and one for the text no key types
+    REQUIRE(program.events.size() == 8);
+    const auto a = lookupCharacterKey(u'a');
+    const auto newline = lookupCharacterKey(u'\n');
+    REQUIRE(a);
+    REQUIRE(newline);
+    CHECK(program.events[0].keycode == a->keycode);
+    CHECK(program.events[0].pause == KeyEvent::Pause::Burst);
+    CHECK(program.textOf(program.events[0]).empty());
+    CHECK(program.events[2].keycode == a->keycode);
+    CHECK((program.events[2].flags & Hotkey_Flag_Shift) != 0);
+    CHECK(program.events[2].pause == KeyEvent::Pause::None);
+    CHECK(program.events[4].keycode == newline->keycode);
+    // no key types an emoji, so both go in one event's unicode string
+    CHECK(program.textOf(program.events[6]) == u"\U0001F600\U0001F600");
+    CHECK(program.textOf(program.events[7]) == u"\U0001F600\U0001F600");
+    CHECK(r.config.typeRate == 100);
+}
+
+TEST_CASE("text remap ending in an escaped backslash types the backslash once") {
+    auto r = interpret_source("a | \"\\\\\"\nb | \"\\\\n\"");
+    REQUIRE(r.errors.empty());
+    REQUIRE(r.bindings.size() == 2);
+    CHECK(std::get<KeyProgram>(r.bindings[0].action).program->events.size() == 2);
+    // a backslash and an n, not a newline
+    CHECK(std::get<KeyProgram>(r.bindings[1].action).program->events.size() == 4);
+}
+
+TEST_CASE("text remap rejects UTF-8 that isn't the shortest form of a scalar value") {
+    // overlong, C0/C1 and F5 leads, an encoded surrogate, past U+10FFFF, a truncated sequence
+    for (const std::string_view bad : {"\xC0\xAF", "\xC1\xBF", "\xE0\x80\xAF", "\xF0\x80\x80\xAF", "\xED\xA0\x80",
+             "\xED\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xF7\xBF\xBF\xBF", "\xE2\x82"}) {
+        CAPTURE(bad);
+        auto r = interpret_source(std::format("a | \"x{}\"", bad));
+        REQUIRE(r.errors.size() == 1);
+        CHECK(r.errors[0].message == "remap text is not valid UTF-8 at byte 1");
+        CHECK(r.bindings.empty());
+    }
+    // the edges that are valid
+    for (const std::string_view good : {"\xC2\x80", "\xE0\xA0\x80", "\xED\x9F\xBF", "\xEE\x80\x80", "\xF4\x8F\xBF\xBF"}) {
+        CAPTURE(good);
+        CHECK(interpret_source(std::format("a | \"{}\"", good)).errors.empty());
+    }
+}
+
+TEST_CASE("engine types text in bursts paced by type_rate") {
+    auto r = interpret_source("type_rate = 1000\na | \"abcdefghij\"");
+    REQUIRE(r.errors.empty());
+
+    std::vector<std::chrono::steady_clock::time_point> downs;
+    HotkeyEngine engine(steadyTimeSource(), [&](const KeyEvent& event, std::u16string_view) {
+        if (event.keyDown) downs.push_back(std::chrono::steady_clock::now());
+    });
+    engine.applyConfig(r.bindings, {}, r.config);
+    CHECK(engine.decideEvent(r.bindings[0].source.chords[0], kCGEventKeyDown, false, 0).kind == EventDecision::Kind::Consume);
+    engine.drainOutput();
+
+    // 8 keys a burst at 1000 keys a second: the second burst waits 8ms after the first
+    REQUIRE(downs.size() == 10);
+    CHECK(downs[kTypeBurst] - downs[kTypeBurst - 1] >= std::chrono::milliseconds(8));
+}
+
 TEST_CASE("multiple modifiers combine flags") {
     auto r = interpret_source("cmd + shift + alt + a : noop");
     REQUIRE(r.errors.empty());
@@ -282,6 +623,69 @@ TEST_CASE("brace expansion in more than one sequence chord is an error") {
     CHECK(hotkey_bindings(r.bindings).empty());
 }
 
+TEST_CASE("key(...) hotkey is one binding that yields to a key bound by name") {
+    auto r = interpret_source("cmd + alt + key(letter) : focus {} {{x}}\ncmd + alt + a : exact");
+    REQUIRE(r.errors.empty());
+    REQUIRE(r.bindings.size() == 2);
+    CHECK(r.bindings[0].source.chords[0].keysym.wildcard == KeyClass::Letter);
+    // kept as a template, braces still escaped, for the engine to fill
+    const auto& command = std::get<std::string>(r.bindings[0].action);
+    CHECK(command == "focus {} {{x}}");
+    CHECK(fillKeyCapture(command, Keysym{.keycode = getKeycode('q')}) == "focus 'q' {x}");
+
+    HotkeyEngine engine;
+    engine.applyConfig(r.bindings, {}, r.config);
+    const Chord a = r.bindings[1].source.chords[0];
+    Chord q = a;
+    q.keysym = {.keycode = getKeycode('q')};
+    Chord one = a;
+    one.keysym = {.keycode = getKeycode('1')};
+
+    CHECK(engine.decideEvent(q, kCGEventKeyDown, false, 0).kind == EventDecision::Kind::Consume);
+    CHECK(engine.lastMatch() == 0);
+    CHECK(engine.decideEvent(a, kCGEventKeyDown, false, 0).kind == EventDecision::Kind::Consume);
+    CHECK(engine.lastMatch() == 1);
+    CHECK(engine.decideEvent(one, kCGEventKeyDown, false, 0).kind == EventDecision::Kind::Pass);
+    CHECK(engine.lastMatch() == -1);
+}
+
+TEST_CASE("key(...) hotkey runs its command with the key pressed quoted for the shell") {
+    auto r = interpret_source("cmd + key(any) : echo {} {{}}");
+    REQUIRE(r.errors.empty());
+    std::vector<std::string> ran;
+    HotkeyEngine engine(steadyTimeSource(), HotkeyEngine::postEvent, [&](const std::string& command) { ran.push_back(command); });
+    engine.applyConfig(r.bindings, {}, r.config);
+    Chord pressed = r.bindings[0].source.chords[0];
+
+    pressed.keysym = {.keycode = getKeycode('q')};
+    CHECK(engine.handleEvent(pressed, kCGEventKeyDown, false, 0));
+    REQUIRE(ran.size() == 1);
+    CHECK(ran[0] == "echo 'q' {}");
+
+    // a quote typed by the layout can't end the quoting early
+    if (const auto quote = lookupKeycode("'")) {
+        pressed.keysym = {.keycode = *quote};
+        CHECK(engine.handleEvent(pressed, kCGEventKeyDown, false, 0));
+        REQUIRE(ran.size() == 2);
+        CHECK(ran[1] == R"(echo ''\''' {})");
+    }
+}
+
+TEST_CASE("key(...) is rejected where it has nothing to capture into") {
+    auto r = interpret_source(
+        "cmd + key(digit) ; key(any) : echo {}\n"
+        "cmd + {a, b} ; key(any) : echo {}\n"
+        "cmd + key(any) : echo {a,b}\n"
+        "key(letter) | b");
+    REQUIRE(r.errors.size() == 4);
+    // remaps are applied in the first pass
+    CHECK(r.errors[0].message == "remaps do not support key(...) in the source");
+    CHECK(r.errors[1].message.contains("only one chord"));
+    CHECK(r.errors[2].message.contains("cannot be combined with brace expansion"));
+    CHECK(r.errors[3].message.contains("no other brace group"));
+    CHECK(r.bindings.empty());
+}
+
 TEST_CASE("a command on the line after the colon attaches to its chord") {
     auto r = interpret_source(
         "cmd + a :\n"
@@ -448,3 +852,187 @@ TEST_CASE("multi-chord sequence preserves chord order") {
     CHECK(hk.chords[0].modifiers.flags == Hotkey_Flag_Cmd);
     CHECK(hk.chords[1].modifiers.flags == Hotkey_Flag_Cmd);
 }
+
+TEST_CASE("a compiled config round-trips through the config cache") {
+    auto compiled = interpret_source(
+        "blacklist = [\"Terminal\"]\n"
+        "sequence_command = \"notify\"\n"
+        "corner_size = 20\n"
+        "define_region middle = rect(30, 30, 70, 70)\n"
+        "cmd + 0x7B ; trackpad_fingers(3) + return ^ : echo \"hi\"\n"
+        "alt + tab | cmd + 0x30\n"
+        "alt + m | h ; i ; return\n"
+        "alt + t | \"typed \u00e9\"\n"
+        "cmd + alt + key(digit) : focus {}\n"
+        "alt + trackpad_tap(region:middle) : echo tap\n"
+        "cmd + trackpad_swipe(3, left) : echo swipe\n"
+        "trackpad_press(tl) : echo press\n");
+    REQUIRE(compiled.errors.empty());
+
+    const config_cache::Key key{.contents = 1, .layout = 2};
+    ByteWriter out;
+    config_cache::encode(out, key, compiled);
+
+    auto decoded = config_cache::decode(out.bytes(), key);
+    REQUIRE(decoded);
+    REQUIRE(decoded->bindings.size() == compiled.bindings.size());
+    for (size_t i = 0; i < compiled.bindings.size(); i++) {
+        CHECK(decoded->bindings[i].source == compiled.bindings[i].source);
+        CHECK(decoded->bindings[i].action == compiled.bindings[i].action);
+    }
+    REQUIRE(decoded->tapBindings.size() == 1);
+    CHECK(decoded->tapBindings[0].zone == compiled.tapBindings[0].zone);
+    REQUIRE(decoded->tapRegions.size() == compiled.tapRegions.size());
+    CHECK(decoded->tapRegions[0].rect == compiled.tapRegions[0].rect);
+    REQUIRE(decoded->gestureBindings.size() == 1);
+    CHECK(decoded->gestureBindings[0].gesture == compiled.gestureBindings[0].gesture);
+    CHECK(decoded->gestureBindings[0].modifiers == compiled.gestureBindings[0].modifiers);
+    REQUIRE(decoded->pressBindings.size() == 1);
+    CHECK(decoded->pressBindings[0].press == compiled.pressBindings[0].press);
+    CHECK(decoded->config.blacklist == compiled.config.blacklist);
+    CHECK(decoded->config.sequenceCommand == "notify");
+    CHECK(decoded->config.cornerSize == 20);
+
+    // a changed config or layout, or a cut-off file, is a miss rather than a bad config
+    CHECK_FALSE(config_cache::decode(out.bytes(), {.contents = 3, .layout = 2}));
+    CHECK_FALSE(config_cache::decode(out.bytes(), {.contents = 1, .layout = 3}));
+    CHECK_FALSE(config_cache::decode(std::string_view{out.bytes()}.substr(0, out.size() - 1), key));
+}
+
+TEST_CASE("loadFromFile reuses the cache until the config changes") {
+    const auto dir = std::filesystem::temp_directory_path() / "smhkd_test_config_cache";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    setenv("XDG_CACHE_HOME", dir.c_str(), 1);
+    const auto path = dir / "smhkdrc";
+
+    std::ofstream{path} << "cmd + 0x7B : echo first\n";
+    auto first = ConfigLoader::loadFromFile(path, {.useCache = true});
+    CHECK_FALSE(first.fromCache);
+    auto second = ConfigLoader::loadFromFile(path, {.useCache = true});
+    CHECK(second.fromCache);
+    REQUIRE(second.bindings.size() == 1);
+    CHECK(std::get<std::string>(second.bindings[0].action) == "echo first");
+
+    std::ofstream{path, std::ios::trunc} << "cmd + 0x7B : echo second\n";
+    auto changed = ConfigLoader::loadFromFile(path, {.useCache = true});
+    CHECK_FALSE(changed.fromCache);
+    REQUIRE(changed.bindings.size() == 1);
+    CHECK(std::get<std::string>(changed.bindings[0].action) == "echo second");
+
+    // configs with errors are never cached, so they are reported on every load
+    std::ofstream{path, std::ios::trunc} << "cmd + 0x7B echo\n";
+    CHECK_FALSE(ConfigLoader::loadFromFile(path, {.useCache = true}).parseErrors.empty());
+    CHECK_FALSE(ConfigLoader::loadFromFile(path, {.useCache = true}).parseErrors.empty());
+
+    unsetenv("XDG_CACHE_HOME");
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("an incremental reload neither reads nor writes the cache") {
+    [[maybe_unused]] static const bool _ = initializeKeycodeMap();
+    const auto dir = std::filesystem::temp_directory_path() / "smhkd_test_reload_cache";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    setenv("XDG_CACHE_HOME", dir.c_str(), 1);
+    const auto path = dir / "smhkdrc";
+
+    IncrementalInterpreter interpreter;
+    std::ofstream{path} << "cmd + 0x7B : echo first\n";
+    CHECK_FALSE(ConfigLoader::loadFromFile(path, {.useCache = true, .interpreter = &interpreter}).fromCache);
+
+    std::ofstream{path, std::ios::trunc} << "cmd + 0x7B : echo second\n";
+    const auto reloaded = ConfigLoader::loadFromFile(path, {.useCache = true, .interpreter = &interpreter});
+    CHECK_FALSE(reloaded.fromCache);
+    REQUIRE(reloaded.bindings.size() == 1);
+    CHECK(std::get<std::string>(reloaded.bindings[0].action) == "echo second");
+    // the next start finds only the first load's cache, which no longer matches
+    CHECK_FALSE(ConfigLoader::loadFromFile(path, {.useCache = true}).fromCache);
+    CHECK(ConfigLoader::loadFromFile(path, {.useCache = true}).fromCache);
+
+    unsetenv("XDG_CACHE_HOME");
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("an incremental reload re-interprets only the edited statements") {
+    [[maybe_unused]] static const bool _ = initializeKeycodeMap();
+    const std::string before =
+        "define_modifier hyper = cmd + alt\n"
+        "define_region middle = rect(30, 30, 70, 70)\n"
+        "hyper + 0x00 : echo a\n"
+        "hyper + 0x01 : echo b\n"
+        "cmd + 0x02 | alt + 0x03\n"
+        "ctrl + trackpad_tap(region:middle) : echo tap\n";
+    std::string after = before;
+    after.replace(after.find("echo b"), 6, "echo c");
+
+    IncrementalInterpreter interpreter;
+    Parser first{before};
+    (void)interpreter.interpret(first.parseProgram());
+    CHECK(interpreter.lastStats().full);
+
+    Parser second{after};
+    const auto program = second.parseProgram();
+    const auto reloaded = interpreter.interpret(program);
+    const auto& stats = interpreter.lastStats();
+    CHECK_FALSE(stats.full);
+    CHECK(stats.statements == 6);
+    CHECK(stats.reinterpreted == 1);
+    CHECK(stats.keyboardChanged);
+    CHECK_FALSE(stats.trackpadChanged);
+
+    // the same tables, in the same order, as interpreting the new config from scratch
+    const auto fresh = interpretProgram(program);
+    REQUIRE(reloaded.bindings.size() == fresh.bindings.size());
+    for (size_t i = 0; i < fresh.bindings.size(); i++) {
+        CHECK(reloaded.bindings[i].source == fresh.bindings[i].source);
+        CHECK(reloaded.bindings[i].action == fresh.bindings[i].action);
+    }
+    CHECK(reloaded.tapBindings.size() == fresh.tapBindings.size());
+
+    Parser unchanged{after};
+    (void)interpreter.interpret(unchanged.parseProgram());
+    CHECK(interpreter.lastStats().reinterpreted == 0);
+    CHECK_FALSE(interpreter.lastStats().keyboardChanged);
+}
+
+TEST_CASE("changing a define re-interprets only the statements that use it") {
+    [[maybe_unused]] static const bool _ = initializeKeycodeMap();
+    IncrementalInterpreter interpreter;
+    Parser first{"define_modifier hyper = cmd + alt\nhyper + 0x00 : echo a\ncmd + 0x01 : echo b\n"};
+    (void)interpreter.interpret(first.parseProgram());
+
+    Parser second{"define_modifier hyper = cmd + ctrl\nhyper + 0x00 : echo a\ncmd + 0x01 : echo b\n"};
+    const auto program = second.parseProgram();
+    const auto result = interpreter.interpret(program);
+    CHECK_FALSE(interpreter.lastStats().full);
+    CHECK(interpreter.lastStats().reinterpreted == 1);
+    CHECK(interpreter.lastStats().keyboardChanged);
+    REQUIRE(result.bindings.size() == 2);
+    CHECK(result.bindings[0].source.chords[0].modifiers.flags == (Hotkey_Flag_Cmd | Hotkey_Flag_Control));
+    const auto fresh = interpretProgram(program);
+    REQUIRE(fresh.bindings.size() == 2);
+    CHECK(result.bindings[1].source == fresh.bindings[1].source);
+
+    // removing the define brings its error back rather than reusing the old flags
+    Parser removed{"hyper + 0x00 : echo a\ncmd + 0x01 : echo b\n"};
+    const auto broken = interpreter.interpret(removed.parseProgram());
+    CHECK(interpreter.lastStats().reinterpreted == 1);
+    CHECK_FALSE(broken.errors.empty());
+}
+
+TEST_CASE("moving a region re-interprets nothing, but still changes the trackpad tables") {
+    [[maybe_unused]] static const bool _ = initializeKeycodeMap();
+    IncrementalInterpreter interpreter;
+    Parser first{"define_region middle = rect(30, 30, 70, 70)\nctrl + trackpad_tap(region:middle) : echo tap\n"};
+    (void)interpreter.interpret(first.parseProgram());
+
+    // the binding holds the region's zone, and the zone's rect comes from the define
+    Parser second{"define_region middle = rect(20, 20, 80, 80)\nctrl + trackpad_tap(region:middle) : echo tap\n"};
+    const auto result = interpreter.interpret(second.parseProgram());
+    CHECK_FALSE(interpreter.lastStats().full);
+    CHECK(interpreter.lastStats().reinterpreted == 0);
+    CHECK(interpreter.lastStats().trackpadChanged);
+    REQUIRE(result.tapRegions.size() == 1);
+    CHECK(result.tapRegions[0].rect.x0 == 20);
+}
@@ -0,0 +1,40 @@
+#include <string>
+
+#include "doctest.h"
+#include "runtime/metrics.hpp"
+#include "runtime/stats.hpp"
+
+TEST_CASE("latency samples land in the first bucket whose bound covers them") {
+    LatencyHistogram histogram;
+    histogram.record(500);
+    histogram.record(1'000);
+    histogram.record(1'001);
+    histogram.record(200'000'000);
+    const auto buckets = histogram.buckets();
+    CHECK(buckets.front() == 2);
+    CHECK(buckets.at(1) == 1);
+    CHECK(buckets.back() == 1);
+    CHECK(histogram.sumNs() == 200'002'501);
+}
+
+TEST_CASE("prometheus output has every counter and cumulative histogram buckets") {
+    RuntimeStats stats;
+    bump(stats.keyEvents, 3);
+    bump(stats.commandsFailed);
+    stats.handleEvent.record(800);
+    stats.handleEvent.record(7'000);
+    stats.handleEvent.record(2'000'000'000);
+
+    const auto text = formatPrometheus(stats);
+    CHECK(text.find("# TYPE smhkd_key_events_total counter\nsmhkd_key_events_total 3\n") != std::string::npos);
+    CHECK(text.find("smhkd_commands_failed_total 1\n") != std::string::npos);
+    CHECK(text.find("smhkd_reloads_total 0\n") != std::string::npos);
+
+    CHECK(text.find("# TYPE smhkd_handle_event_seconds histogram\n") != std::string::npos);
+    CHECK(text.find("smhkd_handle_event_seconds_bucket{le=\"1e-06\"} 1\n") != std::string::npos);
+    CHECK(text.find("smhkd_handle_event_seconds_bucket{le=\"1e-05\"} 2\n") != std::string::npos);
+    CHECK(text.find("smhkd_handle_event_seconds_bucket{le=\"0.1\"} 2\n") != std::string::npos);
+    CHECK(text.find("smhkd_handle_event_seconds_bucket{le=\"+Inf\"} 3\n") != std::string::npos);
+    CHECK(text.find("smhkd_handle_event_seconds_count 3\n") != std::string::npos);
+    CHECK(text.find("smhkd_config_load_seconds_count 0\n") != std::string::npos);
+}
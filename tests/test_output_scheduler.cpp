@@ -0,0 +1,129 @@
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "doctest.h"
+#include "runtime/output_scheduler.hpp"
+
+namespace {
+
+using namespace std::chrono_literals;
+using steady = std::chrono::steady_clock;
+
+struct Posted {
+    uint32_t keycode;
+    bool keyDown;
+    steady::time_point at;
+};
+
+// records what the scheduler posts, from its thread
+struct Recorder {
+    std::mutex mutex;
+    std::vector<Posted> posted;
+
+    OutputScheduler::Post post() {
+        return [this](const KeyEvent& event, std::u16string_view /*text*/) {
+            std::lock_guard<std::mutex> lock(mutex);
+            posted.push_back({.keycode = event.keycode, .keyDown = event.keyDown, .at = steady::now()});
+        };
+    }
+};
+
+Chord key(uint32_t keycode) {
+    return {.keysym = {keycode}, .modifiers = {0}, .fingerCount = std::nullopt};
+}
+
+}  // namespace
+
+TEST_CASE("output scheduler returns before posting and keeps its gaps") {
+    Recorder recorder;
+    OutputScheduler output(recorder.post(), 20ms);
+    const std::vector<Chord> keys{key(1), key(2)};
+
+    const auto start = steady::now();
+    output.enqueuePresses(keys);
+    CHECK(steady::now() - start < 20ms);
+    CHECK(output.pending() > 0);
+    output.drain();
+    CHECK(output.pending() == 0);
+
+    REQUIRE(recorder.posted.size() == 4);
+    const std::vector<std::pair<uint32_t, bool>> expected{{1, true}, {1, false}, {2, true}, {2, false}};
+    for (size_t i = 0; i < expected.size(); i++) {
+        CHECK(recorder.posted[i].keycode == expected[i].first);
+        CHECK(recorder.posted[i].keyDown == expected[i].second);
+        if (i > 0) CHECK(recorder.posted[i].at - recorder.posted[i - 1].at >= 20ms);
+    }
+}
+
+TEST_CASE("output scheduler batches from several threads never interleave") {
+    Recorder recorder;
+    OutputScheduler output(recorder.post(), 0us);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 4; t++) {
+        threads.emplace_back([&, t] {
+            const std::vector<Chord> keys{key(t * 10), key(t * 10 + 1), key(t * 10 + 2)};
+            for (int i = 0; i < 5; i++) output.enqueuePresses(keys);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    output.drain();
+
+    // each batch is its six events in order, whoever queued it
+    REQUIRE(recorder.posted.size() == 4 * 5 * 6);
+    for (size_t batch = 0; batch < recorder.posted.size(); batch += 6) {
+        const uint32_t base = recorder.posted[batch].keycode;
+        for (size_t i = 0; i < 6; i++) {
+            CHECK(recorder.posted[batch + i].keycode == base + i / 2);
+            CHECK(recorder.posted[batch + i].keyDown == (i % 2 == 0));
+        }
+    }
+}
+
+TEST_CASE("output scheduler posts what is left when destroyed") {
+    Recorder recorder;
+    {
+        OutputScheduler output(recorder.post(), 10s);
+        output.enqueuePress(key(7));
+    }
+    // the up comes out too, without waiting its gap
+    REQUIRE(recorder.posted.size() == 2);
+    CHECK(recorder.posted[0].keyDown);
+    CHECK_FALSE(recorder.posted[1].keyDown);
+}
+
+TEST_CASE("output scheduler holds a program while it is out and grows past its ring") {
+    Recorder recorder;
+    auto program = std::make_shared<EventProgram>();
+    program->text = u"xy";
+    program->events.push_back({.keycode = 3, .flags = 0, .textOffset = 0, .textLength = 2, .keyDown = true, .pause = KeyEvent::Pause::Burst});
+    program->events.push_back({.keycode = 3, .flags = 0, .textOffset = 0, .textLength = 2, .keyDown = false, .pause = KeyEvent::Pause::None});
+    std::vector<std::u16string> texts;
+    {
+        OutputScheduler output(
+            [&](const KeyEvent& event, std::u16string_view text) {
+                recorder.post()(event, text);
+                texts.emplace_back(text);
+            },
+            0us);
+        // more runs than the ring starts with, queued faster than they go out
+        for (int i = 0; i < 40; i++) {
+            output.enqueue(program);
+            output.enqueuePress(key(9));
+        }
+        program.reset();
+        output.drain();
+    }
+    REQUIRE(recorder.posted.size() == 40 * 4);
+    for (size_t i = 0; i < recorder.posted.size(); i += 4) {
+        CHECK(recorder.posted[i].keycode == 3);
+        CHECK(texts[i] == u"xy");
+        CHECK(recorder.posted[i + 2].keycode == 9);
+        CHECK(texts[i + 2].empty());
+    }
+}
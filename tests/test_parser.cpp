@@ -1,3 +1,5 @@
+#include <filesystem>
+#include <fstream>
 #include <variant>
 
 #include "doctest.h"
@@ -13,6 +15,8 @@ const ast::KeyChar& key_char(const ast::Keysym& keysym, size_t index = 0) {
             return std::get<ast::KeyChar>(v.value);
         } else if constexpr (std::is_same_v<T, ast::BraceExpansionKeysym>) {
             return std::get<ast::KeyChar>(v.alternatives.at(index).value);
+        } else if constexpr (std::is_same_v<T, ast::WildcardKeysym>) {
+            throw std::bad_variant_access{};
         } else {
             static_assert(false, "unhandled Keysym alternative");
         }
@@ -169,6 +173,76 @@ TEST_CASE("an invalid corner zone is an error") {
     CHECK_FALSE(p.errors().empty());
 }
 
+TEST_CASE("edge strips parse bare or with the region: prefix") {
+    Parser p{"cmd + trackpad_tap(top_edge) : x\ncmd + trackpad_tap(region:left_edge) : y"};
+    auto program = p.parseProgram();
+    CHECK(p.errors().empty());
+    REQUIRE(program.statements.size() == 2);
+    CHECK(std::get<ast::Hotkey>(program.statements[0]).chords.sequence[0].tap == Zone::TopEdge);
+    CHECK(std::get<ast::Hotkey>(program.statements[1]).chords.sequence[0].tap == Zone::LeftEdge);
+}
+
+TEST_CASE("trackpad_tap(region:name) keeps a user region name for the interpreter") {
+    Parser p{"cmd + trackpad_tap(region:middle) : echo hi"};
+    auto program = p.parseProgram();
+    CHECK(p.errors().empty());
+    REQUIRE(program.statements.size() == 1);
+    const auto& stmt = std::get<ast::Hotkey>(program.statements[0]);
+    const auto& chord = stmt.chords.sequence[0];
+    CHECK_FALSE(chord.tap.has_value());
+    REQUIRE(chord.tapRegion.has_value());
+    CHECK(*chord.tapRegion == "middle");
+    CHECK(stmt.command == "echo hi");
+}
+
+TEST_CASE("define_region parses rect and grid shapes") {
+    Parser p{"define_region middle = rect(30, 30, 70, 70)\ndefine_region cell = grid(3, 3, 1, 0)"};
+    auto program = p.parseProgram();
+    CHECK(p.errors().empty());
+    REQUIRE(program.statements.size() == 2);
+    const auto& rect = std::get<ast::DefineRegion>(program.statements[0]);
+    CHECK(rect.name == "middle");
+    CHECK(rect.shape == ast::RegionShape::Rect);
+    CHECK(rect.args == std::array<int, 4>{30, 30, 70, 70});
+    const auto& grid = std::get<ast::DefineRegion>(program.statements[1]);
+    CHECK(grid.shape == ast::RegionShape::Grid);
+    CHECK(grid.args == std::array<int, 4>{3, 3, 1, 0});
+}
+
+TEST_CASE("define_region with an unknown shape or missing argument is an error") {
+    for (const auto* src : {"define_region a = circle(1, 2, 3, 4)", "define_region a = rect(1, 2, 3)"}) {
+        Parser p{src};
+        auto program = p.parseProgram();
+        CHECK_FALSE(p.errors().empty());
+        CHECK(program.statements.empty());
+    }
+}
+
+TEST_CASE("trackpad_press takes a zone, a region, or a finger count") {
+    Parser p{"trackpad_press(tl) : a\ntrackpad_press(region:middle) : b\ncmd + trackpad_press(3) : c"};
+    auto program = p.parseProgram();
+    CHECK(p.errors().empty());
+    REQUIRE(program.statements.size() == 3);
+    const auto& zone = std::get<ast::Hotkey>(program.statements[0]).chords.sequence[0];
+    REQUIRE(zone.press.has_value());
+    CHECK(zone.press->zone == Zone::TopLeft);
+    CHECK(zone.press->fingers == 1);
+    const auto& region = std::get<ast::Hotkey>(program.statements[1]).chords.sequence[0];
+    REQUIRE(region.press.has_value());
+    CHECK(region.press->region == "middle");
+    const auto& fingers = std::get<ast::Hotkey>(program.statements[2]).chords.sequence[0];
+    REQUIRE(fingers.press.has_value());
+    CHECK_FALSE(fingers.press->zone.has_value());
+    CHECK(fingers.press->fingers == 3);
+}
+
+TEST_CASE("trackpad_press with too many fingers is an error") {
+    Parser p{"trackpad_press(6) : x"};
+    p.parseProgram();
+    REQUIRE_FALSE(p.errors().empty());
+    CHECK(p.errors()[0].message.contains("between 1 and 5"));
+}
+
 TEST_CASE("trackpad_tap missing the closing paren is an error") {
     Parser p{"cmd + trackpad_tap(tr : echo hi"};
     p.parseProgram();
@@ -181,6 +255,67 @@ TEST_CASE("trackpad_tap is rejected in a remap target") {
     CHECK_FALSE(p.errors().empty());
 }
 
+TEST_CASE("trackpad_swipe(N, dir) parses as a chord gesture trigger") {
+    Parser p{"cmd + trackpad_swipe(3, left) : echo hi"};
+    auto program = p.parseProgram();
+
+    CHECK(p.errors().empty());
+    REQUIRE(program.statements.size() == 1);
+    const auto& chord = std::get<ast::Hotkey>(program.statements[0]).chords.sequence[0];
+    REQUIRE(chord.gesture.has_value());
+    CHECK(chord.gesture->kind == GestureKind::SwipeLeft);
+    CHECK(chord.gesture->fingers == 3);
+    CHECK_FALSE(chord.key.has_value());
+    CHECK_FALSE(chord.tap.has_value());
+}
+
+TEST_CASE("trackpad_pinch defaults to two fingers and takes an optional count") {
+    Parser p{"trackpad_pinch(in) : echo in\ntrackpad_pinch(4, out) : echo out"};
+    auto program = p.parseProgram();
+
+    CHECK(p.errors().empty());
+    REQUIRE(program.statements.size() == 2);
+    const auto& in = std::get<ast::Hotkey>(program.statements[0]).chords.sequence[0];
+    REQUIRE(in.gesture.has_value());
+    CHECK(*in.gesture == Gesture{.kind = GestureKind::PinchIn, .fingers = 2});
+    const auto& out = std::get<ast::Hotkey>(program.statements[1]).chords.sequence[0];
+    REQUIRE(out.gesture.has_value());
+    CHECK(*out.gesture == Gesture{.kind = GestureKind::PinchOut, .fingers = 4});
+}
+
+TEST_CASE("trackpad_tap(N) parses as an N-finger tap gesture") {
+    Parser p{"trackpad_tap(3) : echo hi"};
+    auto program = p.parseProgram();
+
+    CHECK(p.errors().empty());
+    const auto& chord = std::get<ast::Hotkey>(program.statements[0]).chords.sequence[0];
+    CHECK_FALSE(chord.tap.has_value());
+    REQUIRE(chord.gesture.has_value());
+    CHECK(*chord.gesture == Gesture{.kind = GestureKind::Tap, .fingers = 3});
+}
+
+TEST_CASE("an invalid swipe direction is an error") {
+    Parser p{"trackpad_swipe(3, sideways) : echo hi"};
+    p.parseProgram();
+    REQUIRE_FALSE(p.errors().empty());
+    CHECK(p.errors()[0].message.contains("invalid swipe direction"));
+}
+
+TEST_CASE("a gesture finger count outside 2-5 is an error") {
+    for (const auto* src : {"trackpad_swipe(1, up) : x", "trackpad_pinch(6, in) : x", "trackpad_tap(1) : x"}) {
+        Parser p{src};
+        p.parseProgram();
+        REQUIRE_FALSE(p.errors().empty());
+        CHECK(p.errors()[0].message.contains("must be between 2 and 5"));
+    }
+}
+
+TEST_CASE("trackpad gestures are rejected in a remap target") {
+    Parser p{"a | trackpad_swipe(3, up)"};
+    p.parseProgram();
+    CHECK_FALSE(p.errors().empty());
+}
+
 TEST_CASE("unknown config assignment is rejected by the parser") {
     Parser p{"unknown_setting = 7"};
     auto program = p.parseProgram();
@@ -261,6 +396,19 @@ TEST_CASE("blacklist parses quoted string entries") {
     CHECK(stmt.stringListValues[2] == "42");
 }
 
+TEST_CASE("blacklist entries take quote and backslash escapes, but not \\n or \\t") {
+    Parser p{R"(blacklist = ["say \"hi\"" "C:\\" "new\ntab\t"])"};
+    auto program = p.parseProgram();
+
+    CHECK(p.errors().empty());
+    REQUIRE(program.statements.size() == 1);
+    auto& stmt = std::get<ast::ConfigProperty>(program.statements[0]);
+    REQUIRE(stmt.stringListValues.size() == 3);
+    CHECK(stmt.stringListValues[0] == R"(say "hi")");
+    CHECK(stmt.stringListValues[1] == R"(C:\)");
+    CHECK(stmt.stringListValues[2] == R"(new\ntab\t)");
+}
+
 TEST_CASE("blacklist without values fails") {
     Parser p{"blacklist = []"};
     auto program = p.parseProgram();
@@ -368,6 +516,32 @@ TEST_CASE("brace expansion is rejected in remap target") {
     CHECK(p.errors()[0].message.contains("brace expansion is not allowed here"));
 }
 
+TEST_CASE("key(class) parses into a wildcard keysym") {
+    Parser p{"cmd + alt + key(letter) : yabai -m space --focus {}"};
+    auto program = p.parseProgram();
+
+    CHECK(p.errors().empty());
+    REQUIRE(program.statements.size() == 1);
+    const auto& stmt = std::get<ast::Hotkey>(program.statements[0]);
+    REQUIRE(stmt.chords.sequence.size() == 1);
+    REQUIRE(stmt.chords.sequence[0].key.has_value());
+    const auto* wildcard = ast::asWildcard(*stmt.chords.sequence[0].key);
+    REQUIRE(wildcard != nullptr);
+    CHECK(wildcard->keyClass == KeyClass::Letter);
+    CHECK(stmt.chords.sequence[0].modifiers.size() == 2);
+    CHECK(stmt.command == "yabai -m space --focus {}");
+}
+
+TEST_CASE("key(...) rejects an unknown class and a remap target") {
+    Parser p{"cmd + key(vowel) : echo hi\ncmd + a | key(any)"};
+    auto program = p.parseProgram();
+
+    REQUIRE(program.statements.empty());
+    REQUIRE(p.errors().size() == 2);
+    CHECK(p.errors()[0].message.contains("invalid key class 'vowel'"));
+    CHECK(p.errors()[1].message.contains("key(...) is not allowed here"));
+}
+
 TEST_CASE("remap target can start on the line after pipe") {
     Parser p{"cmd + a |\nshift + b"};
     auto program = p.parseProgram();
@@ -522,7 +696,7 @@ TEST_CASE("define_modifier parses builtin and custom parts") {
     REQUIRE(stmt.parts.size() == 3);
     CHECK(builtin_modifier(stmt.parts[0]) == BuiltinModifier::Cmd);
     CHECK(builtin_modifier(stmt.parts[1]) == BuiltinModifier::Shift);
-    CHECK(std::get<std::string>(stmt.parts[2].value) == "meh");
+    CHECK(std::get<std::string_view>(stmt.parts[2].value) == "meh");
 }
 
 TEST_CASE("define_modifier rejects invalid custom modifier name") {
@@ -610,6 +784,45 @@ TEST_CASE("remap with pipe parses full source and target") {
     CHECK(key_char(*stmt.target.key).value == 'b');
 }
 
+TEST_CASE("remap with ';' separated targets parses a macro") {
+    Parser p{"cmd + a | cmd + c ; cmd + v ; return"};
+    auto program = p.parseProgram();
+
+    CHECK(p.errors().empty());
+    REQUIRE(program.statements.size() == 1);
+    auto& stmt = std::get<ast::Remap>(program.statements[0]);
+    REQUIRE(stmt.target.key.has_value());
+    CHECK(key_char(*stmt.target.key).value == 'c');
+    REQUIRE(stmt.macro.size() == 2);
+    REQUIRE(stmt.macro[0].key.has_value());
+    CHECK(key_char(*stmt.macro[0].key).value == 'v');
+    CHECK(stmt.macro[1].modifiers.empty());
+}
+
+TEST_CASE("remap text ending in an escaped backslash is closed by its quote") {
+    Parser p{"a | \"C:\\\\\"\nb : echo hi"};
+    auto program = p.parseProgram();
+
+    CHECK(p.errors().empty());
+    REQUIRE(program.statements.size() == 2);
+    auto& stmt = std::get<ast::Remap>(program.statements[0]);
+    REQUIRE(stmt.text.has_value());
+    CHECK(*stmt.text == "C:\\");
+    CHECK(std::holds_alternative<ast::Hotkey>(program.statements[1]));
+}
+
+TEST_CASE("remap with a quoted target parses text to type") {
+    Parser p{"cmd + s | \"say \\\"hi\\\"\""};
+    auto program = p.parseProgram();
+
+    CHECK(p.errors().empty());
+    REQUIRE(program.statements.size() == 1);
+    auto& stmt = std::get<ast::Remap>(program.statements[0]);
+    REQUIRE(stmt.text.has_value());
+    CHECK(*stmt.text == "say \"hi\"");
+    CHECK(stmt.macro.empty());
+}
+
 TEST_CASE("remap rejects missing target chord") {
     Parser p{"cmd + a |"};
     auto program = p.parseProgram();
@@ -629,3 +842,62 @@ TEST_CASE("remap reports trailing tokens after target chord") {
     CHECK(p.errors()[0].message.contains("after remap target"));
     CHECK(p.errors()[0].message.contains("extra"));
 }
+
+TEST_CASE("a parsed program owns its source and allocates its nodes from one arena") {
+    ast::Program program;
+    {
+        Parser p{"define_modifier super = cmd + alt\nblacklist = [\"say \\\"hi\\\"\"]\nsuper + a : echo hi"};
+        program = p.parseProgram();
+        CHECK(p.errors().empty());
+    }
+    REQUIRE(program.storage != nullptr);
+    REQUIRE(program.statements.size() == 3);
+    auto* arena = &program.storage->arena;
+    CHECK(program.statements.get_allocator().resource() == arena);
+
+    const auto& define = std::get<ast::DefineModifier>(program.statements[0]);
+    CHECK(define.name == "super");
+    CHECK(define.parts.get_allocator().resource() == arena);
+
+    const auto& blacklist = std::get<ast::ConfigProperty>(program.statements[1]);
+    REQUIRE(blacklist.stringListValues.size() == 1);
+    CHECK(blacklist.stringListValues[0] == "say \"hi\"");
+
+    const auto& hotkey = std::get<ast::Hotkey>(program.statements[2]);
+    CHECK(hotkey.chords.sequence.get_allocator().resource() == arena);
+    CHECK(hotkey.chords.sequence[0].modifiers.get_allocator().resource() == arena);
+    CHECK(std::get<std::string_view>(hotkey.chords.sequence[0].modifiers[0].value) == "super");
+    CHECK(hotkey.command == "echo hi");
+}
+
+TEST_CASE("a config file is parsed in place from its mapping") {
+    const auto dir = std::filesystem::temp_directory_path();
+    const auto path = dir / "smhkd_test_source_buffer.conf";
+    const std::string contents = "cmd + a : echo \"mapped\"\n";
+    std::ofstream{path} << contents;
+
+    auto load = loadSource(path);
+    REQUIRE_FALSE(load.error);
+    CHECK(load.buffer.isMapped());
+    CHECK(load.buffer.view() == contents);
+
+    const auto* mapped = load.buffer.view().data();
+    Parser p{std::move(load.buffer)};
+    auto program = p.parseProgram();
+    CHECK(p.errors().empty());
+    REQUIRE(program.statements.size() == 1);
+    const auto& hotkey = std::get<ast::Hotkey>(program.statements[0]);
+    CHECK(hotkey.command.data() >= mapped);
+    CHECK(hotkey.command.data() < mapped + contents.size());
+
+    std::ofstream{path, std::ios::trunc};
+    auto empty = loadSource(path);
+    CHECK_FALSE(empty.error);
+    CHECK_FALSE(empty.buffer.isMapped());
+    CHECK(empty.buffer.view().empty());
+    std::filesystem::remove(path);
+
+    auto missing = loadSource(dir / "smhkd_test_missing.conf");
+    REQUIRE(missing.error);
+    CHECK(missing.error->contains("failed to open config file"));
+}
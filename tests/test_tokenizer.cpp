@@ -2,6 +2,8 @@
 #include <vector>
 
 #include "doctest.h"
+#include "input/keysym.hpp"
+#include "input/modifier.hpp"
 #include "lang/parser.hpp"
 #include "lang/tokenizer.hpp"
 
@@ -104,3 +106,89 @@ TEST_CASE("colon switches tokenizer into command mode") {
     CHECK(toks[2].type == TokenType::Command);
     CHECK(toks[2].text == "echo hi");
 }
+
+TEST_CASE("a colon inside parentheses does not start a command") {
+    auto toks = tokenize_all("cmd + trackpad_tap(region:top_edge) : echo hi");
+    REQUIRE(toks.size() == 10);
+    CHECK(toks[5].type == TokenType::Colon);
+    CHECK(toks[6].type == TokenType::Modifier);
+    CHECK(toks[6].text == "top_edge");
+    CHECK(toks[7].type == TokenType::CloseParen);
+    CHECK(toks[8].type == TokenType::Colon);
+    CHECK(toks[9].type == TokenType::Command);
+    CHECK(toks[9].text == "echo hi");
+}
+
+TEST_CASE("an unclosed paren does not swallow the next line's command") {
+    auto toks = tokenize_all("cmd + trackpad_tap(tr\na : echo hi");
+    REQUIRE_FALSE(toks.empty());
+    CHECK(toks.back().type == TokenType::Command);
+    CHECK(toks.back().text == "echo hi");
+}
+
+TEST_CASE("token text is a slice of the input") {
+    const std::string_view input = "cmd + a : echo hi";
+    auto toks = tokenize_all(input);
+    REQUIRE(toks.size() == 5);
+    CHECK(toks[0].text.data() == input.data());
+    CHECK(toks[4].text.data() == input.data() + 10);
+}
+
+TEST_CASE("quoted strings are unescaped only on request") {
+    auto toks = tokenize_all(R"(blacklist = ["plain", "say \"hi\""])");
+    REQUIRE(toks.size() == 7);
+    CHECK(toks[3].type == TokenType::String);
+    CHECK_FALSE(toks[3].escaped);
+    CHECK(toks[3].unquoted() == "plain");
+    CHECK(toks[5].type == TokenType::String);
+    CHECK(toks[5].escaped);
+    CHECK(toks[5].text == R"(say \"hi\")");
+    CHECK(toks[5].unquoted() == R"(say "hi")");
+}
+
+TEST_CASE("a backslash escape is taken as a pair, so \\ can end a string") {
+    auto toks = tokenize_all(R"(a | "C:\\" ; b)");
+    REQUIRE(toks.size() == 5);
+    CHECK(toks[2].type == TokenType::String);
+    CHECK(toks[2].escaped);
+    CHECK(toks[2].text == R"(C:\\)");
+    CHECK(toks[2].unquoted() == R"(C:\)");
+    CHECK(toks[3].type == TokenType::Semicolon);
+}
+
+TEST_CASE("unquoted takes \\n and \\t only in text, and keeps any other backslash") {
+    auto toks = tokenize_all(R"("\"\\\n\t\q")");
+    REQUIRE(toks.size() == 1);
+    CHECK(toks[0].unquoted(Escapes::Text) == "\"\\\n\t\\q");
+    CHECK(toks[0].unquoted() == "\"\\\\n\\t\\q");
+}
+
+TEST_CASE("peeking ahead does not disturb the token order") {
+    Tokenizer tk{"a + b + c"};
+    CHECK(tk.peek(1).type == TokenType::Plus);
+    CHECK(tk.peek().text == "a");
+    CHECK(tk.next().text == "a");
+    CHECK(tk.peek(1).text == "b");
+    CHECK(tk.next().type == TokenType::Plus);
+    CHECK(tk.next().text == "b");
+    CHECK(tk.next().type == TokenType::Plus);
+    CHECK(tk.peek(1).type == TokenType::EndOfFile);
+    CHECK(tk.next().text == "c");
+    CHECK(tk.next().type == TokenType::EndOfFile);
+}
+
+TEST_CASE("name tables resolve every entry and reject near misses") {
+    for (size_t i = 0; i < literal_keys.size(); i++) {
+        CHECK(parseLiteralKey(literal_keys[i].name) == static_cast<LiteralKey>(i));
+    }
+    for (size_t i = 0; i < builtin_modifiers.size(); i++) {
+        CHECK(parseBuiltinModifier(builtin_modifiers[i].name) == static_cast<BuiltinModifier>(i));
+    }
+    CHECK(lookupKeyword("define_region") == TokenType::DefineRegion);
+    CHECK(lookupKeyword("press_threshold") == TokenType::ConfigProperty);
+    for (std::string_view miss : {"", "f21", "retur", "returnn", "Shift", "define", "cmdd", "tap_timeouts"}) {
+        CHECK_FALSE(parseLiteralKey(miss).has_value());
+        CHECK_FALSE(parseBuiltinModifier(miss).has_value());
+        CHECK_FALSE(lookupKeyword(miss).has_value());
+    }
+}
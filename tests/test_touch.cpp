@@ -1,8 +1,12 @@
+#include <memory>
 #include <vector>
 
 #include "doctest.h"
 #include "input/zone.hpp"
+#include "runtime/gesture_detector.hpp"
+#include "runtime/press_detector.hpp"
 #include "runtime/tap_detector.hpp"
+#include "runtime/touch_recording.hpp"
 
 namespace {
 
@@ -37,6 +41,53 @@ TEST_CASE("classifyZone corner size scales the patch") {
     CHECK(classifyZone(0.80F, 0.80F, 25) == Zone::TopRight);
 }
 
+TEST_CASE("parseZone maps the edge strip names") {
+    CHECK(parseZone("top_edge") == Zone::TopEdge);
+    CHECK(parseZone("bottom_edge") == Zone::BottomEdge);
+    CHECK(parseZone("left_edge") == Zone::LeftEdge);
+    CHECK(parseZone("right_edge") == Zone::RightEdge);
+}
+
+TEST_CASE("ZoneMap classifies by a grid lookup, the smallest overlapping region winning") {
+    const ZoneMap map{{
+        {.zone = Zone::TopEdge, .rect = builtinZoneRect(Zone::TopEdge, 15)},
+        {.zone = Zone::TopRight, .rect = builtinZoneRect(Zone::TopRight, 15)},
+        {.zone = regionZone(0), .rect = {30, 30, 70, 70}},
+    }};
+    CHECK(map.classify(0.5F, 0.95F) == Zone::TopEdge);
+    CHECK(map.classify(0.95F, 0.95F) == Zone::TopRight);
+    CHECK(map.classify(0.5F, 0.5F) == regionZone(0));
+    CHECK_FALSE(map.classify(0.1F, 0.1F).has_value());
+    // positions slightly off the pad clamp to the border cells
+    CHECK(map.classify(1.02F, 1.01F) == Zone::TopRight);
+}
+
+TEST_CASE("ZoneMap gives equal-area overlaps to the earlier region") {
+    const ZoneMap map{{
+        {.zone = regionZone(0), .rect = {0, 0, 50, 50}},
+        {.zone = regionZone(1), .rect = {25, 25, 75, 75}},
+    }};
+    CHECK(map.classify(0.3F, 0.3F) == regionZone(0));
+    CHECK(map.classify(0.6F, 0.6F) == regionZone(1));
+}
+
+TEST_CASE("a tap detector with a zone map reports edge and region taps") {
+    TapDetector d;
+    d.setConfig({.cornerSizePct = 15,
+        .tapTimeoutMs = 300,
+        .zones = std::make_shared<const ZoneMap>(std::vector<TapRegion>{
+            {.zone = Zone::BottomEdge, .rect = builtinZoneRect(Zone::BottomEdge, 15)},
+            {.zone = regionZone(0), .rect = {40, 40, 60, 60}},
+        })});
+    CHECK_FALSE(d.onFrame({{1, 0.5F, 0.05F}}, ms(0)).has_value());
+    CHECK(d.onFrame({}, ms(50)) == Zone::BottomEdge);
+    CHECK_FALSE(d.onFrame({{2, 0.5F, 0.5F}}, ms(100)).has_value());
+    CHECK(d.onFrame({}, ms(150)) == regionZone(0));
+    // corners are not classified unless bound
+    CHECK_FALSE(d.onFrame({{3, 0.95F, 0.95F}}, ms(200)).has_value());
+    CHECK_FALSE(d.onFrame({}, ms(250)).has_value());
+}
+
 TEST_CASE("a quick single-finger corner tap is detected") {
     TapDetector d;
     d.setConfig({.cornerSizePct = 15, .tapTimeoutMs = 300});
@@ -80,3 +131,233 @@ TEST_CASE("a finger starting outside a corner never becomes a tap") {
     CHECK_FALSE(d.onFrame({{1, 0.95F, 0.95F}}, ms(20)).has_value());
     CHECK_FALSE(d.onFrame({}, ms(40)).has_value());
 }
+
+namespace {
+
+// n fingers side by side around (cx, cy), gap apart along x
+std::vector<Touch> fingersAt(int n, float cx, float cy, float gap = 0.1F) {
+    std::vector<Touch> out;
+    const float start = cx - (gap * static_cast<float>(n - 1) / 2.0F);
+    for (int i = 0; i < n; i++) {
+        out.push_back({i + 1, start + (gap * static_cast<float>(i)), cy});
+    }
+    return out;
+}
+
+}  // namespace
+
+TEST_CASE("a three-finger swipe left fires once, on the frame it crosses the threshold") {
+    GestureDetector d;
+    d.setConfig({.swipeDistance = 0.12F});
+    CHECK_FALSE(d.onFrame(fingersAt(3, 0.5F, 0.5F), ms(0)).has_value());
+    CHECK_FALSE(d.onFrame(fingersAt(3, 0.45F, 0.5F), ms(10)).has_value());
+    const auto g = d.onFrame(fingersAt(3, 0.35F, 0.5F), ms(20));
+    REQUIRE(g.has_value());
+    CHECK(g->kind == GestureKind::SwipeLeft);
+    CHECK(g->fingers == 3);
+    CHECK_FALSE(d.onFrame(fingersAt(3, 0.2F, 0.5F), ms(30)).has_value());
+    CHECK_FALSE(d.onFrame({}, ms(40)).has_value());
+}
+
+TEST_CASE("swipe direction uses a bottom-left origin (y=1 is top)") {
+    GestureDetector d;
+    CHECK_FALSE(d.onFrame(fingersAt(2, 0.5F, 0.3F), ms(0)).has_value());
+    const auto g = d.onFrame(fingersAt(2, 0.5F, 0.6F), ms(10));
+    REQUIRE(g.has_value());
+    CHECK(g->kind == GestureKind::SwipeUp);
+    CHECK(g->fingers == 2);
+}
+
+TEST_CASE("two fingers spreading apart is a pinch out, moving together a pinch in") {
+    GestureDetector out;
+    CHECK_FALSE(out.onFrame(fingersAt(2, 0.5F, 0.5F, 0.1F), ms(0)).has_value());
+    const auto g1 = out.onFrame(fingersAt(2, 0.5F, 0.5F, 0.2F), ms(10));
+    REQUIRE(g1.has_value());
+    CHECK(g1->kind == GestureKind::PinchOut);
+
+    GestureDetector in;
+    CHECK_FALSE(in.onFrame(fingersAt(2, 0.5F, 0.5F, 0.3F), ms(0)).has_value());
+    const auto g2 = in.onFrame(fingersAt(2, 0.5F, 0.5F, 0.1F), ms(10));
+    REQUIRE(g2.has_value());
+    CHECK(g2->kind == GestureKind::PinchIn);
+}
+
+TEST_CASE("a quick three-finger tap fires when the last finger lifts") {
+    GestureDetector d;
+    d.setConfig({.tapTimeoutMs = 300});
+    // fingers land and lift a frame or so apart, as real taps do
+    CHECK_FALSE(d.onFrame({{1, 0.4F, 0.5F}}, ms(0)).has_value());
+    CHECK_FALSE(d.onFrame({{1, 0.4F, 0.5F}, {2, 0.5F, 0.5F}, {3, 0.6F, 0.5F}}, ms(8)).has_value());
+    CHECK_FALSE(d.onFrame({{2, 0.5F, 0.5F}, {3, 0.6F, 0.5F}}, ms(60)).has_value());
+    const auto g = d.onFrame({}, ms(70));
+    REQUIRE(g.has_value());
+    CHECK(g->kind == GestureKind::Tap);
+    CHECK(g->fingers == 3);
+}
+
+TEST_CASE("a multi-finger touch held past the tap timeout is not a tap") {
+    GestureDetector d;
+    d.setConfig({.tapTimeoutMs = 300});
+    CHECK_FALSE(d.onFrame(fingersAt(2, 0.5F, 0.5F), ms(0)).has_value());
+    CHECK_FALSE(d.onFrame({}, ms(400)).has_value());
+}
+
+TEST_CASE("a single finger is never a gesture") {
+    GestureDetector d;
+    CHECK_FALSE(d.onFrame(fingersAt(1, 0.5F, 0.5F), ms(0)).has_value());
+    CHECK_FALSE(d.onFrame(fingersAt(1, 0.1F, 0.5F), ms(10)).has_value());
+    CHECK_FALSE(d.onFrame({}, ms(20)).has_value());
+}
+
+TEST_CASE("fingers moving in opposite directions are not a swipe") {
+    GestureDetector d;
+    CHECK_FALSE(d.onFrame({{1, 0.3F, 0.5F}, {2, 0.7F, 0.5F}}, ms(0)).has_value());
+    // one finger slides far up, the other drifts down: net travel past the swipe distance,
+    // at a near-constant spread, but no agreement
+    CHECK_FALSE(d.onFrame({{1, 0.3F, 0.7F}, {2, 0.7F, 0.45F}}, ms(10)).has_value());
+    const auto g = d.onFrame({{1, 0.3F, 0.9F}, {2, 0.7F, 0.4F}}, ms(20));
+    CHECK_FALSE(g);
+}
+
+TEST_CASE("a swipe that already fired does not also report a tap on lift") {
+    GestureDetector d;
+    CHECK_FALSE(d.onFrame(fingersAt(2, 0.5F, 0.5F), ms(0)).has_value());
+    REQUIRE(d.onFrame(fingersAt(2, 0.8F, 0.5F), ms(10)).has_value());
+    CHECK_FALSE(d.onFrame({}, ms(20)).has_value());
+}
+
+TEST_CASE("a force press fires once when pressure crosses the threshold") {
+    PressDetector d;
+    d.setConfig({.pressThreshold = 200.0F, .releaseThreshold = 120.0F});
+    CHECK_FALSE(d.onFrame({{1, 0.5F, 0.5F, 50.0F}}).has_value());
+    const auto p = d.onFrame({{1, 0.5F, 0.5F, 210.0F}});
+    REQUIRE(p.has_value());
+    CHECK(p->fingers == 1);
+    CHECK_FALSE(p->zone.has_value());
+    // hovering around the threshold does not retrigger until pressure falls past release
+    CHECK_FALSE(d.onFrame({{1, 0.5F, 0.5F, 190.0F}}).has_value());
+    CHECK_FALSE(d.onFrame({{1, 0.5F, 0.5F, 205.0F}}).has_value());
+    CHECK_FALSE(d.onFrame({{1, 0.5F, 0.5F, 100.0F}}).has_value());
+    CHECK(d.onFrame({{1, 0.5F, 0.5F, 220.0F}}).has_value());
+}
+
+TEST_CASE("lifting every finger re-arms a force press") {
+    PressDetector d;
+    d.setConfig({.pressThreshold = 200.0F, .releaseThreshold = 120.0F});
+    REQUIRE(d.onFrame({{1, 0.5F, 0.5F, 250.0F}}).has_value());
+    CHECK_FALSE(d.onFrame({}).has_value());
+    CHECK(d.onFrame({{2, 0.5F, 0.5F, 250.0F}}).has_value());
+}
+
+TEST_CASE("a one-finger press reports its zone, a multi-finger press its finger count") {
+    PressDetector d;
+    d.setConfig({.pressThreshold = 200.0F, .releaseThreshold = 120.0F, .cornerSizePct = 15});
+    const auto corner = d.onFrame({{1, 0.05F, 0.95F, 230.0F}});
+    REQUIRE(corner.has_value());
+    CHECK(corner->zone == Zone::TopLeft);
+    CHECK(Press{.zone = Zone::TopLeft, .fingers = 1}.triggeredBy(*corner));
+    CHECK_FALSE(Press{.zone = std::nullopt, .fingers = 2}.triggeredBy(*corner));
+    CHECK_FALSE(d.onFrame({}).has_value());
+
+    const auto two = d.onFrame({{1, 0.4F, 0.5F, 90.0F}, {2, 0.6F, 0.5F, 230.0F}});
+    REQUIRE(two.has_value());
+    CHECK(two->fingers == 2);
+    CHECK_FALSE(two->zone.has_value());
+    CHECK(Press{.zone = std::nullopt, .fingers = 2}.triggeredBy(*two));
+    CHECK_FALSE(Press{.zone = Zone::TopLeft, .fingers = 1}.triggeredBy(*two));
+}
+
+namespace {
+
+RecordedFrame recordedFrame(int frame, double seconds, std::vector<RecordedFinger> fingers) {
+    return {.device = 1, .frame = frame, .timestamp = seconds, .fingers = std::move(fingers)};
+}
+
+RecordedFinger recordedFinger(int id, float x, float y) {
+    return {.id = id, .x = x, .y = y, .vx = 0.0F, .vy = 0.0F, .pressure = 10.0F, .size = 0.5F};
+}
+
+std::string encodeRecording(const std::vector<RecordedFrame>& frames) {
+    ByteWriter out;
+    touch_recording::encodeHeader(out);
+    for (const auto& f : frames) {
+        touch_recording::encodeFrame(out, f);
+    }
+    return out.bytes();
+}
+
+}  // namespace
+
+TEST_CASE("touch recordings round-trip through the binary format") {
+    const std::vector<RecordedFrame> frames{
+        recordedFrame(1, 1.0, {recordedFinger(4, 0.25F, 0.75F)}),
+        recordedFrame(2, 1.008, {{.id = 4, .x = 0.3F, .y = 0.7F, .vx = 0.5F, .vy = -0.5F, .pressure = 42.0F, .size = 1.5F},
+                                    recordedFinger(5, 0.6F, 0.6F)}),
+        recordedFrame(3, 1.016, {}),
+    };
+    const auto loaded = decodeTouchRecording(encodeRecording(frames));
+    CHECK_FALSE(loaded.error.has_value());
+    CHECK(loaded.frames == frames);
+}
+
+TEST_CASE("a truncated recording keeps its complete frames") {
+    std::string bytes = encodeRecording({
+        recordedFrame(1, 1.0, {recordedFinger(1, 0.5F, 0.5F)}),
+        recordedFrame(2, 1.01, {recordedFinger(1, 0.5F, 0.5F)}),
+    });
+    bytes.resize(bytes.size() - 3);
+    const auto loaded = decodeTouchRecording(bytes);
+    REQUIRE(loaded.error.has_value());
+    CHECK(loaded.error->contains("truncated"));
+    CHECK(loaded.frames.size() == 1);
+}
+
+TEST_CASE("a file without the recording magic is rejected") {
+    const auto loaded = decodeTouchRecording("not a recording");
+    REQUIRE(loaded.error.has_value());
+    CHECK(loaded.frames.empty());
+}
+
+TEST_CASE("replay reports taps and gestures with latency from first contact") {
+    const std::vector<RecordedFrame> frames{
+        recordedFrame(1, 1.000, {recordedFinger(1, 0.95F, 0.95F)}),
+        recordedFrame(2, 1.040, {}),
+        recordedFrame(3, 2.000, {recordedFinger(2, 0.5F, 0.5F), recordedFinger(3, 0.55F, 0.5F)}),
+        recordedFrame(4, 2.010, {recordedFinger(2, 0.45F, 0.5F), recordedFinger(3, 0.5F, 0.5F)}),
+        recordedFrame(5, 2.020, {recordedFinger(2, 0.35F, 0.5F), recordedFinger(3, 0.4F, 0.5F)}),
+        recordedFrame(6, 2.030, {}),
+    };
+    const auto report = replayTouchFrames(frames, {.cornerSizePct = 15, .tapTimeoutMs = 300}, {});
+
+    CHECK(report.frames == frames.size());
+    REQUIRE(report.events.size() == 2);
+    CHECK(std::get<Zone>(report.events[0].trigger) == Zone::TopRight);
+    CHECK(report.events[0].latencyNs == doctest::Approx(ms(40)).epsilon(0.001));
+    CHECK(std::get<Gesture>(report.events[1].trigger) == Gesture{.kind = GestureKind::SwipeLeft, .fingers = 2});
+    CHECK(report.events[1].latencyNs == doctest::Approx(ms(20)).epsilon(0.001));
+    CHECK(report.frameProcessing.maxNs >= report.frameProcessing.p50Ns);
+}
+
+TEST_CASE("replay reports force presses from recorded pressure") {
+    const std::vector<RecordedFrame> frames{
+        recordedFrame(1, 1.000, {recordedFinger(1, 0.5F, 0.5F)}),
+        recordedFrame(2, 1.100, {{.id = 1, .x = 0.5F, .y = 0.5F, .vx = 0.0F, .vy = 0.0F, .pressure = 300.0F, .size = 1.0F}}),
+        recordedFrame(3, 1.200, {}),
+    };
+    const auto report = replayTouchFrames(frames, {}, {}, {.pressThreshold = 200.0F, .releaseThreshold = 120.0F});
+    REQUIRE(report.events.size() == 1);
+    CHECK(std::get<Press>(report.events[0].trigger) == Press{.zone = std::nullopt, .fingers = 1});
+    CHECK(report.events[0].latencyNs == doctest::Approx(ms(100)).epsilon(0.001));
+}
+
+TEST_CASE("summarizeDurations picks percentiles from the sorted samples") {
+    std::vector<int64_t> samples;
+    for (int64_t i = 100; i >= 1; i--) {
+        samples.push_back(i);
+    }
+    const auto stats = summarizeDurations(samples);
+    CHECK(stats.meanNs == 50);
+    CHECK(stats.p50Ns == 50);
+    CHECK(stats.p99Ns == 99);
+    CHECK(stats.maxNs == 100);
+}